@@ -61,12 +61,6 @@ one of the application files:
 	#define configAPPLICATION_PROVIDES_cOutputBuffer 0
 #endif
 
-typedef struct xCOMMAND_INPUT_LIST
-{
-	const CLI_Command_Definition_t *pxCommandLineDefinition;
-	struct xCOMMAND_INPUT_LIST *pxNext;
-} CLI_Definition_List_Item_t;
-
 /*
  * The callback function that is executed when "help" is entered.  This is the
  * only default command that is always present.
@@ -78,6 +72,12 @@ static BaseType_t prvHelpCommand( char *pcWriteBuffer, size_t xWriteBufferLen, c
  */
 static int8_t prvGetNumberOfParameters( const char *pcCommandString );
 
+/*
+ * Add a list item that references pxCommandToRegister to the end of the list
+ * of registered commands.
+ */
+static void prvAddCommandToList( const CLI_Command_Definition_t * const pxCommandToRegister, CLI_Definition_List_Item_t * const pxNewListItem );
+
 /* The definition of the "help" command.  This command is always at the front
 of the list of registered commands. */
 static const CLI_Command_Definition_t xHelpCommand =
@@ -96,6 +96,10 @@ static CLI_Definition_List_Item_t xRegisteredCommands =
 	NULL			/* The next pointer is initialised to NULL, as there are no other registered commands yet. */
 };
 
+/* The last item in the list of registered commands, new commands are added
+after it. */
+static CLI_Definition_List_Item_t *pxLastCommandInList = &xRegisteredCommands;
+
 /* A buffer into which command outputs can be written is declared here, rather
 than in the command console implementation, to allow multiple command consoles
 to share the same buffer.  For example, an application may allow access to the
@@ -119,7 +123,6 @@ buffer needs to be placed at a fixed address (rather than by the linker). */
 
 BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister )
 {
-static CLI_Definition_List_Item_t *pxLastCommandInList = &xRegisteredCommands;
 CLI_Definition_List_Item_t *pxNewListItem;
 BaseType_t xReturn = pdFAIL;
 
@@ -132,29 +135,44 @@ BaseType_t xReturn = pdFAIL;
 
 	if( pxNewListItem != NULL )
 	{
-		taskENTER_CRITICAL();
-		{
-			/* Reference the command being registered from the newly created
-			list item. */
-			pxNewListItem->pxCommandLineDefinition = pxCommandToRegister;
+		prvAddCommandToList( pxCommandToRegister, pxNewListItem );
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
 
-			/* The new list item will get added to the end of the list, so
-			pxNext has nowhere to point. */
-			pxNewListItem->pxNext = NULL;
+BaseType_t FreeRTOS_CLIRegisterCommandStatic( const CLI_Command_Definition_t * const pxCommandToRegister, CLI_Definition_List_Item_t * const pxListItemBuffer )
+{
+	/* Check the parameters are not NULL. */
+	configASSERT( pxCommandToRegister );
+	configASSERT( pxListItemBuffer );
 
-			/* Add the newly created list item to the end of the already existing
-			list. */
-			pxLastCommandInList->pxNext = pxNewListItem;
+	prvAddCommandToList( pxCommandToRegister, pxListItemBuffer );
 
-			/* Set the end of list marker to the new list item. */
-			pxLastCommandInList = pxNewListItem;
-		}
-		taskEXIT_CRITICAL();
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
 
-		xReturn = pdPASS;
-	}
+static void prvAddCommandToList( const CLI_Command_Definition_t * const pxCommandToRegister, CLI_Definition_List_Item_t * const pxNewListItem )
+{
+	taskENTER_CRITICAL();
+	{
+		/* Reference the command being registered from the new list item. */
+		pxNewListItem->pxCommandLineDefinition = pxCommandToRegister;
 
-	return xReturn;
+		/* The new list item will get added to the end of the list, so
+		pxNext has nowhere to point. */
+		pxNewListItem->pxNext = NULL;
+
+		/* Add the new list item to the end of the already existing list. */
+		pxLastCommandInList->pxNext = pxNewListItem;
+
+		/* Set the end of list marker to the new list item. */
+		pxLastCommandInList = pxNewListItem;
+	}
+	taskEXIT_CRITICAL();
 }
 /*-----------------------------------------------------------*/
 
@@ -63,6 +63,14 @@ typedef struct xCOMMAND_LINE_INPUT
 /* For backward compatibility. */
 #define xCommandLineInput CLI_Command_Definition_t
 
+/* The list item that links a registered command into the list of commands.
+It is only exposed so FreeRTOS_CLIRegisterCommandStatic() can be passed one. */
+typedef struct xCOMMAND_INPUT_LIST
+{
+	const CLI_Command_Definition_t *pxCommandLineDefinition;
+	struct xCOMMAND_INPUT_LIST *pxNext;
+} CLI_Definition_List_Item_t;
+
 /*
  * Register the command passed in using the pxCommandToRegister parameter.
  * Registering a command adds the command to the list of commands that are
@@ -71,6 +79,14 @@ typedef struct xCOMMAND_LINE_INPUT
  */
 BaseType_t FreeRTOS_CLIRegisterCommand( const CLI_Command_Definition_t * const pxCommandToRegister );
 
+/*
+ * As FreeRTOS_CLIRegisterCommand(), but the list item used to add the command
+ * to the list of commands is provided by the caller instead of being allocated
+ * from the FreeRTOS heap.  pxListItemBuffer must remain valid for as long as
+ * the command interpreter is in use.
+ */
+BaseType_t FreeRTOS_CLIRegisterCommandStatic( const CLI_Command_Definition_t * const pxCommandToRegister, CLI_Definition_List_Item_t * const pxListItemBuffer );
+
 /*
  * Runs the command interpreter for the command string "pcCommandInput".  Any
  * output generated by running the command will be placed into pcWriteBuffer.
@@ -119,8 +119,18 @@ typedef struct xEventGroupDefinition
 		UBaseType_t uxEventGroupNumber;
 	#endif
 
+	#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+		uint8_t ucStaticallyAllocated; /*< Set to pdTRUE if the memory used by the event group was provided by the application, so it is not freed when the event group is deleted. */
+	#endif
+
 } EventGroup_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* StaticEventGroup_t mirrors EventGroup_t so the application can allocate
+	the memory without having access to the event group definition. */
+	portSTATIC_ASSERT( sizeof( StaticEventGroup_t ) == sizeof( EventGroup_t ), xStaticEventGroupSizeCheck );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -144,6 +154,13 @@ EventGroup_t *pxEventBits;
 	{
 		pxEventBits->uxEventBits = 0;
 		vListInitialise( &( pxEventBits->xTasksWaitingForBits ) );
+
+		#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+		{
+			pxEventBits->ucStaticallyAllocated = pdFALSE;
+		}
+		#endif
+
 		traceEVENT_GROUP_CREATE( pxEventBits );
 	}
 	else
@@ -155,6 +172,27 @@ EventGroup_t *pxEventBits;
 }
 /*-----------------------------------------------------------*/
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	EventGroupHandle_t xEventGroupCreateStatic( StaticEventGroup_t *pxEventGroupBuffer )
+	{
+	EventGroup_t *pxEventBits;
+
+		configASSERT( pxEventGroupBuffer != NULL );
+
+		pxEventBits = ( EventGroup_t * ) pxEventGroupBuffer; /*lint !e740 Unusual cast is ok as the structures are designed to have the same alignment, and the size is checked by an assert. */
+
+		pxEventBits->uxEventBits = 0;
+		vListInitialise( &( pxEventBits->xTasksWaitingForBits ) );
+		pxEventBits->ucStaticallyAllocated = pdTRUE;
+		traceEVENT_GROUP_CREATE( pxEventBits );
+
+		return ( EventGroupHandle_t ) pxEventBits;
+	}
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+/*-----------------------------------------------------------*/
+
 EventBits_t xEventGroupSync( EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet, const EventBits_t uxBitsToWaitFor, TickType_t xTicksToWait )
 {
 EventBits_t uxOriginalBitValue, uxReturn;
@@ -588,7 +626,24 @@ const List_t *pxTasksWaitingForBits = &( pxEventBits->xTasksWaitingForBits );
 			( void ) xTaskRemoveFromUnorderedEventList( pxTasksWaitingForBits->xListEnd.pxNext, eventUNBLOCKED_DUE_TO_BIT_SET );
 		}
 
-		vPortFree( pxEventBits );
+		#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+		{
+			/* Only free the memory if it was allocated dynamically in the
+			first place. */
+			if( pxEventBits->ucStaticallyAllocated == ( uint8_t ) pdFALSE )
+			{
+				vPortFree( pxEventBits );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		#else
+		{
+			vPortFree( pxEventBits );
+		}
+		#endif
 	}
 	( void ) xTaskResumeAll();
 }
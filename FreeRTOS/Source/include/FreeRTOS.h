@@ -262,6 +262,11 @@ extern "C" {
 	#define configASSERT_DEFINED 1
 #endif
 
+/* Stops the build when a condition the compiler can evaluate is false, by
+declaring an array type of negative size.  xName only has to be unique within
+the file. */
+#define portSTATIC_ASSERT( x, xName ) typedef char xName[ ( x ) ? 1 : -1 ]
+
 /* The timers module relies on xTaskGetSchedulerState(). */
 #if configUSE_TIMERS == 1
 
@@ -767,6 +772,29 @@ extern "C" {
 	#define configUSE_TASK_NOTIFICATIONS 1
 #endif
 
+#ifndef configUSE_DELAY_TIMING_WHEEL
+	/* Set to 1 to keep delayed tasks on a hashed timing wheel instead of a
+	sorted list, which makes blocking with a time out O(1) however many tasks
+	are delayed. */
+	#define configUSE_DELAY_TIMING_WHEEL 0
+#endif
+
+#ifndef configDELAY_WHEEL_SLOTS
+	#define configDELAY_WHEEL_SLOTS 32
+#endif
+
+#if( ( configUSE_DELAY_TIMING_WHEEL == 1 ) && ( ( configDELAY_WHEEL_SLOTS & ( configDELAY_WHEEL_SLOTS - 1 ) ) != 0 ) )
+	#error configDELAY_WHEEL_SLOTS must be a power of two
+#endif
+
+#ifndef configSUPPORT_STATIC_ALLOCATION
+	/* Defaults to 0 for backward compatibility.  When set to 1 the
+	xTaskCreateStatic(), xQueueCreateStatic() and xSemaphoreCreateBinaryStatic()
+	API functions are available, and the application must provide the memory
+	used by the idle task through vApplicationGetIdleTaskMemory(). */
+	#define configSUPPORT_STATIC_ALLOCATION 0
+#endif
+
 #ifndef portTICK_TYPE_IS_ATOMIC
 	#define portTICK_TYPE_IS_ATOMIC 0
 #endif
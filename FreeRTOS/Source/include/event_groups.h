@@ -131,6 +131,30 @@ typedef void * EventGroupHandle_t;
  */
 typedef TickType_t EventBits_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	/*
+	 * The event group structure is only visible to event_groups.c.
+	 * StaticEventGroup_t has the same size and alignment as the event group
+	 * structure so the application can provide the memory for an event group
+	 * without knowing its layout.  Its members must not be accessed directly.
+	 * Its size is checked against the real structure by an assert in
+	 * xEventGroupCreateStatic().
+	 */
+	typedef struct xSTATIC_EVENT_GROUP
+	{
+		TickType_t xDummy1;
+		List_t xDummy2;
+
+		#if( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t uxDummy3;
+		#endif
+
+		uint8_t ucDummy4;
+	} StaticEventGroup_t;
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
 /**
  * event_groups.h
  *<pre>
@@ -175,6 +199,36 @@ typedef TickType_t EventBits_t;
  */
 EventGroupHandle_t xEventGroupCreate( void ) PRIVILEGED_FUNCTION;
 
+/**
+ * event_groups.h
+ *<pre>
+ EventGroupHandle_t xEventGroupCreateStatic( StaticEventGroup_t *pxEventGroupBuffer );
+ </pre>
+ *
+ * Create a new event group without using the FreeRTOS heap.  Only available
+ * when configSUPPORT_STATIC_ALLOCATION is set to 1 in FreeRTOSConfig.h.  The
+ * memory passed in must remain valid for as long as the event group exists,
+ * and is not freed if the event group is deleted.
+ *
+ * @param pxEventGroupBuffer Must point to a StaticEventGroup_t variable, which
+ * will be used to hold the event group's data structure.
+ *
+ * @return A handle to the created event group.
+ *
+ * Example usage:
+   <pre>
+	static StaticEventGroup_t xEventGroupBuffer;
+	EventGroupHandle_t xEventGroup;
+
+	xEventGroup = xEventGroupCreateStatic( &xEventGroupBuffer );
+   </pre>
+ * \defgroup xEventGroupCreateStatic xEventGroupCreateStatic
+ * \ingroup EventGroup
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	EventGroupHandle_t xEventGroupCreateStatic( StaticEventGroup_t *pxEventGroupBuffer ) PRIVILEGED_FUNCTION;
+#endif
+
 /**
  * event_groups.h
  *<pre>
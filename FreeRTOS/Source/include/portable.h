@@ -174,6 +174,14 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Only implemented by heap_tlsf.c.  Counts the free blocks into uxBins power
+ * of two size classes (bin n holds blocks of 2^n up to 2^(n+1)-1 bytes, the
+ * last bin also holds everything larger) and returns the size of the largest
+ * free block.
+ */
+size_t xPortGetFreeBlockHistogram( UBaseType_t *puxCounts, UBaseType_t uxBins ) PRIVILEGED_FUNCTION;
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -75,6 +75,8 @@
 	#error "include FreeRTOS.h" must appear in source files before "include queue.h"
 #endif
 
+#include "list.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -87,6 +89,43 @@ extern "C" {
  */
 typedef void * QueueHandle_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	/*
+	 * The queue structure is only visible to queue.c.  StaticQueue_t has the
+	 * same size and alignment as the queue structure so the application can
+	 * provide the memory for a queue (or semaphore) without knowing its
+	 * layout.  Its members must not be accessed directly.  Its size is checked
+	 * against the real structure by an assert in xQueueGenericCreateStatic().
+	 */
+	typedef struct xSTATIC_QUEUE
+	{
+		void *pvDummy1[ 3 ];
+
+		union
+		{
+			void *pvDummy2;
+			UBaseType_t uxDummy2;
+		} u;
+
+		List_t xDummy3[ 2 ];
+		UBaseType_t uxDummy4[ 3 ];
+		BaseType_t xDummy5[ 2 ];
+
+		#if ( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t uxDummy6;
+			uint8_t ucDummy7;
+		#endif
+
+		#if ( configUSE_QUEUE_SETS == 1 )
+			void *pvDummy8;
+		#endif
+
+		uint8_t ucDummy9;
+	} StaticQueue_t;
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
 /**
  * Type by which queue sets are referenced.  For example, a call to
  * xQueueCreateSet() returns an xQueueSet variable that can then be used as a
@@ -172,6 +211,57 @@ typedef void * QueueSetMemberHandle_t;
  */
 #define xQueueCreate( uxQueueLength, uxItemSize ) xQueueGenericCreate( uxQueueLength, uxItemSize, queueQUEUE_TYPE_BASE )
 
+/**
+ * queue. h
+ * <pre>
+ QueueHandle_t xQueueCreateStatic(
+							  UBaseType_t uxQueueLength,
+							  UBaseType_t uxItemSize,
+							  uint8_t *pucQueueStorageBuffer,
+							  StaticQueue_t *pxQueueBuffer
+						  );
+ * </pre>
+ *
+ * Creates a new queue instance without using the FreeRTOS heap.  Only
+ * available when configSUPPORT_STATIC_ALLOCATION is set to 1 in
+ * FreeRTOSConfig.h.  The memory passed in must remain valid for as long as
+ * the queue exists, and is not freed if the queue is deleted.
+ *
+ * @param uxQueueLength The maximum number of items that the queue can contain.
+ *
+ * @param uxItemSize The number of bytes each item in the queue will require.
+ *
+ * @param pucQueueStorageBuffer Must point to an array of at least
+ * ( uxQueueLength * uxItemSize ) bytes, which will hold the queued items.
+ * Must be NULL if uxItemSize is zero.
+ *
+ * @param pxQueueBuffer Must point to a StaticQueue_t variable, which will be
+ * used to hold the queue's data structure.
+ *
+ * @return A handle to the created queue.
+ *
+ * Example usage:
+   <pre>
+ #define QUEUE_LENGTH 10
+ #define ITEM_SIZE sizeof( uint32_t )
+
+ static StaticQueue_t xQueueBuffer;
+ static uint8_t ucQueueStorage[ QUEUE_LENGTH * ITEM_SIZE ];
+
+ void vATask( void *pvParameters )
+ {
+ QueueHandle_t xQueue;
+
+	xQueue = xQueueCreateStatic( QUEUE_LENGTH, ITEM_SIZE, ucQueueStorage, &xQueueBuffer );
+ }
+ </pre>
+ * \defgroup xQueueCreateStatic xQueueCreateStatic
+ * \ingroup QueueManagement
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	#define xQueueCreateStatic( uxQueueLength, uxItemSize, pucQueueStorage, pxQueueBuffer ) xQueueGenericCreateStatic( ( uxQueueLength ), ( uxItemSize ), ( pucQueueStorage ), ( pxQueueBuffer ), queueQUEUE_TYPE_BASE )
+#endif
+
 /**
  * queue. h
  * <pre>
@@ -1541,6 +1631,14 @@ BaseType_t xQueueGiveMutexRecursive( QueueHandle_t pxMutex ) PRIVILEGED_FUNCTION
  */
 QueueHandle_t xQueueGenericCreate( const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
 
+/*
+ * Generic version of the static queue creation function, which is in turn
+ * called by the static queue and semaphore creation macros.
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	QueueHandle_t xQueueGenericCreateStatic( const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, uint8_t *pucQueueStorage, StaticQueue_t *pxStaticQueue, const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Queue sets provide a mechanism to allow a task to block (pend) on a read
  * operation from multiple queues or semaphores simultaneously.
@@ -1591,6 +1689,24 @@ QueueHandle_t xQueueGenericCreate( const UBaseType_t uxQueueLength, const UBaseT
  */
 QueueSetHandle_t xQueueCreateSet( const UBaseType_t uxEventQueueLength ) PRIVILEGED_FUNCTION;
 
+/*
+ * As xQueueCreateSet(), but the queue set is built in memory provided by the
+ * caller instead of being allocated from the FreeRTOS heap.
+ *
+ * @param uxEventQueueLength As xQueueCreateSet().
+ *
+ * @param pucQueueSetStorage Must point to a uint8_t array that is at least
+ * uxEventQueueLength * sizeof( QueueHandle_t ) bytes in size.
+ *
+ * @param pxStaticQueueSet Must point to a variable of type StaticQueue_t, which
+ * will be used to hold the queue set's data structure.
+ *
+ * @return The handle of the queue set, which is never NULL.
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	QueueSetHandle_t xQueueCreateSetStatic( const UBaseType_t uxEventQueueLength, uint8_t *pucQueueSetStorage, StaticQueue_t *pxStaticQueueSet ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Adds a queue or semaphore to a queue set that was previously created by a
  * call to xQueueCreateSet().
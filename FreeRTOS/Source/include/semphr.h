@@ -78,6 +78,11 @@
 
 typedef QueueHandle_t SemaphoreHandle_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* A semaphore is a queue, so the memory it needs is the same. */
+	typedef StaticQueue_t StaticSemaphore_t;
+#endif
+
 #define semBINARY_SEMAPHORE_QUEUE_LENGTH	( ( uint8_t ) 1U )
 #define semSEMAPHORE_QUEUE_ITEM_LENGTH		( ( uint8_t ) 0U )
 #define semGIVE_BLOCK_TIME					( ( TickType_t ) 0U )
@@ -184,6 +189,28 @@ typedef QueueHandle_t SemaphoreHandle_t;
  */
 #define xSemaphoreCreateBinary() xQueueGenericCreate( ( UBaseType_t ) 1, semSEMAPHORE_QUEUE_ITEM_LENGTH, queueQUEUE_TYPE_BINARY_SEMAPHORE )
 
+/**
+ * semphr. h
+ * <pre>SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t *pxSemaphoreBuffer )</pre>
+ *
+ * Creates a binary semaphore in the same way as xSemaphoreCreateBinary(), but
+ * using the memory pointed to by pxSemaphoreBuffer instead of the FreeRTOS
+ * heap.  Only available when configSUPPORT_STATIC_ALLOCATION is set to 1 in
+ * FreeRTOSConfig.h.  As with xSemaphoreCreateBinary() the semaphore must
+ * first be 'given' before it can be 'taken'.
+ *
+ * @param pxSemaphoreBuffer Must point to a StaticSemaphore_t variable, which
+ * will be used to hold the semaphore's data structure.
+ *
+ * @return Handle to the created semaphore.
+ *
+ * \defgroup xSemaphoreCreateBinaryStatic xSemaphoreCreateBinaryStatic
+ * \ingroup Semaphores
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	#define xSemaphoreCreateBinaryStatic( pxSemaphoreBuffer ) xQueueGenericCreateStatic( ( UBaseType_t ) 1, semSEMAPHORE_QUEUE_ITEM_LENGTH, NULL, ( pxSemaphoreBuffer ), queueQUEUE_TYPE_BINARY_SEMAPHORE )
+#endif
+
 /**
  * semphr. h
  * <pre>xSemaphoreTake(
@@ -175,6 +175,59 @@ typedef struct xTASK_STATUS
 	uint16_t usStackHighWaterMark;	/* The minimum amount of stack space that has remained for the task since the task was created.  The closer this value is to zero the closer the task has come to overflowing its stack. */
 } TaskStatus_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	/*
+	 * In line with software engineering best practice, the TCB is only visible
+	 * to tasks.c.  StaticTask_t has the same size and alignment as the TCB so
+	 * the application can provide the memory for a task without knowing the
+	 * layout of the TCB.  Its members must not be accessed directly.  Its size
+	 * is checked against the TCB by an assert in xTaskCreateStatic().
+	 */
+	typedef struct xSTATIC_TCB
+	{
+		void				*pxDummy1;
+		#if ( portUSING_MPU_WRAPPERS == 1 )
+			xMPU_SETTINGS	xDummy2;
+			BaseType_t		xDummy3;
+		#endif
+		ListItem_t			xDummy4[ 2 ];
+		UBaseType_t			uxDummy5;
+		void				*pxDummy6;
+		uint8_t				ucDummy7[ configMAX_TASK_NAME_LEN ];
+		#if ( portSTACK_GROWTH > 0 )
+			void			*pxDummy8;
+		#endif
+		#if ( portCRITICAL_NESTING_IN_TCB == 1 )
+			UBaseType_t		uxDummy9;
+		#endif
+		#if ( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t		uxDummy10[ 2 ];
+		#endif
+		#if ( configUSE_MUTEXES == 1 )
+			UBaseType_t		uxDummy12[ 2 ];
+		#endif
+		#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+			void			*pxDummy14;
+		#endif
+		#if( configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0 )
+			void			*pvDummy15[ configNUM_THREAD_LOCAL_STORAGE_POINTERS ];
+		#endif
+		#if ( configGENERATE_RUN_TIME_STATS == 1 )
+			uint32_t		ulDummy16;
+		#endif
+		#if ( configUSE_NEWLIB_REENTRANT == 1 )
+			struct	_reent	xDummy17;
+		#endif
+		#if ( configUSE_TASK_NOTIFICATIONS == 1 )
+			uint32_t		ulDummy18;
+			uint32_t		eDummy19;
+		#endif
+		uint8_t				ucDummy20;
+	} StaticTask_t;
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
 /* Possible return values for eTaskConfirmSleepModeStatus(). */
 typedef enum
 {
@@ -344,6 +397,70 @@ is used in assert() statements. */
  */
 #define xTaskCreate( pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask ) xTaskGenericCreate( ( pvTaskCode ), ( pcName ), ( usStackDepth ), ( pvParameters ), ( uxPriority ), ( pxCreatedTask ), ( NULL ), ( NULL ) )
 
+/**
+ * task. h
+ *<pre>
+ TaskHandle_t xTaskCreateStatic(
+								  TaskFunction_t pvTaskCode,
+								  const char * const pcName,
+								  uint16_t usStackDepth,
+								  void *pvParameters,
+								  UBaseType_t uxPriority,
+								  StackType_t *pxStackBuffer,
+								  StaticTask_t *pxTaskBuffer
+							  );</pre>
+ *
+ * Create a new task and add it to the list of tasks that are ready to run,
+ * without using the FreeRTOS heap.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1 in FreeRTOSConfig.h.
+ *
+ * xTaskCreate() allocates the task's stack and TCB from the FreeRTOS heap.
+ * xTaskCreateStatic() instead uses the memory passed in by the application,
+ * so the RAM used by the task is fixed at link time and creating the task
+ * cannot fail for lack of heap.  The memory must remain valid for as long as
+ * the task exists, and is not freed if the task is deleted.
+ *
+ * @param pvTaskCode Pointer to the task entry function.  Tasks
+ * must be implemented to never return (i.e. continuous loop).
+ *
+ * @param pcName A descriptive name for the task.
+ *
+ * @param usStackDepth The number of StackType_t variables in pxStackBuffer.
+ *
+ * @param pvParameters Pointer that will be used as the parameter for the task
+ * being created.
+ *
+ * @param uxPriority The priority at which the task should run.
+ *
+ * @param pxStackBuffer Must point to a StackType_t array of at least
+ * usStackDepth entries, which will be used as the task's stack.
+ *
+ * @param pxTaskBuffer Must point to a StaticTask_t variable, which will be
+ * used to hold the task's data structures (its TCB).
+ *
+ * @return The handle of the created task, or NULL if either buffer was NULL.
+ *
+ * Example usage:
+   <pre>
+ #define STACK_SIZE 200
+
+ static StaticTask_t xTaskBuffer;
+ static StackType_t xStack[ STACK_SIZE ];
+
+ void vOtherFunction( void )
+ {
+ TaskHandle_t xHandle;
+
+	 xHandle = xTaskCreateStatic( vTaskCode, "NAME", STACK_SIZE, NULL, tskIDLE_PRIORITY, xStack, &xTaskBuffer );
+ }
+   </pre>
+ * \defgroup xTaskCreateStatic xTaskCreateStatic
+ * \ingroup Tasks
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, StackType_t * const puxStackBuffer, StaticTask_t * const pxTaskBuffer ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
 /**
  * task. h
  *<pre>
@@ -2022,6 +2139,16 @@ void vTaskStepTick( const TickType_t xTicksToJump ) PRIVILEGED_FUNCTION;
  */
 eSleepModeStatus eTaskConfirmSleepModeStatus( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Only available when configUSE_TICKLESS_IDLE is set to 1.
+ * Returns how many ticks will go by before a Blocked task is due to wake, or 0
+ * if a task other than the idle task is ready, the same figure the idle task
+ * passes to portSUPPRESS_TICKS_AND_SLEEP().  For a port whose idle task never
+ * runs, such as a simulator that moves virtual time on whenever every task is
+ * blocked, to suppress the tick in its place.
+ */
+TickType_t xTaskGetExpectedIdleTime( void ) PRIVILEGED_FUNCTION;
+
 /*
  * For internal use only.  Increment the mutex held count when a mutex is
  * taken and return the handle of the task that has taken the mutex.
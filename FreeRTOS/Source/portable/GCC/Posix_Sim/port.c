@@ -0,0 +1,493 @@
+/*
+    A single threaded, virtual time port of FreeRTOS for running an application
+    on a POSIX host.
+
+    1 tab == 4 spaces!
+*/
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for a POSIX host.
+ *
+ * Every task is a ucontext coroutine with a stack of its own taken from the
+ * C heap, and only one of them runs at a time.  Tasks take no time at all:
+ * the clock only moves on when every task is blocked, which is when the
+ * kernel would switch to the idle task.  Instead of running the idle task the
+ * port jumps virtual time straight to the next tick or simulated interrupt,
+ * runs it, and carries on until a task is ready again.  An hour of a mostly
+ * idle application is therefore simulated in the time its tasks take to run,
+ * and the same inputs always give the same schedule.
+ *
+ * The idle task is created as usual but never runs, so deleted tasks are
+ * never cleaned up and the idle hook is never called.  With
+ * configUSE_TICKLESS_IDLE set the port suppresses the tick in its place: it
+ * steps the tick count straight over the ticks that would wake no task, up to
+ * the one that does or to the next simulated interrupt, and counts them.
+ *----------------------------------------------------------*/
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+/* Scheduler include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Each task's real stack, the one its FreeRTOS stack only stands in for. */
+#define portTASK_STACK_BYTES		( 256 * 1024 )
+
+/* How many simulated interrupts the queue starts with room for. */
+#define portINITIAL_EVENTS			( 64 )
+
+/* A task's coroutine.  A pointer to it is kept in the top word of the task's
+FreeRTOS stack, which is where pxTopOfStack points. */
+typedef struct A_SIM_THREAD
+{
+	ucontext_t xContext;
+	TaskFunction_t pxCode;
+	void *pvParameters;
+} SimThread_t;
+
+/* A simulated interrupt waiting for its time to come. */
+typedef struct A_SIM_EVENT
+{
+	uint64_t ullTime;
+	uint64_t ullSequence;		/*<< Orders interrupts due at the same time. */
+	SimInterruptHandler_t pxHandler;
+	void *pvParameter;
+} SimEvent_t;
+
+/* The currently running task, its first member is pxTopOfStack. */
+extern void * volatile pxCurrentTCB;
+
+/* Non-zero while a simulated interrupt (or the tick) is being handled. */
+volatile UBaseType_t uxInterruptNesting = 0;
+
+/* Interrupts start masked, vTaskStartScheduler() expects them to be. */
+static volatile BaseType_t xInterruptsMasked = pdTRUE;
+
+/* A yield asked for while interrupts were masked. */
+static volatile BaseType_t xYieldPending = pdFALSE;
+
+/* Virtual time in microseconds, and when the next tick is due. */
+static uint64_t ullSimTime = 0;
+static uint64_t ullNextTick = portTICK_PERIOD_US;
+
+/* Simulated interrupts, as a binary heap ordered by time. */
+static SimEvent_t *pxEvents = NULL;
+static size_t xNumEvents = 0;
+static size_t xMaxEvents = 0;
+static uint64_t ullEventSequence = 0;
+
+/* Where vTaskEndScheduler() goes back to. */
+static ucontext_t xSchedulerContext;
+
+/* Ticks that went by with every task blocked and woke none of them, whether
+they were run or suppressed. */
+static uint32_t ulIdleTicks = 0UL;
+
+#if( configUSE_TICKLESS_IDLE == 1 )
+
+	/* How many times the tick was suppressed, and how many ticks that
+	skipped. */
+	static uint32_t ulTicklessSleeps = 0UL;
+	static uint32_t ulTicksSuppressed = 0UL;
+
+#endif /* configUSE_TICKLESS_IDLE */
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The coroutine every task starts in.
+ */
+static void prvTaskEntry( void );
+
+/*
+ * Used to catch tasks that attempt to return from their implementing function.
+ */
+static void prvTaskExitError( void );
+
+/*
+ * Switch to whichever task the kernel picks, moving time on first if that
+ * would be the idle task.
+ */
+static void prvSwitchTask( void );
+
+/*
+ * Run ticks and simulated interrupts, suppressing the tick where it can, until
+ * the kernel picks a task other than the idle task.
+ */
+static void prvRunUntilReady( void );
+
+/*
+ * Run the next tick or simulated interrupt.
+ */
+static void prvRunNextEvent( void );
+
+/*-----------------------------------------------------------*/
+
+static SimThread_t *prvThreadOf( void *pvTCB )
+{
+StackType_t *pxTopOfStack = *( StackType_t ** ) pvTCB;
+
+	return ( SimThread_t * ) *pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvIdleIsCurrent( void )
+{
+	return ( pxCurrentTCB == ( void * ) xTaskGetIdleTaskHandle() ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+SimThread_t *pxThread;
+
+	pxThread = malloc( sizeof( SimThread_t ) );
+	configASSERT( pxThread );
+
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+
+	getcontext( &( pxThread->xContext ) );
+	pxThread->xContext.uc_stack.ss_sp = malloc( portTASK_STACK_BYTES );
+	pxThread->xContext.uc_stack.ss_size = portTASK_STACK_BYTES;
+	pxThread->xContext.uc_link = NULL;
+	configASSERT( pxThread->xContext.uc_stack.ss_sp );
+	makecontext( &( pxThread->xContext ), prvTaskEntry, 0 );
+
+	*pxTopOfStack = ( StackType_t ) pxThread;
+	return pxTopOfStack;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTaskEntry( void )
+{
+SimThread_t *pxThread = prvThreadOf( pxCurrentTCB );
+
+	/* A task starts with interrupts enabled, like it would on hardware. */
+	xInterruptsMasked = pdFALSE;
+	pxThread->pxCode( pxThread->pvParameters );
+	prvTaskExitError();
+}
+/*-----------------------------------------------------------*/
+
+static void prvTaskExitError( void )
+{
+	/* A function that implements a task must not exit or attempt to return to
+	its caller as there is nothing to return to.  If a task wants to exit it
+	should instead call vTaskDelete( NULL ). */
+	configASSERT( uxInterruptNesting == ~0UL );
+	abort();
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortStartScheduler( void )
+{
+	/* Nothing may be ready yet, in which case time has to move on before the
+	first task can run. */
+	prvRunUntilReady();
+
+	xYieldPending = pdFALSE;
+	xInterruptsMasked = pdFALSE;
+	swapcontext( &xSchedulerContext, &( prvThreadOf( pxCurrentTCB )->xContext ) );
+
+	/* Back here when a task or interrupt calls vTaskEndScheduler(). */
+	return pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	/* The tasks' coroutines are left as they are, there is one run of the
+	scheduler per process. */
+	setcontext( &xSchedulerContext );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	if( ( uxInterruptNesting != 0 ) || ( xInterruptsMasked != pdFALSE ) )
+	{
+		/* Switch once the interrupt returns or interrupts are unmasked. */
+		xYieldPending = pdTRUE;
+	}
+	else
+	{
+		prvSwitchTask();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwitchTask( void )
+{
+SimThread_t *pxFrom = prvThreadOf( pxCurrentTCB ), *pxTo;
+
+	xInterruptsMasked = pdTRUE;
+	vTaskSwitchContext();
+
+	/* Every task is blocked.  Run ticks and interrupts on this task's stack
+	until one of them readies a task. */
+	prvRunUntilReady();
+
+	xYieldPending = pdFALSE;
+	xInterruptsMasked = pdFALSE;
+
+	pxTo = prvThreadOf( pxCurrentTCB );
+	if( pxTo != pxFrom )
+	{
+		swapcontext( &( pxFrom->xContext ), &( pxTo->xContext ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	xInterruptsMasked = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	xInterruptsMasked = pdFALSE;
+
+	if( ( xYieldPending != pdFALSE ) && ( uxInterruptNesting == 0 ) )
+	{
+		prvSwitchTask();
+	}
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortSetInterruptMaskFromISR( void )
+{
+UBaseType_t uxSavedStatus = ( UBaseType_t ) xInterruptsMasked;
+
+	xInterruptsMasked = pdTRUE;
+	return uxSavedStatus;
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMaskFromISR( UBaseType_t uxSavedStatus )
+{
+	/* Only restores the mask, a yield waits for the interrupt to return or
+	the critical section to end. */
+	xInterruptsMasked = ( BaseType_t ) uxSavedStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwapEvents( size_t xA, size_t xB )
+{
+SimEvent_t xTemp = pxEvents[ xA ];
+
+	pxEvents[ xA ] = pxEvents[ xB ];
+	pxEvents[ xB ] = xTemp;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvEventBefore( size_t xA, size_t xB )
+{
+	if( pxEvents[ xA ].ullTime != pxEvents[ xB ].ullTime )
+	{
+		return ( pxEvents[ xA ].ullTime < pxEvents[ xB ].ullTime ) ? pdTRUE : pdFALSE;
+	}
+
+	return ( pxEvents[ xA ].ullSequence < pxEvents[ xB ].ullSequence ) ? pdTRUE : pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimulateInterrupt( uint64_t ullTimeUs, SimInterruptHandler_t pxHandler, void *pvParameter )
+{
+size_t xChild, xParent;
+
+	/* An interrupt can't happen in the past. */
+	if( ullTimeUs < ullSimTime )
+	{
+		ullTimeUs = ullSimTime;
+	}
+
+	if( xNumEvents == xMaxEvents )
+	{
+		xMaxEvents = ( xMaxEvents == 0 ) ? portINITIAL_EVENTS : xMaxEvents * 2;
+		pxEvents = realloc( pxEvents, xMaxEvents * sizeof( SimEvent_t ) );
+		configASSERT( pxEvents );
+	}
+
+	xChild = xNumEvents++;
+	pxEvents[ xChild ].ullTime = ullTimeUs;
+	pxEvents[ xChild ].ullSequence = ullEventSequence++;
+	pxEvents[ xChild ].pxHandler = pxHandler;
+	pxEvents[ xChild ].pvParameter = pvParameter;
+
+	while( xChild > 0 )
+	{
+		xParent = ( xChild - 1 ) / 2;
+		if( prvEventBefore( xChild, xParent ) == pdFALSE )
+		{
+			break;
+		}
+		prvSwapEvents( xChild, xParent );
+		xChild = xParent;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static SimEvent_t prvPopEvent( void )
+{
+SimEvent_t xFirst = pxEvents[ 0 ];
+size_t xParent = 0, xChild;
+
+	pxEvents[ 0 ] = pxEvents[ --xNumEvents ];
+
+	for( ;; )
+	{
+		xChild = xParent * 2 + 1;
+		if( xChild >= xNumEvents )
+		{
+			break;
+		}
+		if( ( xChild + 1 < xNumEvents ) && ( prvEventBefore( xChild + 1, xChild ) != pdFALSE ) )
+		{
+			xChild++;
+		}
+		if( prvEventBefore( xChild, xParent ) == pdFALSE )
+		{
+			break;
+		}
+		prvSwapEvents( xChild, xParent );
+		xParent = xChild;
+	}
+
+	return xFirst;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunUntilReady( void )
+{
+BaseType_t xTick;
+
+	while( prvIdleIsCurrent() != pdFALSE )
+	{
+		#if( configUSE_TICKLESS_IDLE == 1 )
+		{
+		TickType_t xExpectedIdleTime;
+
+			/* What the idle task would do if it ran.  Nothing else runs until
+			this returns, so there is no need to suspend the scheduler. */
+			xExpectedIdleTime = xTaskGetExpectedIdleTime();
+
+			if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
+			{
+				portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime );
+			}
+		}
+		#endif /* configUSE_TICKLESS_IDLE */
+
+		/* A tick that leaves every task blocked is one that woke nothing. */
+		xTick = ( ( xNumEvents == 0 ) || ( pxEvents[ 0 ].ullTime > ullNextTick ) ) ? pdTRUE : pdFALSE;
+		prvRunNextEvent();
+		vTaskSwitchContext();
+
+		if( ( xTick != pdFALSE ) && ( prvIdleIsCurrent() != pdFALSE ) )
+		{
+			ulIdleTicks++;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunNextEvent( void )
+{
+SimEvent_t xEvent;
+
+	uxInterruptNesting++;
+
+	/* Interrupts due at the same time as the tick run first. */
+	if( ( xNumEvents > 0 ) && ( pxEvents[ 0 ].ullTime <= ullNextTick ) )
+	{
+		xEvent = prvPopEvent();
+		ullSimTime = xEvent.ullTime;
+		xEvent.pxHandler( xEvent.pvParameter );
+	}
+	else
+	{
+		ullSimTime = ullNextTick;
+		ullNextTick += portTICK_PERIOD_US;
+		xTaskIncrementTick();
+	}
+
+	uxInterruptNesting--;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullPortGetSimTime( void )
+{
+	return ullSimTime;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulPortGetIdleTicks( void )
+{
+	return ulIdleTicks;
+}
+/*-----------------------------------------------------------*/
+
+#if( configUSE_TICKLESS_IDLE == 1 )
+
+	/*
+	 * Called in place of the idle task when no task is due to wake for
+	 * xExpectedIdleTime ticks.  Every tick up to the one that wakes a task is
+	 * skipped, unless a simulated interrupt comes first, in which case only
+	 * the ticks before it are.  Virtual time is left at the last tick skipped,
+	 * and the caller then runs the tick or interrupt that ends the sleep.
+	 */
+	void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	uint32_t ulCompleteTickPeriods = ( uint32_t ) xExpectedIdleTime - 1UL;
+	uint64_t ullInterruptTime;
+
+		if( eTaskConfirmSleepModeStatus() == eAbortSleep )
+		{
+			return;
+		}
+
+		/* Interrupts due at the same time as a tick run before it, so the
+		ticks skipped are those due before the interrupt. */
+		if( xNumEvents > 0 )
+		{
+			ullInterruptTime = pxEvents[ 0 ].ullTime;
+
+			if( ullInterruptTime <= ullNextTick )
+			{
+				ulCompleteTickPeriods = 0UL;
+			}
+			else if( ( ullInterruptTime - ullNextTick ) < ( uint64_t ) ulCompleteTickPeriods * portTICK_PERIOD_US )
+			{
+				ulCompleteTickPeriods = ( uint32_t ) ( ( ullInterruptTime - ullNextTick + portTICK_PERIOD_US - 1 ) / portTICK_PERIOD_US );
+			}
+		}
+
+		if( ulCompleteTickPeriods == 0UL )
+		{
+			return;
+		}
+
+		ullNextTick += ( uint64_t ) ulCompleteTickPeriods * portTICK_PERIOD_US;
+		ullSimTime = ullNextTick - portTICK_PERIOD_US;
+		vTaskStepTick( ( TickType_t ) ulCompleteTickPeriods );
+
+		ulTicklessSleeps++;
+		ulTicksSuppressed += ulCompleteTickPeriods;
+		ulIdleTicks += ulCompleteTickPeriods;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortGetTicklessStats( uint32_t *pulSleeps, uint32_t *pulTicksSuppressed )
+	{
+		/* Tasks only read these while no tick or interrupt can run. */
+		*pulSleeps = ulTicklessSleeps;
+		*pulTicksSuppressed = ulTicksSuppressed;
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
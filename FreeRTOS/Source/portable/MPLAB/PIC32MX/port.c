@@ -121,6 +121,22 @@ override this behaviour by:
 	#endif
 #endif
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+
+	/* The number of timer 1 counts that make up one tick period. */
+	#define portTIMER_COUNTS_PER_TICK	( ( configPERIPHERAL_CLOCK_HZ / portTIMER_PRESCALE ) / configTICK_RATE_HZ )
+
+	/* The longest time the 16-bit timer 1 can be left to count before it
+	overflows, in whole tick periods. */
+	#define portMAX_SUPPRESSED_TICKS	( ( TickType_t ) ( 0x10000UL / portTIMER_COUNTS_PER_TICK ) )
+
+	/* How many times the idle task has slept with the tick suppressed, and how
+	many tick interrupts that saved. */
+	static volatile uint32_t ulTicklessSleeps = 0UL;
+	static volatile uint32_t ulTicksSuppressed = 0UL;
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /* Let the user override the pre-loading of the initial RA with the address of
 prvTaskExitError() in case it messes up unwinding of the stack in the
 debugger - in which case configTASK_RETURN_ADDRESS can be defined as 0 (NULL). */
@@ -368,7 +384,103 @@ void vPortClearInterruptMaskFromISR( UBaseType_t uxSavedStatusRegister )
 }
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+
+	/*
+	 * Called by the idle task, with the scheduler suspended, when no task needs
+	 * to run for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks.  Timer 1
+	 * is left counting from where it is in the current tick period, but its
+	 * period is stretched to cover the whole expected idle time, and the CPU
+	 * executes WAIT to enter Idle mode until the next interrupt.  Idle mode
+	 * rather than Sleep mode is used because Sleep mode would stop the
+	 * peripheral bus clock that timer 1 runs from.  On waking the kernel is told
+	 * how many tick periods went by without a tick interrupt.  The function is
+	 * weak so an application can provide a version that, for example, also
+	 * turns peripherals off.
+	 */
+	__attribute__(( weak )) void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	uint32_t ulCount, ulCompleteTickPeriods;
 
+		/* WAIT enters Idle mode rather than Sleep mode while OSCCON.SLPEN is
+		clear, which is its reset value. */
+		configASSERT( OSCCONbits.SLPEN == 0 );
 
+		if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+		{
+			xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+		}
 
+		/* Nothing may run between deciding to sleep and changing the timer
+		period.  Timer 1 is stopped so its count cannot pass the new period
+		while it is being written.  A few cycles are lost while it is stopped,
+		so the tick drifts very slightly each time the idle task sleeps. */
+		portDISABLE_INTERRUPTS();
+		T1CONbits.TON = 0;
+
+		/* Don't sleep if a task was readied or a yield was pended since the
+		scheduler was suspended, or if the tick interrupt is already due - it
+		has to run to keep the tick count right. */
+		if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( IFS0bits.T1IF != 0 ) )
+		{
+			T1CONbits.TON = 1;
+			portENABLE_INTERRUPTS();
+			return;
+		}
+
+		/* The timer is part way through the current tick period, so the match
+		comes at the end of the last expected idle tick period without changing
+		the count.  The count is below one period, so it is below the new
+		period too. */
+		PR1 = ( ( uint32_t ) xExpectedIdleTime * portTIMER_COUNTS_PER_TICK ) - 1UL;
+		T1CONbits.TON = 1;
+
+		/* Interrupts must be unmasked for an interrupt to bring the CPU out of
+		Idle mode.  If one is taken between unmasking and WAIT, the CPU sleeps
+		until the next interrupt, which is no later than the timer 1 match. */
+		portENABLE_INTERRUPTS();
+		__asm volatile ( "wait" );
 
+		portDISABLE_INTERRUPTS();
+		T1CONbits.TON = 0;
+
+		if( IFS0bits.T1IF != 0 )
+		{
+			/* The whole expected idle time went by.  The pending tick interrupt
+			accounts for the last tick period when interrupts are unmasked, and
+			the count is already running through the tick period after it. */
+			ulCompleteTickPeriods = ( uint32_t ) xExpectedIdleTime - 1UL;
+		}
+		else
+		{
+			/* Something other than the tick woke the CPU.  Account for the tick
+			periods that completed and carry on through the one in progress. */
+			ulCount = TMR1;
+			ulCompleteTickPeriods = ulCount / portTIMER_COUNTS_PER_TICK;
+			TMR1 = ulCount % portTIMER_COUNTS_PER_TICK;
+		}
+
+		PR1 = portTIMER_COUNTS_PER_TICK - 1UL;
+		T1CONbits.TON = 1;
+
+		vTaskStepTick( ( TickType_t ) ulCompleteTickPeriods );
+
+		ulTicklessSleeps++;
+		ulTicksSuppressed += ulCompleteTickPeriods;
+
+		portENABLE_INTERRUPTS();
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortGetTicklessStats( uint32_t *pulSleeps, uint32_t *pulTicksSuppressed )
+	{
+		portENTER_CRITICAL();
+		{
+			*pulSleeps = ulTicklessSleeps;
+			*pulTicksSuppressed = ulTicksSuppressed;
+		}
+		portEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
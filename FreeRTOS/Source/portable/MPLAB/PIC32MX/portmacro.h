@@ -223,6 +223,16 @@ extern volatile UBaseType_t uxInterruptNesting;
 
 /*-----------------------------------------------------------*/
 
+/* Tickless idle.  The idle task stretches the timer 1 period and waits in Idle
+mode instead of taking a tick interrupt every tick period. */
+#if( configUSE_TICKLESS_IDLE == 1 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	extern void vPortGetTicklessStats( uint32_t *pulSleeps, uint32_t *pulTicksSuppressed );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
+
+/*-----------------------------------------------------------*/
+
 /* Task function macros as described on the FreeRTOS.org WEB site. */
 #define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters ) __attribute__((noreturn))
 #define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
@@ -0,0 +1,662 @@
+/*
+    A two level segregated fit (TLSF) implementation of pvPortMalloc() and
+    vPortFree() for use with FreeRTOS.
+
+    1 tab == 4 spaces!
+*/
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that, like
+ * heap_4.c, combines adjacent free blocks as they are freed, but finds and
+ * releases blocks in constant time.
+ *
+ * Free blocks are kept in an array of segregated lists.  The first level
+ * splits block sizes by power of two, the second level splits each power of
+ * two range into heapSL_INDEX_COUNT linear slices.  A bitmap per level records
+ * which lists are non-empty, so a suitable block is found with two find-first-
+ * set operations instead of walking a list.  Only when no larger list has a
+ * block is the one list the request maps to walked, so requests for nearly all
+ * of the remaining heap can still be met.  Every block also records its
+ * physical neighbour so it can be merged with the blocks either side of it
+ * when it is freed, again without walking a list.
+ *
+ * See heap_1.c, heap_2.c, heap_3.c and heap_4.c for alternative
+ * implementations, and the memory management pages of http://www.FreeRTOS.org
+ * for more information.
+ */
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* log2 of the number of second level lists per first level range.  Eight
+lists keeps the worst case internal fragmentation of a search below 12.5%. */
+#define heapSL_INDEX_COUNT_LOG2		( 3 )
+#define heapSL_INDEX_COUNT			( 1UL << heapSL_INDEX_COUNT_LOG2 )
+
+/* Blocks smaller than heapSMALL_BLOCK_SIZE all share the first first level
+list, split linearly into heapSL_INDEX_COUNT slices of portBYTE_ALIGNMENT. */
+#define heapFL_INDEX_SHIFT			( heapSL_INDEX_COUNT_LOG2 + 3 )
+#define heapSMALL_BLOCK_SIZE		( ( size_t ) 1 << heapFL_INDEX_SHIFT )
+
+/* First level list 0 holds the small blocks, and list n > 0 the blocks whose
+highest set bit is n + heapFL_INDEX_SHIFT - 1, up to and including bit
+heapFL_INDEX_MAX.  The largest block the lists can hold is therefore just under
+2 ^ ( heapFL_INDEX_MAX + 1 ) bytes, which comfortably covers the heap sizes
+used on the PIC32. */
+#define heapFL_INDEX_MAX			( 16 )
+#define heapFL_INDEX_COUNT			( heapFL_INDEX_MAX - heapFL_INDEX_SHIFT + 2 )
+
+/* The bottom bit of xBlockSize is set while a block is on a free list.  Block
+sizes are always a multiple of portBYTE_ALIGNMENT so the bit is never part of
+the size itself. */
+#define heapBLOCK_FREE_BIT			( ( size_t ) 1 )
+#define heapBLOCK_SIZE( pxBlock )	( ( pxBlock )->xBlockSize & ~heapBLOCK_FREE_BIT )
+#define heapBLOCK_IS_FREE( pxBlock )	( ( ( pxBlock )->xBlockSize & heapBLOCK_FREE_BIT ) != 0 )
+
+/* Allocate the memory for the heap. */
+#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+	/* The application writer has already defined the array used for the RTOS
+	heap - probably so it can be placed in a special segment or address. */
+	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* The header placed at the start of every block.  Only pxPrevPhysBlock and
+xBlockSize are kept once the block has been handed to the application, the two
+free list links overlay the start of the application's memory. */
+typedef struct A_TLSF_BLOCK
+{
+	struct A_TLSF_BLOCK *pxPrevPhysBlock;	/*<< The block immediately below this one in memory, NULL for the first block. */
+	size_t xBlockSize;						/*<< The size of the block including this header, plus heapBLOCK_FREE_BIT. */
+	struct A_TLSF_BLOCK *pxNextFreeBlock;	/*<< The next block on the same free list (free blocks only). */
+	struct A_TLSF_BLOCK *pxPrevFreeBlock;	/*<< The previous block on the same free list (free blocks only). */
+} TLSFBlock_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Called automatically to setup the required heap structures the first time
+ * pvPortMalloc() is called.
+ */
+static void prvHeapInit( void );
+
+/*
+ * Work out which free list a block of xSize bytes belongs on.
+ */
+static void prvMappingInsert( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL );
+
+/*
+ * Find a free block of at least xSize bytes, without taking it off its list.
+ * Returns NULL if there is no such block.
+ */
+static TLSFBlock_t *prvFindSuitableBlock( size_t xSize );
+
+/*
+ * Add a free block to, or remove it from, the free list for its size.
+ */
+static void prvInsertFreeBlock( TLSFBlock_t *pxBlock );
+static void prvRemoveFreeBlock( TLSFBlock_t *pxBlock );
+
+/*
+ * Index of the highest and lowest set bit of a non-zero value.
+ */
+static UBaseType_t prvFindLastSet( size_t xValue );
+static UBaseType_t prvFindFirstSet( uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+/* The part of the header that remains while a block is allocated, rounded up
+so the application's memory stays correctly aligned. */
+static const size_t xHeapStructSize	= ( offsetof( TLSFBlock_t, pxNextFreeBlock ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* A free block has to be able to hold the whole header. */
+static const size_t xMinimumBlockSize = ( sizeof( TLSFBlock_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* The free lists and the bitmaps that say which of them hold blocks. */
+static TLSFBlock_t *pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+static uint32_t ulFLBitmap = 0U;
+static uint32_t ulSLBitmap[ heapFL_INDEX_COUNT ];
+
+/* Zero sized block that marks the end of the heap so the last real block is
+never merged with memory that does not belong to the heap. */
+static TLSFBlock_t *pxEnd = NULL;
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+TLSFBlock_t *pxBlock, *pxNewBlock, *pxNextBlock;
+size_t xBlockSize;
+void *pvReturn = NULL;
+
+	vTaskSuspendAll();
+	{
+		/* If this is the first call to malloc then the heap will require
+		initialisation to setup the list of free blocks. */
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ( xWantedSize > 0 ) && ( xWantedSize < configTOTAL_HEAP_SIZE ) )
+		{
+			/* The wanted size is increased so it can contain the block header
+			in addition to the requested amount of bytes, and rounded up so the
+			next block stays aligned. */
+			xWantedSize += xHeapStructSize;
+
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				/* Byte alignment required. */
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+				configASSERT( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) == 0 );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize <= xFreeBytesRemaining )
+			{
+				pxBlock = prvFindSuitableBlock( xWantedSize );
+			}
+			else
+			{
+				pxBlock = NULL;
+			}
+
+			if( pxBlock != NULL )
+			{
+				prvRemoveFreeBlock( pxBlock );
+				xBlockSize = heapBLOCK_SIZE( pxBlock );
+
+				/* If the block is larger than required it can be split into
+				two, and the remainder goes back on a free list. */
+				if( ( xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+				{
+					pxNewBlock = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+					configASSERT( ( ( ( size_t ) pxNewBlock ) & portBYTE_ALIGNMENT_MASK ) == 0 );
+
+					pxNewBlock->xBlockSize = xBlockSize - xWantedSize;
+					pxNewBlock->pxPrevPhysBlock = pxBlock;
+
+					pxNextBlock = ( void * ) ( ( ( uint8_t * ) pxNewBlock ) + pxNewBlock->xBlockSize );
+					pxNextBlock->pxPrevPhysBlock = pxNewBlock;
+
+					xBlockSize = xWantedSize;
+					prvInsertFreeBlock( pxNewBlock );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* The block is being returned - it is allocated and owned by
+				the application. */
+				pxBlock->xBlockSize = xBlockSize;
+				xFreeBytesRemaining -= xBlockSize;
+
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Return the memory space pointed to - jumping over the block
+				header at its start. */
+				pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	configASSERT( ( ( ( size_t ) pvReturn ) & portBYTE_ALIGNMENT_MASK ) == 0 );
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+TLSFBlock_t *pxBlock, *pxNeighbour;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have a block header immediately before
+		it. */
+		puc -= xHeapStructSize;
+
+		/* This casting is to keep the compiler from issuing warnings. */
+		pxBlock = ( void * ) puc;
+
+		/* Check the block is actually allocated. */
+		configASSERT( !heapBLOCK_IS_FREE( pxBlock ) );
+
+		if( !heapBLOCK_IS_FREE( pxBlock ) )
+		{
+			vTaskSuspendAll();
+			{
+				xFreeBytesRemaining += pxBlock->xBlockSize;
+				traceFREE( pv, pxBlock->xBlockSize );
+
+				/* Merge with the block below if it is free. */
+				pxNeighbour = pxBlock->pxPrevPhysBlock;
+				if( ( pxNeighbour != NULL ) && heapBLOCK_IS_FREE( pxNeighbour ) )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxNeighbour->xBlockSize = heapBLOCK_SIZE( pxNeighbour ) + pxBlock->xBlockSize;
+					pxBlock = pxNeighbour;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Merge with the block above if it is free.  The end marker is
+				never free so this cannot run off the end of the heap. */
+				pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize );
+				if( heapBLOCK_IS_FREE( pxNeighbour ) )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxBlock->xBlockSize += heapBLOCK_SIZE( pxNeighbour );
+					pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxNeighbour->pxPrevPhysBlock = pxBlock;
+				prvInsertFreeBlock( pxBlock );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeBlockHistogram( UBaseType_t *puxCounts, UBaseType_t uxBins )
+{
+UBaseType_t uxFL, uxSL, uxBin;
+TLSFBlock_t *pxBlock;
+size_t xBlockSize, xLargest = 0;
+
+	for( uxBin = 0; uxBin < uxBins; uxBin++ )
+	{
+		puxCounts[ uxBin ] = 0;
+	}
+
+	vTaskSuspendAll();
+	{
+		/* This walks every free block, so unlike the allocator itself it is
+		not constant time.  It is only meant for diagnostics. */
+		for( uxFL = 0; uxFL < heapFL_INDEX_COUNT; uxFL++ )
+		{
+			for( uxSL = 0; uxSL < heapSL_INDEX_COUNT; uxSL++ )
+			{
+				for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+				{
+					xBlockSize = heapBLOCK_SIZE( pxBlock );
+					uxBin = prvFindLastSet( xBlockSize );
+
+					if( uxBin >= uxBins )
+					{
+						uxBin = uxBins - 1;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					puxCounts[ uxBin ]++;
+
+					if( xBlockSize > xLargest )
+					{
+						xLargest = xBlockSize;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	/* Report what the application could actually use of the block. */
+	if( xLargest > xHeapStructSize )
+	{
+		xLargest -= xHeapStructSize;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xLargest;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+TLSFBlock_t *pxFirstFreeBlock;
+size_t uxAddress;
+size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
+
+	/* Ensure the heap starts on a correctly aligned boundary. */
+	uxAddress = ( size_t ) ucHeap;
+
+	if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+	{
+		uxAddress += ( portBYTE_ALIGNMENT - 1 );
+		uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xTotalHeapSize -= uxAddress - ( size_t ) ucHeap;
+	}
+
+	/* configTOTAL_HEAP_SIZE is too large for the free lists, increase
+	heapFL_INDEX_MAX. */
+	configASSERT( xTotalHeapSize < ( ( size_t ) 1 << ( heapFL_INDEX_MAX + 1 ) ) );
+
+	pxFirstFreeBlock = ( void * ) uxAddress;
+
+	/* pxEnd marks the end of the heap.  It is never free, so the block below
+	it is never merged past the end of the heap. */
+	uxAddress += xTotalHeapSize;
+	uxAddress -= xHeapStructSize;
+	uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+	pxEnd = ( void * ) uxAddress;
+	pxEnd->xBlockSize = 0;
+
+	/* To start with there is a single free block that is sized to take up the
+	entire heap space, minus the space taken by pxEnd. */
+	pxFirstFreeBlock->pxPrevPhysBlock = NULL;
+	pxFirstFreeBlock->xBlockSize = uxAddress - ( size_t ) pxFirstFreeBlock;
+	pxEnd->pxPrevPhysBlock = pxFirstFreeBlock;
+
+	/* Only one block exists - and it covers the entire usable heap space. */
+	xMinimumEverFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+	xFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+
+	prvInsertFreeBlock( pxFirstFreeBlock );
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindLastSet( size_t xValue )
+{
+	configASSERT( xValue != 0 );
+
+	#if defined( __GNUC__ )
+	{
+		return ( UBaseType_t ) ( ( sizeof( unsigned long ) * 8 ) - 1 - __builtin_clzl( ( unsigned long ) xValue ) );
+	}
+	#else
+	{
+	UBaseType_t uxBit = 0;
+
+		while( ( xValue >>= 1 ) != 0 )
+		{
+			uxBit++;
+		}
+
+		return uxBit;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindFirstSet( uint32_t ulValue )
+{
+	/* Isolate the lowest set bit, then find its position. */
+	return prvFindLastSet( ( size_t ) ( ulValue & ( ~ulValue + 1U ) ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMappingInsert( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL )
+{
+UBaseType_t uxFL;
+
+	if( xSize < heapSMALL_BLOCK_SIZE )
+	{
+		/* Small blocks are split linearly across the first list. */
+		*puxFL = 0;
+		*puxSL = ( UBaseType_t ) ( xSize / ( heapSMALL_BLOCK_SIZE / heapSL_INDEX_COUNT ) );
+	}
+	else
+	{
+		uxFL = prvFindLastSet( xSize );
+		*puxSL = ( UBaseType_t ) ( ( xSize >> ( uxFL - heapSL_INDEX_COUNT_LOG2 ) ) ^ heapSL_INDEX_COUNT );
+		*puxFL = uxFL - ( heapFL_INDEX_SHIFT - 1 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static TLSFBlock_t *prvFindSuitableBlock( size_t xSize )
+{
+UBaseType_t uxFL, uxSL;
+uint32_t ulMap;
+size_t xRoundedSize = xSize;
+TLSFBlock_t *pxBlock;
+
+	/* Round the size up to the next list boundary, so any block on the list
+	found is guaranteed to be big enough and the first one can be taken. */
+	if( xSize >= heapSMALL_BLOCK_SIZE )
+	{
+		xRoundedSize += ( ( size_t ) 1 << ( prvFindLastSet( xSize ) - heapSL_INDEX_COUNT_LOG2 ) ) - 1;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	prvMappingInsert( xRoundedSize, &uxFL, &uxSL );
+
+	if( uxFL < heapFL_INDEX_COUNT )
+	{
+		/* Look for a list at least this big in the same first level range... */
+		ulMap = ulSLBitmap[ uxFL ] & ( ~0UL << uxSL );
+
+		if( ulMap == 0 )
+		{
+			/* ...otherwise take the smallest list in any larger range. */
+			ulMap = ulFLBitmap & ( ~0UL << ( uxFL + 1 ) );
+
+			if( ulMap != 0 )
+			{
+				uxFL = prvFindFirstSet( ulMap );
+				ulMap = ulSLBitmap[ uxFL ];
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ulMap != 0 )
+		{
+			uxSL = prvFindFirstSet( ulMap );
+			return pxFreeLists[ uxFL ][ uxSL ];
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	/* Nothing in the larger lists.  The list the request itself maps to may
+	still hold a block big enough, which matters when the heap is nearly full,
+	so fall back to a first fit walk of that one list. */
+	prvMappingInsert( xSize, &uxFL, &uxSL );
+
+	for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+	{
+		if( heapBLOCK_SIZE( pxBlock ) >= xSize )
+		{
+			break;
+		}
+	}
+
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TLSFBlock_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+TLSFBlock_t *pxHead;
+
+	prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFL, &uxSL );
+	configASSERT( uxFL < heapFL_INDEX_COUNT );
+
+	/* Push onto the front of the list. */
+	pxHead = pxFreeLists[ uxFL ][ uxSL ];
+	pxBlock->pxNextFreeBlock = pxHead;
+	pxBlock->pxPrevFreeBlock = NULL;
+
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFreeBlock = pxBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxFreeLists[ uxFL ][ uxSL ] = pxBlock;
+	ulFLBitmap |= ( 1UL << uxFL );
+	ulSLBitmap[ uxFL ] |= ( 1UL << uxSL );
+
+	pxBlock->xBlockSize |= heapBLOCK_FREE_BIT;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( TLSFBlock_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+
+	prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFL, &uxSL );
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock->pxPrevFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock->pxPrevFreeBlock != NULL )
+	{
+		pxBlock->pxPrevFreeBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		/* The block was the head of its list. */
+		pxFreeLists[ uxFL ][ uxSL ] = pxBlock->pxNextFreeBlock;
+
+		if( pxFreeLists[ uxFL ][ uxSL ] == NULL )
+		{
+			ulSLBitmap[ uxFL ] &= ~( 1UL << uxSL );
+
+			if( ulSLBitmap[ uxFL ] == 0 )
+			{
+				ulFLBitmap &= ~( 1UL << uxFL );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	pxBlock->xBlockSize &= ~heapBLOCK_FREE_BIT;
+}
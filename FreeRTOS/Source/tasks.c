@@ -110,6 +110,14 @@ functions but without including stdio.h here. */
  */
 #define tskIDLE_STACK_SIZE	configMINIMAL_STACK_SIZE
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* Bits set in the ucStaticallyAllocated member of the TCB to record which
+	parts of the task were provided by the application, and so must not be
+	freed if the task is deleted. */
+	#define tskSTATICALLY_ALLOCATED_STACK	( ( uint8_t ) 0x01 )
+	#define tskSTATICALLY_ALLOCATED_TCB		( ( uint8_t ) 0x02 )
+#endif
+
 #if( configUSE_PREEMPTION == 0 )
 	/* If the cooperative scheduler is being used then a yield should not be
 	performed just because a higher priority task has been woken. */
@@ -192,12 +200,22 @@ typedef struct tskTaskControlBlock
 		volatile eNotifyValue eNotifyState;
 	#endif
 
+	#if ( configSUPPORT_STATIC_ALLOCATION == 1 )
+		uint8_t			ucStaticallyAllocated;	/*< Combination of tskSTATICALLY_ALLOCATED_STACK and tskSTATICALLY_ALLOCATED_TCB so the memory is not freed if the task is deleted. */
+	#endif
+
 } tskTCB;
 
 /* The old tskTCB name is maintained above then typedefed to the new TCB_t name
 below to enable the use of older kernel aware debuggers. */
 typedef tskTCB TCB_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* StaticTask_t mirrors TCB_t so the application can allocate the memory
+	without having access to the TCB definition. */
+	portSTATIC_ASSERT( sizeof( StaticTask_t ) == sizeof( TCB_t ), xStaticTaskSizeCheck );
+#endif
+
 /*
  * Some kernel aware debuggers require the data the debugger needs access to to
  * be global, rather than file scope.
@@ -213,10 +231,24 @@ PRIVILEGED_DATA TCB_t * volatile pxCurrentTCB = NULL;
 
 /* Lists for ready and blocked tasks. --------------------*/
 PRIVILEGED_DATA static List_t pxReadyTasksLists[ configMAX_PRIORITIES ];/*< Prioritised ready tasks. */
-PRIVILEGED_DATA static List_t xDelayedTaskList1;						/*< Delayed tasks. */
-PRIVILEGED_DATA static List_t xDelayedTaskList2;						/*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
-PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;				/*< Points to the delayed task list currently being used. */
-PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList;		/*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+
+	PRIVILEGED_DATA static List_t xDelayedTaskList1;						/*< Delayed tasks. */
+	PRIVILEGED_DATA static List_t xDelayedTaskList2;						/*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
+	PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;				/*< Points to the delayed task list currently being used. */
+	PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList;		/*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+
+#else
+
+	/* Delayed tasks are hashed into a slot of the wheel by the low bits of
+	their wake time.  The slots are not sorted, so adding a task is O(1), and
+	each tick only the slot for that tick has to be looked at.  A slot can also
+	hold tasks that are due on a later turn of the wheel, which are skipped. */
+	PRIVILEGED_DATA static List_t xDelayWheel[ configDELAY_WHEEL_SLOTS ];		/*< Delayed tasks, hashed by wake time. */
+	PRIVILEGED_DATA static TickType_t xDelayWheelTick = ( TickType_t ) 0U;		/*< The last tick whose slot has been checked for tasks to unblock. */
+	PRIVILEGED_DATA static BaseType_t xNextTaskUnblockTimeValid = pdFALSE;		/*< pdTRUE while xNextTaskUnblockTime is known to be no later than the next wake time. */
+
+#endif /* configUSE_DELAY_TIMING_WHEEL */
 PRIVILEGED_DATA static List_t xPendingReadyList;						/*< Tasks that have been readied while the scheduler was suspended.  They will be moved to the ready list when the scheduler is resumed. */
 
 #if ( INCLUDE_vTaskDelete == 1 )
@@ -364,6 +396,8 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 
 /*-----------------------------------------------------------*/
 
+#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+
 /* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
 count overflows. */
 #define taskSWITCH_DELAYED_LISTS()																	\
@@ -380,6 +414,19 @@ count overflows. */
 	prvResetNextTaskUnblockTime();																	\
 }
 
+#else
+
+/* The wheel holds wake times modulo the tick count, so there is no overflow
+list, only the overflow count used by the time out functions needs updating. */
+#define taskSWITCH_DELAYED_LISTS()																	\
+{																									\
+	xNumOfOverflows++;																				\
+}
+
+#define taskDELAY_WHEEL_MASK	( ( TickType_t ) configDELAY_WHEEL_SLOTS - ( TickType_t ) 1 )
+
+#endif /* configUSE_DELAY_TIMING_WHEEL */
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -423,6 +470,10 @@ to its original value when it is released. */
 	extern void vApplicationTickHook( void );
 #endif
 
+#if configSUPPORT_STATIC_ALLOCATION == 1
+	extern void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint16_t *pusIdleTaskStackSize );
+#endif
+
 /* File private functions. --------------------------------*/
 
 /*
@@ -489,7 +540,14 @@ static void prvAddCurrentTaskToDelayedList( const TickType_t xTimeToWake ) PRIVI
  * Allocates memory from the heap for a TCB and associated stack.  Checks the
  * allocation was successful.
  */
-static TCB_t *prvAllocateTCBAndStack( const uint16_t usStackDepth, StackType_t * const puxStackBuffer ) PRIVILEGED_FUNCTION;
+static TCB_t *prvAllocateTCBAndStack( const uint16_t usStackDepth, StackType_t * const puxStackBuffer, TCB_t * const pxTCBBuffer ) PRIVILEGED_FUNCTION;
+
+/*
+ * Common implementation of xTaskGenericCreate() and xTaskCreateStatic().  If
+ * pxTCBBuffer is not NULL then it is used to hold the TCB, otherwise the TCB
+ * is allocated from the FreeRTOS heap.
+ */
+static BaseType_t prvTaskGenericCreate( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, StackType_t * const puxStackBuffer, const MemoryRegion_t * const xRegions, TCB_t * const pxTCBBuffer ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 
 /*
  * Fills an TaskStatus_t structure with information on each task that is
@@ -537,6 +595,25 @@ static TCB_t *prvAllocateTCBAndStack( const uint16_t usStackDepth, StackType_t *
  */
 static void prvResetNextTaskUnblockTime( void );
 
+#if( configUSE_DELAY_TIMING_WHEEL == 1 )
+
+	/*
+	 * Unblock every task on the wheel whose wake time has been reached since
+	 * the wheel was last checked.  Returns pdTRUE if a context switch is
+	 * required.
+	 */
+	static BaseType_t prvCheckDelayWheel( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Search the wheel for the earliest wake time and store it in
+	 * xNextTaskUnblockTime.  Only tickless idle needs the exact value.
+	 */
+	#if( configUSE_TICKLESS_IDLE != 0 )
+	static void prvFindNextTaskUnblockTime( void ) PRIVILEGED_FUNCTION;
+	#endif
+
+#endif /* configUSE_DELAY_TIMING_WHEEL */
+
 #if ( ( configUSE_TRACE_FACILITY == 1 ) && ( configUSE_STATS_FORMATTING_FUNCTIONS > 0 ) )
 
 	/*
@@ -549,6 +626,29 @@ static void prvResetNextTaskUnblockTime( void );
 /*-----------------------------------------------------------*/
 
 BaseType_t xTaskGenericCreate( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, StackType_t * const puxStackBuffer, const MemoryRegion_t * const xRegions ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+{
+	return prvTaskGenericCreate( pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, puxStackBuffer, xRegions, NULL );
+}
+/*-----------------------------------------------------------*/
+
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, StackType_t * const puxStackBuffer, StaticTask_t * const pxTaskBuffer ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+	TaskHandle_t xCreatedTask = NULL;
+
+		configASSERT( puxStackBuffer != NULL );
+		configASSERT( pxTaskBuffer != NULL );
+
+		( void ) prvTaskGenericCreate( pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, &xCreatedTask, puxStackBuffer, NULL, ( TCB_t * ) pxTaskBuffer ); /*lint !e740 Unusual cast is ok as the structures are designed to have the same alignment, and the size is checked by an assert. */
+
+		return xCreatedTask;
+	}
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvTaskGenericCreate( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask, StackType_t * const puxStackBuffer, const MemoryRegion_t * const xRegions, TCB_t * const pxTCBBuffer ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 {
 BaseType_t xReturn;
 TCB_t * pxNewTCB;
@@ -559,7 +659,7 @@ StackType_t *pxTopOfStack;
 
 	/* Allocate the memory required by the TCB and stack for the new task,
 	checking that the allocation was successful. */
-	pxNewTCB = prvAllocateTCBAndStack( usStackDepth, puxStackBuffer );
+	pxNewTCB = prvAllocateTCBAndStack( usStackDepth, puxStackBuffer, pxTCBBuffer );
 
 	if( pxNewTCB != NULL )
 	{
@@ -1006,7 +1106,11 @@ StackType_t *pxTopOfStack;
 			}
 			taskEXIT_CRITICAL();
 
-			if( ( pxStateList == pxDelayedTaskList ) || ( pxStateList == pxOverflowDelayedTaskList ) )
+			#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+				if( ( pxStateList == pxDelayedTaskList ) || ( pxStateList == pxOverflowDelayedTaskList ) )
+			#else
+				if( ( pxStateList >= &( xDelayWheel[ 0 ] ) ) && ( pxStateList < &( xDelayWheel[ configDELAY_WHEEL_SLOTS ] ) ) )
+			#endif
 			{
 				/* The task being queried is referenced from one of the Blocked
 				lists. */
@@ -1545,7 +1649,35 @@ void vTaskStartScheduler( void )
 BaseType_t xReturn;
 
 	/* Add the idle task at the lowest priority. */
-	#if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
+	#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	{
+	StaticTask_t *pxIdleTaskTCBBuffer = NULL;
+	StackType_t *pxIdleTaskStackBuffer = NULL;
+	uint16_t usIdleTaskStackSize = tskIDLE_STACK_SIZE;
+
+		/* The application provides the memory used by the idle task so the
+		kernel does not need a heap to start. */
+		vApplicationGetIdleTaskMemory( &pxIdleTaskTCBBuffer, &pxIdleTaskStackBuffer, &usIdleTaskStackSize );
+
+		#if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
+		{
+			xIdleTaskHandle = xTaskCreateStatic( prvIdleTask, "IDLE", usIdleTaskStackSize, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), pxIdleTaskStackBuffer, pxIdleTaskTCBBuffer ); /*lint !e961 MISRA exception, justified as it is not a redundant explicit cast to all supported compilers. */
+			xReturn = ( xIdleTaskHandle != NULL ) ? pdPASS : pdFAIL;
+		}
+		#else
+		{
+			if( xTaskCreateStatic( prvIdleTask, "IDLE", usIdleTaskStackSize, ( void * ) NULL, ( tskIDLE_PRIORITY | portPRIVILEGE_BIT ), pxIdleTaskStackBuffer, pxIdleTaskTCBBuffer ) != NULL ) /*lint !e961 MISRA exception, justified as it is not a redundant explicit cast to all supported compilers. */
+			{
+				xReturn = pdPASS;
+			}
+			else
+			{
+				xReturn = pdFAIL;
+			}
+		}
+		#endif /* INCLUDE_xTaskGetIdleTaskHandle */
+	}
+	#elif ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
 	{
 		/* Create the idle task, storing its handle in xIdleTaskHandle so it can
 		be returned by the xTaskGetIdleTaskHandle() function. */
@@ -1659,6 +1791,21 @@ void vTaskSuspendAll( void )
 		}
 		else
 		{
+			#if( configUSE_DELAY_TIMING_WHEEL == 1 )
+			{
+				/* The wheel only keeps a lower bound on the next wake time,
+				so look for the real one before deciding how long to sleep. */
+				if( xNextTaskUnblockTimeValid == pdFALSE )
+				{
+					prvFindNextTaskUnblockTime();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif /* configUSE_DELAY_TIMING_WHEEL */
+
 			xReturn = xNextTaskUnblockTime - xTickCount;
 		}
 
@@ -1852,8 +1999,21 @@ UBaseType_t uxTaskGetNumberOfTasks( void )
 
 				/* Fill in an TaskStatus_t structure with information on each
 				task in the Blocked state. */
-				uxTask += prvListTaskWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
-				uxTask += prvListTaskWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+				#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+				{
+					uxTask += prvListTaskWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
+					uxTask += prvListTaskWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+				}
+				#else
+				{
+				UBaseType_t uxSlot;
+
+					for( uxSlot = ( UBaseType_t ) 0U; uxSlot < ( UBaseType_t ) configDELAY_WHEEL_SLOTS; uxSlot++ )
+					{
+						uxTask += prvListTaskWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), &( xDelayWheel[ uxSlot ] ), eBlocked );
+					}
+				}
+				#endif /* configUSE_DELAY_TIMING_WHEEL */
 
 				#if( INCLUDE_vTaskDelete == 1 )
 				{
@@ -1928,7 +2088,17 @@ implementations require configUSE_TICKLESS_IDLE to be set to a value other than
 		/* Correct the tick count value after a period during which the tick
 		was suppressed.  Note this does *not* call the tick hook function for
 		each stepped tick. */
-		configASSERT( ( xTickCount + xTicksToJump ) <= xNextTaskUnblockTime );
+		#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+		{
+			configASSERT( ( xTickCount + xTicksToJump ) <= xNextTaskUnblockTime );
+		}
+		#else
+		{
+			/* The wheel catches up with the skipped ticks the next time
+			xTaskIncrementTick() is called. */
+			configASSERT( ( xNextTaskUnblockTimeValid == pdFALSE ) || ( ( xNextTaskUnblockTime - xTickCount ) >= xTicksToJump ) );
+		}
+		#endif
 		xTickCount += xTicksToJump;
 		traceINCREASE_TICK_COUNT( xTicksToJump );
 	}
@@ -1938,8 +2108,10 @@ implementations require configUSE_TICKLESS_IDLE to be set to a value other than
 
 BaseType_t xTaskIncrementTick( void )
 {
-TCB_t * pxTCB;
-TickType_t xItemValue;
+#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+	TCB_t * pxTCB;
+	TickType_t xItemValue;
+#endif
 BaseType_t xSwitchRequired = pdFALSE;
 
 	/* Called by the portable layer each time a tick interrupt occurs.
@@ -1966,87 +2138,104 @@ BaseType_t xSwitchRequired = pdFALSE;
 				mtCOVERAGE_TEST_MARKER();
 			}
 
-			/* See if this tick has made a timeout expire.  Tasks are stored in
-			the	queue in the order of their wake time - meaning once one task
-			has been found whose block time has not expired there is no need to
-			look any further down the list. */
-			if( xConstTickCount >= xNextTaskUnblockTime )
+			#if( configUSE_DELAY_TIMING_WHEEL == 0 )
 			{
-				for( ;; )
+				/* See if this tick has made a timeout expire.  Tasks are stored in
+				the	queue in the order of their wake time - meaning once one task
+				has been found whose block time has not expired there is no need to
+				look any further down the list. */
+				if( xConstTickCount >= xNextTaskUnblockTime )
 				{
-					if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+					for( ;; )
 					{
-						/* The delayed list is empty.  Set xNextTaskUnblockTime
-						to the maximum possible value so it is extremely
-						unlikely that the
-						if( xTickCount >= xNextTaskUnblockTime ) test will pass
-						next time through. */
-						xNextTaskUnblockTime = portMAX_DELAY;
-						break;
-					}
-					else
-					{
-						/* The delayed list is not empty, get the value of the
-						item at the head of the delayed list.  This is the time
-						at which the task at the head of the delayed list must
-						be removed from the Blocked state. */
-						pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
-						xItemValue = listGET_LIST_ITEM_VALUE( &( pxTCB->xGenericListItem ) );
-
-						if( xConstTickCount < xItemValue )
+						if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
 						{
-							/* It is not time to unblock this item yet, but the
-							item value is the time at which the task at the head
-							of the blocked list must be removed from the Blocked
-							state -	so record the item value in
-							xNextTaskUnblockTime. */
-							xNextTaskUnblockTime = xItemValue;
+							/* The delayed list is empty.  Set xNextTaskUnblockTime
+							to the maximum possible value so it is extremely
+							unlikely that the
+							if( xTickCount >= xNextTaskUnblockTime ) test will pass
+							next time through. */
+							xNextTaskUnblockTime = portMAX_DELAY;
 							break;
 						}
 						else
 						{
-							mtCOVERAGE_TEST_MARKER();
-						}
-
-						/* It is time to remove the item from the Blocked state. */
-						( void ) uxListRemove( &( pxTCB->xGenericListItem ) );
-
-						/* Is the task waiting on an event also?  If so remove
-						it from the event list. */
-						if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
-						{
-							( void ) uxListRemove( &( pxTCB->xEventListItem ) );
-						}
-						else
-						{
-							mtCOVERAGE_TEST_MARKER();
-						}
+							/* The delayed list is not empty, get the value of the
+							item at the head of the delayed list.  This is the time
+							at which the task at the head of the delayed list must
+							be removed from the Blocked state. */
+							pxTCB = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
+							xItemValue = listGET_LIST_ITEM_VALUE( &( pxTCB->xGenericListItem ) );
+
+							if( xConstTickCount < xItemValue )
+							{
+								/* It is not time to unblock this item yet, but the
+								item value is the time at which the task at the head
+								of the blocked list must be removed from the Blocked
+								state -	so record the item value in
+								xNextTaskUnblockTime. */
+								xNextTaskUnblockTime = xItemValue;
+								break;
+							}
+							else
+							{
+								mtCOVERAGE_TEST_MARKER();
+							}
 
-						/* Place the unblocked task into the appropriate ready
-						list. */
-						prvAddTaskToReadyList( pxTCB );
+							/* It is time to remove the item from the Blocked state. */
+							( void ) uxListRemove( &( pxTCB->xGenericListItem ) );
 
-						/* A task being unblocked cannot cause an immediate
-						context switch if preemption is turned off. */
-						#if (  configUSE_PREEMPTION == 1 )
-						{
-							/* Preemption is on, but a context switch should
-							only be performed if the unblocked task has a
-							priority that is equal to or higher than the
-							currently executing task. */
-							if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+							/* Is the task waiting on an event also?  If so remove
+							it from the event list. */
+							if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
 							{
-								xSwitchRequired = pdTRUE;
+								( void ) uxListRemove( &( pxTCB->xEventListItem ) );
 							}
 							else
 							{
 								mtCOVERAGE_TEST_MARKER();
 							}
+
+							/* Place the unblocked task into the appropriate ready
+							list. */
+							prvAddTaskToReadyList( pxTCB );
+
+							/* A task being unblocked cannot cause an immediate
+							context switch if preemption is turned off. */
+							#if (  configUSE_PREEMPTION == 1 )
+							{
+								/* Preemption is on, but a context switch should
+								only be performed if the unblocked task has a
+								priority that is equal to or higher than the
+								currently executing task. */
+								if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+								{
+									xSwitchRequired = pdTRUE;
+								}
+								else
+								{
+									mtCOVERAGE_TEST_MARKER();
+								}
+							}
+							#endif /* configUSE_PREEMPTION */
 						}
-						#endif /* configUSE_PREEMPTION */
 					}
 				}
 			}
+			#else
+			{
+				/* Only the slot (or slots, if ticks were stepped over) for
+				this tick can hold tasks that are now due. */
+				if( prvCheckDelayWheel( xConstTickCount ) != pdFALSE )
+				{
+					xSwitchRequired = pdTRUE;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif /* configUSE_DELAY_TIMING_WHEEL */
 		}
 
 		/* Tasks of equal priority to the currently running task will share
@@ -2764,7 +2953,11 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 					/* Now the scheduler is suspended, the expected idle
 					time can be sampled again, and this time its value can
 					be used. */
-					configASSERT( xNextTaskUnblockTime >= xTickCount );
+					#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+					{
+						configASSERT( xNextTaskUnblockTime >= xTickCount );
+					}
+					#endif
 					xExpectedIdleTime = prvGetExpectedIdleTime();
 
 					if( xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP )
@@ -2826,6 +3019,12 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 
 		return eReturn;
 	}
+	/*-----------------------------------------------------------*/
+
+	TickType_t xTaskGetExpectedIdleTime( void )
+	{
+		return prvGetExpectedIdleTime();
+	}
 
 #endif /* configUSE_TICKLESS_IDLE */
 /*-----------------------------------------------------------*/
@@ -3004,8 +3203,22 @@ UBaseType_t uxPriority;
 		vListInitialise( &( pxReadyTasksLists[ uxPriority ] ) );
 	}
 
-	vListInitialise( &xDelayedTaskList1 );
-	vListInitialise( &xDelayedTaskList2 );
+	#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+	{
+		vListInitialise( &xDelayedTaskList1 );
+		vListInitialise( &xDelayedTaskList2 );
+	}
+	#else
+	{
+	UBaseType_t uxSlot;
+
+		for( uxSlot = ( UBaseType_t ) 0U; uxSlot < ( UBaseType_t ) configDELAY_WHEEL_SLOTS; uxSlot++ )
+		{
+			vListInitialise( &( xDelayWheel[ uxSlot ] ) );
+		}
+	}
+	#endif /* configUSE_DELAY_TIMING_WHEEL */
+
 	vListInitialise( &xPendingReadyList );
 
 	#if ( INCLUDE_vTaskDelete == 1 )
@@ -3020,10 +3233,14 @@ UBaseType_t uxPriority;
 	}
 	#endif /* INCLUDE_vTaskSuspend */
 
-	/* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
-	using list2. */
-	pxDelayedTaskList = &xDelayedTaskList1;
-	pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	#if( configUSE_DELAY_TIMING_WHEEL == 0 )
+	{
+		/* Start with pxDelayedTaskList using list1 and the
+		pxOverflowDelayedTaskList using list2. */
+		pxDelayedTaskList = &xDelayedTaskList1;
+		pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	}
+	#endif /* configUSE_DELAY_TIMING_WHEEL */
 }
 /*-----------------------------------------------------------*/
 
@@ -3073,20 +3290,41 @@ static void prvAddCurrentTaskToDelayedList( const TickType_t xTimeToWake )
 	/* The list item will be inserted in wake time order. */
 	listSET_LIST_ITEM_VALUE( &( pxCurrentTCB->xGenericListItem ), xTimeToWake );
 
-	if( xTimeToWake < xTickCount )
+	#if( configUSE_DELAY_TIMING_WHEEL == 0 )
 	{
-		/* Wake time has overflowed.  Place this item in the overflow list. */
-		vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xGenericListItem ) );
+		if( xTimeToWake < xTickCount )
+		{
+			/* Wake time has overflowed.  Place this item in the overflow list. */
+			vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xGenericListItem ) );
+		}
+		else
+		{
+			/* The wake time has not overflowed, so the current block list is used. */
+			vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xGenericListItem ) );
+
+			/* If the task entering the blocked state was placed at the head of the
+			list of blocked tasks then xNextTaskUnblockTime needs to be updated
+			too. */
+			if( xTimeToWake < xNextTaskUnblockTime )
+			{
+				xNextTaskUnblockTime = xTimeToWake;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
 	}
-	else
+	#else
 	{
-		/* The wake time has not overflowed, so the current block list is used. */
-		vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xGenericListItem ) );
+		/* The slot is chosen by the wake time alone, and is not sorted, so
+		this does not depend on how many tasks are already delayed.  Wake times
+		that have wrapped need no special handling as the wheel compares them
+		modulo the tick count. */
+		vListInsertEnd( &( xDelayWheel[ xTimeToWake & taskDELAY_WHEEL_MASK ] ), &( pxCurrentTCB->xGenericListItem ) );
 
-		/* If the task entering the blocked state was placed at the head of the
-		list of blocked tasks then xNextTaskUnblockTime needs to be updated
-		too. */
-		if( xTimeToWake < xNextTaskUnblockTime )
+		/* Keep xNextTaskUnblockTime a lower bound on the next wake time. */
+		if( ( xNextTaskUnblockTimeValid != pdFALSE ) && ( ( xTimeToWake - xTickCount ) < ( xNextTaskUnblockTime - xTickCount ) ) )
 		{
 			xNextTaskUnblockTime = xTimeToWake;
 		}
@@ -3095,21 +3333,30 @@ static void prvAddCurrentTaskToDelayedList( const TickType_t xTimeToWake )
 			mtCOVERAGE_TEST_MARKER();
 		}
 	}
+	#endif /* configUSE_DELAY_TIMING_WHEEL */
 }
 /*-----------------------------------------------------------*/
 
-static TCB_t *prvAllocateTCBAndStack( const uint16_t usStackDepth, StackType_t * const puxStackBuffer )
+static TCB_t *prvAllocateTCBAndStack( const uint16_t usStackDepth, StackType_t * const puxStackBuffer, TCB_t * const pxTCBBuffer )
 {
 TCB_t *pxNewTCB;
 
 	/* If the stack grows down then allocate the stack then the TCB so the stack
 	does not grow into the TCB.  Likewise if the stack grows up then allocate
-	the TCB then the stack. */
+	the TCB then the stack.  Either may instead have been provided by the
+	application, in which case nothing is allocated for it. */
 	#if( portSTACK_GROWTH > 0 )
 	{
 		/* Allocate space for the TCB.  Where the memory comes from depends on
 		the implementation of the port malloc function. */
-		pxNewTCB = ( TCB_t * ) pvPortMalloc( sizeof( TCB_t ) );
+		if( pxTCBBuffer != NULL )
+		{
+			pxNewTCB = pxTCBBuffer;
+		}
+		else
+		{
+			pxNewTCB = ( TCB_t * ) pvPortMalloc( sizeof( TCB_t ) );
+		}
 
 		if( pxNewTCB != NULL )
 		{
@@ -3121,7 +3368,10 @@ TCB_t *pxNewTCB;
 			if( pxNewTCB->pxStack == NULL )
 			{
 				/* Could not allocate the stack.  Delete the allocated TCB. */
-				vPortFree( pxNewTCB );
+				if( pxTCBBuffer == NULL )
+				{
+					vPortFree( pxNewTCB );
+				}
 				pxNewTCB = NULL;
 			}
 		}
@@ -3137,19 +3387,30 @@ TCB_t *pxNewTCB;
 		{
 			/* Allocate space for the TCB.  Where the memory comes from depends
 			on the implementation of the port malloc function. */
-			pxNewTCB = ( TCB_t * ) pvPortMalloc( sizeof( TCB_t ) );
+			if( pxTCBBuffer != NULL )
+			{
+				pxNewTCB = pxTCBBuffer;
+			}
+			else
+			{
+				pxNewTCB = ( TCB_t * ) pvPortMalloc( sizeof( TCB_t ) );
+			}
 
 			if( pxNewTCB != NULL )
 			{
 				/* Store the stack location in the TCB. */
 				pxNewTCB->pxStack = pxStack;
 			}
-			else
+			else if( puxStackBuffer == NULL )
 			{
 				/* The stack cannot be used as the TCB was not created.  Free it
 				again. */
 				vPortFree( pxStack );
 			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
 		}
 		else
 		{
@@ -3167,6 +3428,24 @@ TCB_t *pxNewTCB;
 			( void ) memset( pxNewTCB->pxStack, ( int ) tskSTACK_FILL_BYTE, ( size_t ) usStackDepth * sizeof( StackType_t ) );
 		}
 		#endif /* ( ( configCHECK_FOR_STACK_OVERFLOW > 1 ) || ( ( configUSE_TRACE_FACILITY == 1 ) || ( INCLUDE_uxTaskGetStackHighWaterMark == 1 ) ) ) */
+
+		#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+		{
+			/* Remember which parts were provided by the application so they
+			are not freed if the task is deleted. */
+			pxNewTCB->ucStaticallyAllocated = 0U;
+
+			if( puxStackBuffer != NULL )
+			{
+				pxNewTCB->ucStaticallyAllocated |= tskSTATICALLY_ALLOCATED_STACK;
+			}
+
+			if( pxTCBBuffer != NULL )
+			{
+				pxNewTCB->ucStaticallyAllocated |= tskSTATICALLY_ALLOCATED_TCB;
+			}
+		}
+		#endif /* configSUPPORT_STATIC_ALLOCATION */
 	}
 
 	return pxNewTCB;
@@ -3323,7 +3602,21 @@ TCB_t *pxNewTCB;
 		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 
-		#if( portUSING_MPU_WRAPPERS == 1 )
+		#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+		{
+			/* Only free the memory that was allocated dynamically in the
+			first place. */
+			if( ( pxTCB->ucStaticallyAllocated & tskSTATICALLY_ALLOCATED_STACK ) == 0U )
+			{
+				vPortFreeAligned( pxTCB->pxStack );
+			}
+
+			if( ( pxTCB->ucStaticallyAllocated & tskSTATICALLY_ALLOCATED_TCB ) == 0U )
+			{
+				vPortFree( pxTCB );
+			}
+		}
+		#elif( portUSING_MPU_WRAPPERS == 1 )
 		{
 			/* Only free the stack if it was allocated dynamically in the first
 			place. */
@@ -3331,41 +3624,205 @@ TCB_t *pxNewTCB;
 			{
 				vPortFreeAligned( pxTCB->pxStack );
 			}
+
+			vPortFree( pxTCB );
 		}
 		#else
 		{
 			vPortFreeAligned( pxTCB->pxStack );
+			vPortFree( pxTCB );
 		}
 		#endif
-
-		vPortFree( pxTCB );
 	}
 
 #endif /* INCLUDE_vTaskDelete */
 /*-----------------------------------------------------------*/
 
-static void prvResetNextTaskUnblockTime( void )
-{
-TCB_t *pxTCB;
+#if( configUSE_DELAY_TIMING_WHEEL == 0 )
 
-	if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+	static void prvResetNextTaskUnblockTime( void )
 	{
-		/* The new current delayed list is empty.  Set xNextTaskUnblockTime to
-		the maximum possible value so it is	extremely unlikely that the
-		if( xTickCount >= xNextTaskUnblockTime ) test will pass until
-		there is an item in the delayed list. */
-		xNextTaskUnblockTime = portMAX_DELAY;
+	TCB_t *pxTCB;
+
+		if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+		{
+			/* The new current delayed list is empty.  Set xNextTaskUnblockTime to
+			the maximum possible value so it is	extremely unlikely that the
+			if( xTickCount >= xNextTaskUnblockTime ) test will pass until
+			there is an item in the delayed list. */
+			xNextTaskUnblockTime = portMAX_DELAY;
+		}
+		else
+		{
+			/* The new current delayed list is not empty, get the value of
+			the item at the head of the delayed list.  This is the time at
+			which the task at the head of the delayed list should be removed
+			from the Blocked state. */
+			( pxTCB ) = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
+			xNextTaskUnblockTime = listGET_LIST_ITEM_VALUE( &( ( pxTCB )->xGenericListItem ) );
+		}
 	}
-	else
+
+#else
+
+	static void prvResetNextTaskUnblockTime( void )
 	{
-		/* The new current delayed list is not empty, get the value of
-		the item at the head of the delayed list.  This is the time at
-		which the task at the head of the delayed list should be removed
-		from the Blocked state. */
-		( pxTCB ) = ( TCB_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList );
-		xNextTaskUnblockTime = listGET_LIST_ITEM_VALUE( &( ( pxTCB )->xGenericListItem ) );
+		/* Finding the next wake time means searching the wheel, so it is only
+		done when it is needed, by prvGetExpectedIdleTime(). */
+		xNextTaskUnblockTimeValid = pdFALSE;
 	}
-}
+	/*-----------------------------------------------------------*/
+
+	#if( configUSE_TICKLESS_IDLE != 0 )
+	static void prvFindNextTaskUnblockTime( void )
+	{
+	TickType_t xTick, xTicksToWake, xEarliest = portMAX_DELAY;
+	ListItem_t const *pxItem;
+	UBaseType_t uxSlot;
+
+		/* The tick interrupt might unblock tasks from the wheel if the
+		scheduler is not suspended. */
+		taskENTER_CRITICAL();
+		{
+			/* Most of the time a task is due within one turn of the wheel, in
+			which case the first slot found holding a task due on this turn
+			gives the answer. */
+			for( xTick = ( TickType_t ) 1U; xTick <= ( TickType_t ) configDELAY_WHEEL_SLOTS; xTick++ )
+			{
+				uxSlot = ( UBaseType_t ) ( ( xTickCount + xTick ) & taskDELAY_WHEEL_MASK );
+
+				for( pxItem = listGET_HEAD_ENTRY( &( xDelayWheel[ uxSlot ] ) ); pxItem != listGET_END_MARKER( &( xDelayWheel[ uxSlot ] ) ); pxItem = listGET_NEXT( pxItem ) )
+				{
+					xTicksToWake = listGET_LIST_ITEM_VALUE( pxItem ) - xTickCount;
+
+					if( xTicksToWake < xEarliest )
+					{
+						xEarliest = xTicksToWake;
+					}
+				}
+
+				if( xEarliest <= xTick )
+				{
+					/* Nothing on a later slot can be due any sooner. */
+					break;
+				}
+			}
+
+			/* If the loop ran to the end every slot has been searched, and
+			xEarliest is still portMAX_DELAY if no task is delayed at all. */
+			if( xEarliest == portMAX_DELAY )
+			{
+				xNextTaskUnblockTime = portMAX_DELAY;
+			}
+			else
+			{
+				xNextTaskUnblockTime = xTickCount + xEarliest;
+			}
+
+			xNextTaskUnblockTimeValid = pdTRUE;
+		}
+		taskEXIT_CRITICAL();
+	}
+	#endif /* configUSE_TICKLESS_IDLE */
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvCheckDelayWheel( const TickType_t xConstTickCount )
+	{
+	TCB_t *pxTCB;
+	ListItem_t *pxItem, *pxNextItem;
+	List_t *pxSlot;
+	TickType_t xTicksElapsed, xTicksToCheck, xTick;
+	BaseType_t xSwitchRequired = pdFALSE;
+
+		/* Normally this is called once per tick, but after the tick has been
+		stepped (see vTaskStepTick()) several ticks have to be caught up on.
+		There is no need to look at any slot more than once. */
+		xTicksElapsed = xConstTickCount - xDelayWheelTick;
+
+		if( xTicksElapsed > ( TickType_t ) configDELAY_WHEEL_SLOTS )
+		{
+			xTicksToCheck = ( TickType_t ) configDELAY_WHEEL_SLOTS;
+		}
+		else
+		{
+			xTicksToCheck = xTicksElapsed;
+		}
+
+		for( xTick = ( TickType_t ) 0U; xTick < xTicksToCheck; xTick++ )
+		{
+			pxSlot = &( xDelayWheel[ ( xConstTickCount - xTick ) & taskDELAY_WHEEL_MASK ] );
+			pxItem = listGET_HEAD_ENTRY( pxSlot );
+
+			while( pxItem != ( ListItem_t * ) listGET_END_MARKER( pxSlot ) )
+			{
+				pxNextItem = listGET_NEXT( pxItem );
+
+				/* Tasks due on a later turn of the wheel share the slot, so
+				only unblock those whose wake time has passed since the wheel
+				was last checked. */
+				if( ( TickType_t ) ( listGET_LIST_ITEM_VALUE( pxItem ) - xDelayWheelTick - ( TickType_t ) 1U ) < xTicksElapsed )
+				{
+					pxTCB = ( TCB_t * ) listGET_LIST_ITEM_OWNER( pxItem );
+
+					/* It is time to remove the item from the Blocked state. */
+					( void ) uxListRemove( &( pxTCB->xGenericListItem ) );
+
+					/* Is the task waiting on an event also?  If so remove
+					it from the event list. */
+					if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+					{
+						( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					/* Place the unblocked task into the appropriate ready
+					list. */
+					prvAddTaskToReadyList( pxTCB );
+
+					/* A task being unblocked cannot cause an immediate
+					context switch if preemption is turned off. */
+					#if (  configUSE_PREEMPTION == 1 )
+					{
+						if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+						{
+							xSwitchRequired = pdTRUE;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#endif /* configUSE_PREEMPTION */
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxItem = pxNextItem;
+			}
+		}
+
+		/* Once the lower bound has been reached it says nothing about the
+		tasks still on the wheel. */
+		if( ( xNextTaskUnblockTimeValid != pdFALSE ) && ( ( TickType_t ) ( xNextTaskUnblockTime - xDelayWheelTick - ( TickType_t ) 1U ) < xTicksElapsed ) )
+		{
+			xNextTaskUnblockTimeValid = pdFALSE;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		xDelayWheelTick = xConstTickCount;
+
+		return xSwitchRequired;
+	}
+
+#endif /* configUSE_DELAY_TIMING_WHEEL */
 /*-----------------------------------------------------------*/
 
 #if ( ( INCLUDE_xTaskGetCurrentTaskHandle == 1 ) || ( configUSE_MUTEXES == 1 ) )
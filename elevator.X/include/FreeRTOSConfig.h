@@ -91,7 +91,10 @@
 #define configMAX_PRIORITIES			( 6UL )
 #define configMINIMAL_STACK_SIZE                ( 290 )
 #define configISR_STACK_SIZE                    ( 400 )
-#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 28000 )
+/* Nothing allocates from the heap, main() asserts as much.  This is the
+smallest heap heap_tlsf.c can set up, kept so the HS command has one to report
+on and any allocation that creeps in fails into vApplicationMallocFailedHook(). */
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 32 )
 #define configMAX_TASK_NAME_LEN                 ( 8 )
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_16_BIT_TICKS                  0
@@ -101,9 +104,12 @@
 #define configQUEUE_REGISTRY_SIZE               0
 #define configUSE_RECURSIVE_MUTEXES             1
 #define configUSE_MALLOC_FAILED_HOOK            1
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configUSE_DELAY_TIMING_WHEEL            0
 #define configUSE_APPLICATION_TASK_TAG          0
 #define configUSE_COUNTING_SEMAPHORES           1
-#define configGENERATE_RUN_TIME_STATS           0
+#define configUSE_QUEUE_SETS                    1
+#define configGENERATE_RUN_TIME_STATS           1
 #define configCOMMAND_INT_MAX_OUTPUT_SIZE       1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    1
 
@@ -117,6 +123,11 @@
 #define configTIMER_QUEUE_LENGTH                5
 #define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
 
+/* Let the idle task suppress the tick and wait in Idle mode when no task needs
+to run for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks. */
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
 
@@ -130,10 +141,39 @@ to exclude the API function. */
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
 #define INCLUDE_eTaskGetState			1
 #define INCLUDE_xTaskResumeFromISR 1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
 /* Prevent C specific syntax being included in assembly files. */
 #ifndef __LANGUAGE_ASSEMBLY
 	void vAssertCalled( const char *pcFileName, unsigned long ulLine );
 	#define configASSERT( x ) if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
+
+	/* Heap instrumentation (see heapstats.c).  traceMALLOC() is expanded
+	inside pvPortMalloc(), so the return address is the heap's caller. */
+	void HeapStatsRecordMalloc( void *address, size_t size, void *caller );
+	void HeapStatsRecordFree( void *address, size_t size );
+	#define traceMALLOC( pvAddress, uiSize ) HeapStatsRecordMalloc( ( pvAddress ), ( uiSize ), __builtin_return_address( 0 ) )
+	#define traceFREE( pvAddress, uiSize ) HeapStatsRecordFree( ( pvAddress ), ( uiSize ) )
+
+	/* Run time statistics are measured with the core timer (see runstats.c). */
+	void RunStatsInit( void );
+	uint32_t RunStatsGetCounter( void );
+	#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() RunStatsInit()
+	#define portGET_RUN_TIME_COUNTER_VALUE() RunStatsGetCounter()
+
+	/* Kernel events are logged by the trace recorder (see trace.c).  These
+	hooks are expanded inside tasks.c and queue.c, where the TCB and queue
+	structures are visible. */
+	#include "trace.h"
+	#define traceTASK_SWITCHED_IN() TraceRecord( TRACE_TASK_SWITCH, ( uint8_t ) pxCurrentTCB->uxTCBNumber, ( uint16_t ) pxCurrentTCB->uxPriority )
+	#define traceQUEUE_TRACE( type, pxQueue ) TraceRecord( ( type ), ( uint8_t ) ( pxQueue )->uxQueueNumber, ( uint16_t ) ( pxQueue )->uxMessagesWaiting )
+	#define traceQUEUE_SEND( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_SEND, pxQueue )
+	#define traceQUEUE_SEND_FAILED( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_SEND_FAILED, pxQueue )
+	#define traceQUEUE_RECEIVE( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_RECEIVE, pxQueue )
+	#define traceQUEUE_RECEIVE_FAILED( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_RECEIVE_FAILED, pxQueue )
+	#define traceBLOCKING_ON_QUEUE_SEND( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_BLOCK_SEND, pxQueue )
+	#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_BLOCK_RECEIVE, pxQueue )
+	#define traceQUEUE_SEND_FROM_ISR( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_SEND_ISR, pxQueue )
+	#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue ) traceQUEUE_TRACE( TRACE_QUEUE_RECEIVE_ISR, pxQueue )
 #endif
 
 /* The priority at which the tick interrupt runs.  This should probably be
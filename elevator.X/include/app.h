@@ -0,0 +1,16 @@
+#ifndef APP_H
+#define	APP_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Create the queues and tasks, once the hardware is set up and before the
+// scheduler starts. Shared by the PIC32 main() and the host build.
+void InitApp(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* APP_H */
@@ -0,0 +1,71 @@
+#ifndef BENCH_H
+#define	BENCH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+// Times each operation is measured
+#define BENCH_ITERATIONS 64
+
+// Item size of the large queue, the same as a UART TX message
+#define BENCH_LARGE_ITEM 200
+
+// CPU cycles per core timer count. The host build counts nanoseconds instead.
+#ifndef BENCH_CYCLES_PER_COUNT
+#define BENCH_CYCLES_PER_COUNT 2
+#endif
+
+// What the results are in, as the KB command prints them
+#ifndef BENCH_UNIT
+#define BENCH_UNIT "cycles"
+#endif
+
+enum BENCH_OP {
+    BENCH_QUEUE_SEND_200,       // xQueueSendToBack(), 200 byte item
+    BENCH_QUEUE_RECEIVE_200,    // xQueueReceive(), 200 byte item
+    BENCH_QUEUE_SEND_4,         // xQueueSendToBack(), 4 byte item
+    BENCH_QUEUE_RECEIVE_4,      // xQueueReceive(), 4 byte item
+    BENCH_QUEUE_OVERWRITE,      // xQueueOverwrite(), 4 byte item
+    BENCH_SEM_GIVE_ISR,         // xSemaphoreGiveFromISR(), from a task
+    BENCH_SEM_TAKE,             // xSemaphoreTake(), semaphore already given
+    BENCH_NOTIFY_GIVE,          // xTaskNotifyGive() to itself
+    BENCH_NOTIFY_TAKE,          // ulTaskNotifyTake(), already notified
+    BENCH_YIELD,                // taskYIELD() with nothing else to run
+    BENCH_CONTEXT_SWITCH,       // Half a notify round trip with another task
+    BENCH_DELAY,                // vTaskDelay(1), less the tick it waits for
+    BENCH_NUM_OPS
+};
+
+// Cost of one operation in BENCH_UNITs, less the cost of reading the timer
+struct BenchResult {
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+};
+
+// The task the context switch is measured against
+extern TaskHandle_t bench_task;
+
+// Set up the queues and semaphore the benchmarks use
+void InitBench(void);
+
+// Run every benchmark. Blocks tasks below the caller's priority while it runs.
+void BenchRun(struct BenchResult results[BENCH_NUM_OPS]);
+
+// The operation's name, as the KB command prints it
+const char *BenchName(enum BENCH_OP op);
+
+// The task the context switch is measured against
+void taskBench(void *pvParameters);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* BENCH_H */
+
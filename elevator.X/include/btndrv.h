@@ -6,10 +6,11 @@ extern "C" {
 #endif
 #include <FreeRTOS.h>
 #include <queue.h>
+#include "mailbox.h"
     
 typedef struct xBTN_TASK_PARAMETER {
     QueueHandle_t tx_queue;
-    QueueHandle_t door_rx_queue;    // Door receives messages on this queue
+    struct Mailbox *door_mailbox;   // Door receives messages in this mailbox
 } xBtnTaskParameter_t;
     
 void taskButtons(void *pvParameters);
@@ -0,0 +1,65 @@
+#ifndef CARSTATE_H
+#define	CARSTATE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <event_groups.h>
+
+/*
+ * State bits come in pairs and exactly one bit of each pair is set, so a task
+ * can block on either edge of a transition. Setting a bit clears its partner.
+ */
+#define STATE_MOVING        (1UL << 0)
+#define STATE_STOPPED       (1UL << 1)
+#define STATE_DOOR_OPEN     (1UL << 2)
+#define STATE_DOOR_CLOSED   (1UL << 3)
+#define STATE_EMERGENCY     (1UL << 4)
+#define STATE_NORMAL        (1UL << 5)
+#define STATE_GOING_UP      (1UL << 6)
+#define STATE_GOING_DOWN    (1UL << 7)
+
+// The other bit of each pair
+#define STATE_PARTNER(bits) ((((bits) & 0x55UL) << 1) | (((bits) & 0xaaUL) >> 1))
+
+// A stretch of the car's motion. The physics task works each one out before
+// the car gets there, and readers interpolate along it to the current tick.
+struct CarSegment {
+    TickType_t start;
+    float location;         // Feet, at the start
+    float speed;            // Feet per second, at the start
+    TickType_t end;
+    float end_location;
+    float end_speed;
+};
+
+// Everything about the car, read all at once
+struct CarState {
+    float location;     // Feet
+    float speed;        // Feet per second
+    int dest;           // Request number of the destination
+    EventBits_t flags;  // STATE_ bits
+};
+
+void InitCarState(void);
+
+// Written by the physics and door tasks
+void CarStateSetMotion(float location, float speed, int dest);
+void CarStateSetSegment(const struct CarSegment *segment, int dest);
+void CarStateSetFlags(EventBits_t bits);
+
+// Read by everyone else
+void CarStateGet(struct CarState *state);
+EventBits_t CarStateFlags(void);
+EventBits_t CarStateWait(EventBits_t bits, TickType_t timeout);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CARSTATE_H */
+
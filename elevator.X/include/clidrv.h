@@ -5,9 +5,10 @@
 extern "C" {
 #endif
 #include <queue.h>
+#include "mailbox.h"
     
 // Initialize the Command Line Interface (CLI) subsystem
-void InitCLI(QueueHandle_t door_rx_queue);
+void InitCLI(struct Mailbox *door_mailbox);
     
 #ifdef	__cplusplus
 }
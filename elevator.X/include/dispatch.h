@@ -0,0 +1,49 @@
+#ifndef DISPATCH_H
+#define	DISPATCH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include "physics.h"
+#include "profile.h"
+
+// Policy the car boots with, override with -DDISPATCH_DEFAULT_POLICY=...
+#ifndef DISPATCH_DEFAULT_POLICY
+#define DISPATCH_DEFAULT_POLICY DISPATCH_COLLECTIVE
+#endif
+
+// How long the door's open-close sequence keeps the car at a stop
+#define DISPATCH_DOOR_MS 11000
+
+enum DISPATCH_POLICY {
+    DISPATCH_COLLECTIVE,    // The original fixed order for the three stops
+    DISPATCH_NEAREST,       // Closest stop first
+    DISPATCH_LOOK,          // Carry on the way the car is going, then turn
+    DISPATCH_ETA,           // Least total time until every call is served
+    DISPATCH_ENERGY,        // Least energy to serve every call
+    DISPATCH_NUM_POLICIES
+};
+
+// What a policy knows about the car
+struct DispatchCar {
+    float location;                     // Feet
+    bool going_up;                      // Updated by the policy
+    struct MotionLimits limits;         // For travel time estimates
+};
+
+// Choose where the car goes next
+void DispatchSetPolicy(enum DISPATCH_POLICY policy);
+enum DISPATCH_POLICY DispatchGetPolicy(void);
+const char *DispatchPolicyName(enum DISPATCH_POLICY policy);
+int DispatchNext(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+int DispatchIntercept(const struct DispatchCar *car, struct FloorRequest *requests,
+                      int numStops, float dest, float braking);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DISPATCH_H */
+
@@ -5,8 +5,10 @@
 extern "C" {
 #endif
 
+#include "mailbox.h"
+
 typedef struct xDOOR_TASK_PARAMETER {
-    QueueHandle_t door_rx_queue;    // Door receives messages on this queue
+    struct Mailbox *door_mailbox;   // Door receives messages in this mailbox
     QueueHandle_t door_tx_queue;    // Door transmits messages on this queue
 } xDoorTaskParameter_t;
 
@@ -14,8 +16,8 @@ typedef struct xDOOR_TASK_PARAMETER {
 enum DOOR_MSG { OPEN_CLOSE_SEQ, STAY_OPEN, CLOSE, CLOSED };
 
 // Door Task
+void InitDoorMailbox(struct Mailbox *mailbox);
 void taskDoor(void *pvParameters);
-bool GetDoorClosed();
 
 #ifdef	__cplusplus
 }
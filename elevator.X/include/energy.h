@@ -0,0 +1,66 @@
+#ifndef ENERGY_H
+#define	ENERGY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "profile.h"
+
+// The car and counterweight, all of which is sped up and slowed down
+#define ENERGY_MOVING_KG 2500.0f
+
+// How much heavier the car side is than the counterweight, which is what
+// gets lifted
+#define ENERGY_UNBALANCED_KG 300.0f
+
+// Guide rail and rope friction, a constant force against the motion
+#define ENERGY_FRICTION_N 400.0f
+
+// Share of the braking and lowering energy the drive gets back
+#define ENERGY_REGEN 0.3f
+
+// Eco mode may make a trip this much longer than the fastest, in percent
+#define ENERGY_DEFAULT_SLACK 25
+
+// A trip's metering so far
+struct EnergyMeter {
+    float joules;
+    float feet;
+};
+
+struct EnergyStats {
+    uint32_t trips;
+    float total_j;
+    float last_j;       // The last trip
+    bool eco;
+    uint32_t slack;     // Percent
+};
+
+// Metering a trip, stepped by the physics task
+void EnergyTripStart(void);
+void EnergyStep(float speedBefore, float speedAfter, float moved, bool up);
+float EnergyTripEnd(void);
+
+// Lets the physics task take back steps it worked out ahead of the car
+void EnergyTripSave(struct EnergyMeter *meter);
+void EnergyTripRestore(const struct EnergyMeter *meter);
+
+// Planning
+float EnergyEstimate(const struct MotionLimits *limits, float from, float to);
+float EnergyEcoSpeed(const struct MotionLimits *limits, float distance);
+
+// Control from the CLI
+void EnergySetEco(bool eco, uint32_t slack);
+bool EnergyEcoEnabled(void);
+void EnergyGetStats(struct EnergyStats *stats);
+void EnergyResetStats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ENERGY_H */
+
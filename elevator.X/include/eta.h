@@ -0,0 +1,48 @@
+#ifndef ETA_H
+#define	ETA_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+#include "physics.h"
+#include "profile.h"
+
+// Floors an arrival time is kept for
+#define ETA_FLOORS 3
+
+// What the physics task knows when something changes
+struct EtaInput {
+    float location;                 // Feet
+    float speed;                    // ft/s, 0 when stopped
+    int dest;                       // Stop the car is heading for, -1 if none
+    bool door_at_dest;              // The door will open when it gets there
+    uint32_t door_left_ms;          // Until the door here closes, 0 if closed
+    bool going_up;
+    struct MotionLimits limits;     // For the trips after this one
+    float cruise_speed;             // For this trip
+};
+
+// Arrival time at a floor
+struct Eta {
+    bool valid;                     // False in an emergency
+    bool called;                    // The car is stopping there for a call
+    uint32_t ms;                    // From now
+};
+
+// Work out the arrival times again, called by the physics task
+void EtaUpdate(const struct EtaInput *input, const struct FloorRequest *requests);
+void EtaInvalidate(void);
+
+// Cheap to call from any task
+bool EtaGet(int floor, struct Eta *eta);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ETA_H */
+
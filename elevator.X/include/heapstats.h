@@ -0,0 +1,51 @@
+#ifndef HEAPSTATS_H
+#define	HEAPSTATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+
+// Number of distinct pvPortMalloc() callers that get their own counters
+#define HEAP_STATS_SITES 8
+
+// Number of power of two size classes in the free block histogram
+#define HEAP_STATS_BINS 16
+
+// Counters for one pvPortMalloc() caller
+struct HeapSite {
+    void *caller;           // Return address into the calling function
+    uint32_t allocs;        // Successful allocations
+    uint32_t failures;      // Allocations that returned NULL
+    size_t bytes;           // Total bytes handed out (including block headers)
+};
+
+// Snapshot of the heap as a whole
+struct HeapStats {
+    size_t free_bytes;
+    size_t min_ever_free_bytes;
+    size_t largest_free_block;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+    size_t last_failed_size;
+    UBaseType_t histogram[HEAP_STATS_BINS];
+};
+
+// Called from the traceMALLOC()/traceFREE() hooks inside the heap
+void HeapStatsRecordMalloc(void *address, size_t size, void *caller);
+void HeapStatsRecordFree(void *address, size_t size);
+
+// Read back the statistics
+void HeapStatsGet(struct HeapStats *stats);
+bool HeapStatsGetSite(int siteNum, struct HeapSite *site);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HEAPSTATS_H */
+
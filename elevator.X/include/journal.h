@@ -0,0 +1,63 @@
+#ifndef JOURNAL_H
+#define	JOURNAL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+
+// Inputs the journal holds, 4 bytes each
+#define JOURNAL_ENTRIES 512
+
+// Where an input came from, one bit each so a reader can pick several
+#define JOURNAL_GAP     0x01    // Nothing happened, just time passing
+#define JOURNAL_UART    0x02    // A byte of a CLI command line
+#define JOURNAL_KEY     0x04    // A single key CLI command
+#define JOURNAL_BUTTON  0x08    // A button press, data is the pin's bit number
+#define JOURNAL_ALL     0x0f
+
+// Set in a button entry's data when the press turned out to be a bounce
+#define JOURNAL_BOUNCE  0x80
+
+// One input, as read back
+struct JournalEntry {
+    TickType_t tick;    // Ticks since the scheduler started
+    uint8_t source;     // JOURNAL_ source
+    uint8_t data;
+};
+
+// Where a reader is in the journal
+struct JournalCursor {
+    uint32_t index;     // Next entry to look at
+    TickType_t tick;    // Time of the entry before it
+    uint8_t sources;    // JOURNAL_ sources the reader wants
+};
+
+// Start recording, or replaying if the last reset asked for it
+void InitJournal(void);
+bool JournalReplaying(void);
+
+// Record an input (does nothing while replaying)
+void JournalRecord(uint8_t source, uint8_t data);
+void JournalLineStart(void);
+
+// Read the journal back
+uint32_t JournalCount(void);
+uint32_t JournalLost(void);
+void JournalStart(struct JournalCursor *cursor, uint8_t sources);
+bool JournalPeek(struct JournalCursor *cursor, struct JournalEntry *entry);
+void JournalNext(struct JournalCursor *cursor);
+
+// Reset the board and feed it the journal again
+bool JournalCanReplay(void);
+void JournalReplay(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* JOURNAL_H */
+
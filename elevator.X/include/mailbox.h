@@ -0,0 +1,43 @@
+#ifndef MAILBOX_H
+#define	MAILBOX_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+// Messages are numbered 0 to MAILBOX_MAX_MSGS - 1
+#define MAILBOX_MAX_MSGS 32
+#define MAILBOX_BIT(msg) (1UL << (msg))
+
+/*
+ * A mailbox holds at most one of each message, so posting a message that is
+ * already pending merges with it instead of taking more room. Receiving takes
+ * the pending message with the highest priority. Posting a message can also
+ * cancel pending messages of lower priority that it makes pointless, but
+ * never one of higher priority, so a high priority message is never lost.
+ */
+struct Mailbox {
+    volatile uint32_t pending;      // One bit per pending message
+    const uint8_t *order;           // Every message, highest priority first
+    int num_msgs;
+    const uint32_t *cancels;        // Indexed by message, the bits it clears
+    SemaphoreHandle_t signal;       // Given while messages are pending
+    StaticSemaphore_t signal_buffer;
+};
+
+void MailboxInit(struct Mailbox *mailbox, const uint8_t *order, int numMsgs,
+                 const uint32_t *cancels);
+void MailboxPost(struct Mailbox *mailbox, uint8_t msg);
+bool MailboxReceive(struct Mailbox *mailbox, uint8_t *msg, TickType_t timeout);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MAILBOX_H */
+
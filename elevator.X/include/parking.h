@@ -0,0 +1,40 @@
+#ifndef PARKING_H
+#define	PARKING_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Floors calls are counted for
+#define PARKING_FLOORS 3
+
+// Calls are counted in this many buckets over a day. There's no clock, so
+// the day starts at power up.
+#define PARKING_BUCKETS 24
+#define PARKING_DAY_MS (24UL * 60UL * 60UL * 1000UL)
+
+// How long the car has to be idle with the door closed before it parks
+#define PARKING_IDLE_MS 10000
+
+// Learn from hall calls
+void ParkingCall(int floor);
+
+// Where the car should wait, -1 to stay put
+int ParkingFloor(void);
+
+// Control from the CLI
+void ParkingSetEnable(bool enable);
+bool ParkingEnabled(void);
+void ParkingReset(void);
+int ParkingBucketNow(void);
+void ParkingGetBucket(int bucket, uint16_t counts[PARKING_FLOORS]);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PARKING_H */
+
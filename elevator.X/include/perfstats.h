@@ -0,0 +1,73 @@
+#ifndef PERFSTATS_H
+#define	PERFSTATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+// Wait and journey times are kept in a histogram of this many buckets, each
+// PERF_BUCKET_MS wide. Longer times all go in the last bucket. The host build
+// has the RAM for a longer histogram.
+#ifndef PERF_BUCKETS
+#define PERF_BUCKETS 128
+#endif
+#ifndef PERF_BUCKET_MS
+#define PERF_BUCKET_MS 500
+#endif
+
+// Floors that calls can be made for
+#define PERF_FLOORS 3
+
+// Core timer counts per microsecond, for the dispatch cost
+#define PERF_COUNTS_PER_US (configCPU_CLOCK_HZ / 2 / 1000000UL)
+
+// Hall calls are timed until the car arrives (the wait), car calls from the
+// button press until the car arrives (the journey)
+enum PERF_CALL { PERF_HALL, PERF_CAR, PERF_NUM_CALLS };
+
+// Summary of one histogram, all in milliseconds
+struct PerfTimes {
+    uint32_t count;
+    uint32_t avg;
+    uint32_t p95;       // Upper edge of the bucket the percentile falls in
+    uint32_t p99;
+    uint32_t max;
+};
+
+struct PerfReport {
+    uint32_t elapsed_ms;                    // Since the stats were reset
+    uint32_t calls_per_hour;                // Calls served
+    struct PerfTimes times[PERF_NUM_CALLS];
+    uint32_t dispatches;                    // Destination decisions made
+    uint32_t dispatch_avg;                  // Core timer counts per decision
+    uint32_t dispatch_max;
+    uint32_t intercepts;                    // Calls picked up on the way
+    uint32_t estops;                        // Emergency stops braked for
+    uint32_t estop_last;                    // Core timer counts from the
+    uint32_t estop_max;                     // command to braking
+    uint32_t queue_samples;                 // UART TX queue occupancy
+    uint32_t queue_avg_x100;                // Items, times 100
+    uint32_t queue_max;
+};
+
+// Called as things happen
+void PerfCall(int floor, enum PERF_CALL type);
+void PerfArrive(int floor);
+void PerfDispatch(uint32_t counts);
+void PerfIntercept(void);
+void PerfEmergency(uint32_t counts);
+void PerfQueueSample(UBaseType_t items);
+
+// Read and restart the stats
+void PerfGetReport(struct PerfReport *report);
+void PerfReset(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PERFSTATS_H */
+
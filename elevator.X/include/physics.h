@@ -6,12 +6,13 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <task.h>
 #include <queue.h>
 #include "doordrv.h"
     
 typedef struct xPHYSICS_TASK_PARAMETER {
     QueueHandle_t tx_queue;
-    QueueHandle_t door_rx_queue;    // Door receives messages on this queue
+    struct Mailbox *door_mailbox;   // Door receives messages in this mailbox
     QueueHandle_t door_tx_queue;    // Door transmits messages on this queue
 } xPhysicsTaskParameter_t;
 
@@ -25,17 +26,20 @@ struct FloorRequest {
 };
 
 // Physics Task
+void InitPhysics(QueueHandle_t door_tx_queue);
 void taskPhysics(void *pvParameters);
+extern TaskHandle_t physics_task;
 
 // Getters and Setters
-bool GetIsMoving();
 struct FloorRequest GetRequest(int requestNum);
 void SetRequest(int requestNum, enum DIR dir);
-bool GetGoingUp(void);
-float GetCurrentSpeed(void);
+void SetCarRequest(int requestNum);
 void SetMaxSpeed(float speed);
 void SetAccel(float new_accel);
+void SetJerk(float new_jerk);
+bool SetTelemetryRate(int hz);
 void SetEmergStopEnable();
+void SetEmergStopEnableFromISR(BaseType_t *pxHigherPriorityTaskWoken);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,42 @@
+#ifndef PROFILE_H
+#define	PROFILE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+// Limits the motion profile has to respect
+struct MotionLimits {
+    float max_speed;    // ft/s
+    float accel;        // ft/s^2
+    float jerk;         // ft/s^3, zero or less disables jerk limiting
+};
+
+// State of the car along its direction of travel
+struct MotionState {
+    float speed;        // Always positive (ft/s)
+    float accel;        // Positive when speeding up (ft/s^2)
+    bool braking;       // Set once the car has committed to stopping
+};
+
+// Distance needed to come to a complete stop from the given state
+float ProfileBrakingDistance(const struct MotionState *state,
+                             const struct MotionLimits *limits);
+
+// Advance the profile by dt seconds towards a stop "remaining" feet away
+float ProfileStep(struct MotionState *state,
+                  const struct MotionLimits *limits,
+                  float remaining,
+                  float dt);
+
+// Time a rest-to-rest move of the given distance takes
+float ProfileTravelTime(const struct MotionLimits *limits, float distance);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PROFILE_H */
+
@@ -0,0 +1,40 @@
+#ifndef RUNSTATS_H
+#define	RUNSTATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+// Most tasks the statistics can report on
+#define RUN_STATS_MAX_TASKS 16
+
+// The 40MHz core timer is divided by 2^RUN_STATS_SHIFT (1.6us resolution), so
+// a task's 32-bit run time counter only wraps after roughly two hours
+#define RUN_STATS_SHIFT 6
+
+// Run time of one task since the window was last reset
+struct TaskRunTime {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t run_time;      // In run time counter ticks
+};
+
+// Called by the kernel through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() and
+// portGET_RUN_TIME_COUNTER_VALUE()
+void RunStatsInit(void);
+uint32_t RunStatsGetCounter(void);
+
+// Start a new measurement window
+void RunStatsReset(void);
+
+// Read the run time of every task since the window was last reset
+int RunStatsGet(struct TaskRunTime *tasks, int maxTasks, uint32_t *total);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RUNSTATS_H */
+
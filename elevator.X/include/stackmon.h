@@ -0,0 +1,48 @@
+#ifndef STACKMON_H
+#define	STACKMON_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+// Most tasks the monitor can keep track of
+#define STACK_MON_MAX_TASKS 16
+
+// How often every stack is checked
+#define STACK_MON_PERIOD_MS 1000
+
+// Headroom added to the deepest use seen to get a recommended size, in percent
+// of the deepest use but never less than STACK_MON_MIN_MARGIN words
+#define STACK_MON_MARGIN_PERCENT 25
+#define STACK_MON_MIN_MARGIN 32
+
+// Stack use of one task, all sizes in words
+struct StackUsage {
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t size;          // As created, 0 if the task wasn't registered
+    uint16_t min_free;      // Least free stack ever seen
+    uint16_t recommended;   // Deepest use plus the margin, 0 if size unknown
+};
+
+// Tell the monitor how big a task's stack is
+void StackMonRegister(TaskHandle_t task, uint16_t size);
+
+// Read back the stack use of every task seen so far
+int StackMonGet(struct StackUsage *tasks, int maxTasks);
+
+// Least free ISR stack ever seen, in words
+uint16_t StackMonIsrMinFree(void);
+
+// The monitor task
+void taskStackMonitor(void *pvParameters);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* STACKMON_H */
+
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define	TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Only standard headers here, FreeRTOSConfig.h includes this file so the
+// kernel's trace hooks can call TraceRecord()
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of events kept, the oldest are overwritten once the buffer is full
+#define TRACE_EVENTS 256
+
+// Number of queues (and semaphores) that can be given a name
+#define TRACE_MAX_QUEUES 8
+
+// Timestamps are the core timer, which runs at half the CPU clock
+#define TRACE_TIMESTAMP_HZ (configCPU_CLOCK_HZ / 2)
+
+// Event types
+#define TRACE_TASK_SWITCH           1   // id = task number, arg = priority
+#define TRACE_QUEUE_SEND            2   // id = queue number, arg = items before
+#define TRACE_QUEUE_SEND_FAILED     3
+#define TRACE_QUEUE_RECEIVE         4
+#define TRACE_QUEUE_RECEIVE_FAILED  5
+#define TRACE_QUEUE_BLOCK_SEND      6
+#define TRACE_QUEUE_BLOCK_RECEIVE   7
+#define TRACE_QUEUE_SEND_ISR        8
+#define TRACE_QUEUE_RECEIVE_ISR     9
+#define TRACE_ISR_ENTER             10  // id = interrupt number below
+#define TRACE_ISR_EXIT              11
+
+// Interrupt numbers
+#define TRACE_ISR_UART1 1
+
+// One recorded event, 8 bytes
+struct TraceEvent {
+    uint32_t time;          // Core timer count
+    uint8_t type;
+    uint8_t id;
+    uint16_t arg;
+};
+
+// Record an event, safe to call from tasks, interrupts and the kernel
+void TraceRecord(uint8_t type, uint8_t id, uint16_t arg);
+
+// Give a queue or semaphore a number in the trace and a name for the dump
+void TraceNameQueue(void *queue, const char *name);
+const char *TraceQueueName(int num);
+const char *TraceIsrName(int num);
+
+// Stop or restart recording, clearing the buffer on restart
+void TracePause(void);
+void TraceRestart(void);
+
+// Read back the buffer, oldest event first
+int TraceNumEvents(void);
+bool TraceGetEvent(int eventNum, struct TraceEvent *event);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRACE_H */
+
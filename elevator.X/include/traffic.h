@@ -0,0 +1,79 @@
+#ifndef TRAFFIC_H
+#define	TRAFFIC_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <event_groups.h>
+#include "mailbox.h"
+
+// Floors passengers travel between, starting from the ground floor
+#define TRAFFIC_FLOORS 3
+
+// Each profile's arrival rate follows a curve of this many segments, looping
+// every TRAFFIC_CURVE_MS
+#define TRAFFIC_CURVE_SEGMENTS 8
+#define TRAFFIC_CURVE_MS (8UL * 60UL * 1000UL)
+
+// How long the storm profile leaves the door open after an emergency stop
+#define TRAFFIC_STORM_HOLD_MS 5000
+
+enum TRAFFIC_PROFILE {
+    TRAFFIC_UNIFORM,    // Steady Poisson arrivals, any floor to any floor
+    TRAFFIC_UP_PEAK,    // Morning: mostly from the ground floor up
+    TRAFFIC_DOWN_PEAK,  // Evening: mostly down to the ground floor
+    TRAFFIC_LUNCH,      // Two-way: to and from the ground floor
+    TRAFFIC_STORM,      // Uniform, with emergency stops thrown in
+    TRAFFIC_NUM_PROFILES
+};
+
+typedef struct xTRAFFIC_TASK_PARAMETER {
+    struct Mailbox *door_mailbox;   // Door receives messages in this mailbox
+} xTrafficTaskParameter_t;
+
+struct TrafficStats {
+    bool running;
+    enum TRAFFIC_PROFILE profile;
+    uint32_t calls_per_hour;        // At the peak of the curve
+    uint32_t arrived;               // Passengers that made a hall call
+    uint32_t boarded;
+    uint32_t delivered;
+    uint32_t waiting;               // At a floor right now
+    uint32_t riding;
+    uint32_t emergencies;
+};
+
+// What the generator waits for before its next step: the car's state bits,
+// for no longer than a number of ticks
+struct TrafficWait {
+    EventBits_t bits;
+    TickType_t ticks;
+};
+
+// The generator's task, so it can be woken when it's started
+extern TaskHandle_t traffic_task;
+
+// Control from the CLI
+bool TrafficStart(enum TRAFFIC_PROFILE profile, uint32_t callsPerHour, uint32_t seed);
+void TrafficStop(void);
+void TrafficGetStats(struct TrafficStats *stats);
+const char *TrafficProfileName(enum TRAFFIC_PROFILE profile);
+
+// The generator itself, for whatever runs its clock
+void TrafficBegin(TickType_t now);
+void TrafficStep(TickType_t now, EventBits_t bits, struct TrafficWait *wait);
+
+// The generator task, which runs it on the kernel's clock
+void taskTraffic(void *pvParameters);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRAFFIC_H */
+
@@ -0,0 +1,215 @@
+/**
+ * Creates the application's queues and tasks.
+ *
+ * Everything is created from static memory here, so the memory layout is fixed
+ * at link time. main() calls InitApp() once the PIC32 is set up, and the host
+ * build (see host/) calls it to run the same tasks in virtual time.
+ */
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include "app.h"
+#include "uartdrv.h"
+#include "clidrv.h"
+#include "physics.h"
+#include "doordrv.h"
+#include "btndrv.h"
+#include "motordrv.h"
+#include "trace.h"
+#include "stackmon.h"
+#include "carstate.h"
+#include "journal.h"
+#include "traffic.h"
+#include "bench.h"
+#include "heapstats.h"
+
+// Length of the queue feeding the UART TX task
+#define UART_QUEUE_LENGTH 20
+
+// Stack depth of each task in words. The SS command recommends sizes based on
+// how much of each stack has actually been used.
+#define PHYSICS_STACK_SIZE configMINIMAL_STACK_SIZE
+#define DOOR_STACK_SIZE configMINIMAL_STACK_SIZE
+#define BUTTONS_STACK_SIZE configMINIMAL_STACK_SIZE
+#define MOTOR_STACK_SIZE configMINIMAL_STACK_SIZE
+#define UART_RX_STACK_SIZE configMINIMAL_STACK_SIZE
+#define UART_TX_STACK_SIZE configMINIMAL_STACK_SIZE
+#define STACK_MON_STACK_SIZE configMINIMAL_STACK_SIZE
+#define TRAFFIC_STACK_SIZE configMINIMAL_STACK_SIZE
+#define BENCH_STACK_SIZE configMINIMAL_STACK_SIZE
+#define IDLE_STACK_SIZE configMINIMAL_STACK_SIZE
+
+// Queues, task stacks and control blocks all live here so the memory layout is
+// fixed at link time and nothing is taken from the FreeRTOS heap
+static StaticQueue_t uartQueueBuffer;
+static uint8_t uartQueueStorage[UART_QUEUE_LENGTH * sizeof(char) * TX_SIZE];
+static struct Mailbox doorMailbox;
+static StaticQueue_t doorTxQueueBuffer;
+static uint8_t doorTxQueueStorage[sizeof(enum DOOR_MSG)];
+
+static StaticTask_t physicsTaskBuffer;
+static StackType_t physicsStack[PHYSICS_STACK_SIZE];
+static StaticTask_t doorTaskBuffer;
+static StackType_t doorStack[DOOR_STACK_SIZE];
+static StaticTask_t buttonsTaskBuffer;
+static StackType_t buttonsStack[BUTTONS_STACK_SIZE];
+static StaticTask_t motorTaskBuffer;
+static StackType_t motorStack[MOTOR_STACK_SIZE];
+static StaticTask_t uartRxTaskBuffer;
+static StackType_t uartRxStack[UART_RX_STACK_SIZE];
+static StaticTask_t uartTxTaskBuffer;
+static StackType_t uartTxStack[UART_TX_STACK_SIZE];
+static StaticTask_t stackMonTaskBuffer;
+static StackType_t stackMonStack[STACK_MON_STACK_SIZE];
+static StaticTask_t trafficTaskBuffer;
+static StackType_t trafficStack[TRAFFIC_STACK_SIZE];
+static StaticTask_t benchTaskBuffer;
+static StackType_t benchStack[BENCH_STACK_SIZE];
+static StaticTask_t idleTaskBuffer;
+static StackType_t idleStack[IDLE_STACK_SIZE];
+
+// Parameters for the tasks, which keep pointers to them
+static xUartTaskParameter_t xUartParam;
+static xPhysicsTaskParameter_t xPhysicsParam;
+static xDoorTaskParameter_t xDoorParam;
+static xBtnTaskParameter_t xBtnParam;
+static xTrafficTaskParameter_t xTrafficParam;
+
+/**
+ * Create the queues and tasks
+ */
+void InitApp(void)
+{
+    // Create the queues
+    QueueHandle_t uartQueue = xQueueCreateStatic(UART_QUEUE_LENGTH,
+            sizeof(char) * TX_SIZE,
+            uartQueueStorage,
+            &uartQueueBuffer);
+    QueueHandle_t door_tx_queue = xQueueCreateStatic(1,
+            sizeof(enum DOOR_MSG),
+            doorTxQueueStorage,
+            &doorTxQueueBuffer);
+    InitDoorMailbox(&doorMailbox);
+    
+    // Names for the trace dump
+    TraceNameQueue(uartQueue, "UartQ");
+    TraceNameQueue(door_tx_queue, "DoorTx");
+    TraceNameQueue(doorMailbox.signal, "DoorMbox");
+    
+    // Parameters for the tasks
+    xUartParam = (xUartTaskParameter_t){uartQueue};
+    xPhysicsParam = (xPhysicsTaskParameter_t){uartQueue, &doorMailbox, door_tx_queue};
+    xDoorParam = (xDoorTaskParameter_t){&doorMailbox, door_tx_queue};
+    xBtnParam = (xBtnTaskParameter_t){uartQueue, &doorMailbox};
+    xTrafficParam = (xTrafficTaskParameter_t){&doorMailbox};
+    
+    TaskHandle_t task;
+    
+    // Initialize the command line interface, the input journal, the car
+    // state, the physics model and the kernel benchmarks
+    InitCLI(&doorMailbox);
+    InitJournal();
+    InitCarState();
+    InitPhysics(door_tx_queue);
+    InitBench();
+    
+    // Create the tasks, telling the stack monitor how big each stack is
+    physics_task = xTaskCreateStatic(taskPhysics,
+            "Physics",
+            PHYSICS_STACK_SIZE,
+            (void*)&xPhysicsParam,
+            3,
+            physicsStack,
+            &physicsTaskBuffer);
+    StackMonRegister(physics_task, PHYSICS_STACK_SIZE);
+    
+    task = xTaskCreateStatic(taskDoor,
+            "Door",
+            DOOR_STACK_SIZE,
+            (void*)&xDoorParam,
+            1,
+            doorStack,
+            &doorTaskBuffer);
+    StackMonRegister(task, DOOR_STACK_SIZE);
+    
+    task = xTaskCreateStatic(taskButtons,
+            "Buttons",
+            BUTTONS_STACK_SIZE,
+            (void*)&xBtnParam,
+            1,
+            buttonsStack,
+            &buttonsTaskBuffer);
+    StackMonRegister(task, BUTTONS_STACK_SIZE);
+    
+    task = xTaskCreateStatic(taskMotor,
+            "Motor",
+            MOTOR_STACK_SIZE,
+            NULL,
+            1,
+            motorStack,
+            &motorTaskBuffer);
+    StackMonRegister(task, MOTOR_STACK_SIZE);
+    
+    rx_task = xTaskCreateStatic(taskUARTRx,
+            "UartRx",
+            UART_RX_STACK_SIZE,
+            (void*)&xUartParam,
+            4,
+            uartRxStack,
+            &uartRxTaskBuffer);
+    StackMonRegister(rx_task, UART_RX_STACK_SIZE);
+    
+    task = xTaskCreateStatic(taskUARTTx,
+            "UartTx",
+            UART_TX_STACK_SIZE,
+            (void*)&xUartParam,
+            2,
+            uartTxStack,
+            &uartTxTaskBuffer);
+    StackMonRegister(task, UART_TX_STACK_SIZE);
+    
+    task = xTaskCreateStatic(taskStackMonitor,
+            "StkMon",
+            STACK_MON_STACK_SIZE,
+            NULL,
+            1,
+            stackMonStack,
+            &stackMonTaskBuffer);
+    StackMonRegister(task, STACK_MON_STACK_SIZE);
+    
+    traffic_task = xTaskCreateStatic(taskTraffic,
+            "Traffic",
+            TRAFFIC_STACK_SIZE,
+            (void*)&xTrafficParam,
+            1,
+            trafficStack,
+            &trafficTaskBuffer);
+    StackMonRegister(traffic_task, TRAFFIC_STACK_SIZE);
+    
+    // Above the CLI, so the KB command's notify switches straight to it
+    bench_task = xTaskCreateStatic(taskBench,
+            "Bench",
+            BENCH_STACK_SIZE,
+            NULL,
+            5,
+            benchStack,
+            &benchTaskBuffer);
+    StackMonRegister(bench_task, BENCH_STACK_SIZE);
+    
+    // Everything above comes from static memory, so the heap is still unused
+    struct HeapStats heapStats;
+    HeapStatsGet(&heapStats);
+    configASSERT(heapStats.allocs == 0 && heapStats.failures == 0);
+}
+
+void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint16_t *pusIdleTaskStackSize )
+{
+	/* vApplicationGetIdleTaskMemory() will only be called if
+	configSUPPORT_STATIC_ALLOCATION is set to 1 in FreeRTOSConfig.h.  It hands
+	the kernel the memory to use for the idle task, which is created when the
+	scheduler starts. */
+	*ppxIdleTaskTCBBuffer = &idleTaskBuffer;
+	*ppxIdleTaskStackBuffer = idleStack;
+	*pusIdleTaskStackSize = IDLE_STACK_SIZE;
+}
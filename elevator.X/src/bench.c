@@ -0,0 +1,236 @@
+/**
+ * Kernel primitive microbenchmarks.
+ *
+ * Times the kernel calls the controller's hot paths are built from with the
+ * core timer, so the choice between queues, semaphores and task notifications
+ * can be made on numbers from this board rather than guesses. Each operation
+ * is timed on its own BENCH_ITERATIONS times. The minimum is the cost without
+ * interruptions; the maximum shows what an interrupt landing in the middle
+ * adds.
+ */
+#include <string.h>
+#include <xc.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+#include "bench.h"
+
+// The timer the benchmarks read, the core timer unless the build says
+// otherwise
+#ifndef BENCH_COUNTER
+#define BENCH_COUNTER() _CP0_GET_COUNT()
+#endif
+
+// Timer counts in a tick, taken off the delay benchmark
+#ifndef BENCH_COUNTS_PER_TICK
+#define BENCH_COUNTS_PER_TICK (configCPU_CLOCK_HZ / 2 / configTICK_RATE_HZ)
+#endif
+
+// Time one call, adding it to the operation's samples
+#define MEASURE(op, call) do {                          \
+        uint32_t start = BENCH_COUNTER();               \
+        call;                                           \
+        Record(&samples[op], BENCH_COUNTER() - start);  \
+    } while(0)
+
+// Timer counts for one operation
+struct BenchSamples {
+    uint32_t min;
+    uint32_t max;
+    uint32_t total;
+};
+
+static const char * const names[BENCH_NUM_OPS] = {
+    [BENCH_QUEUE_SEND_200] = "queue_send_200",
+    [BENCH_QUEUE_RECEIVE_200] = "queue_receive_200",
+    [BENCH_QUEUE_SEND_4] = "queue_send_4",
+    [BENCH_QUEUE_RECEIVE_4] = "queue_receive_4",
+    [BENCH_QUEUE_OVERWRITE] = "queue_overwrite",
+    [BENCH_SEM_GIVE_ISR] = "sem_give_isr",
+    [BENCH_SEM_TAKE] = "sem_take",
+    [BENCH_NOTIFY_GIVE] = "notify_give",
+    [BENCH_NOTIFY_TAKE] = "notify_take",
+    [BENCH_YIELD] = "yield",
+    [BENCH_CONTEXT_SWITCH] = "context_switch",
+    [BENCH_DELAY] = "delay"
+};
+
+// The task the context switch is measured against, at a higher priority than
+// anything that runs the benchmarks
+TaskHandle_t bench_task;
+
+// The task running the benchmarks, which bench_task notifies back
+static TaskHandle_t caller;
+
+static StaticQueue_t largeQueueBuffer;
+static uint8_t largeQueueStorage[BENCH_LARGE_ITEM];
+static QueueHandle_t large_queue;
+static StaticQueue_t smallQueueBuffer;
+static uint8_t smallQueueStorage[sizeof(uint32_t)];
+static QueueHandle_t small_queue;
+static StaticQueue_t overwriteQueueBuffer;
+static uint8_t overwriteQueueStorage[sizeof(uint32_t)];
+static QueueHandle_t overwrite_queue;
+static StaticSemaphore_t semaphoreBuffer;
+static SemaphoreHandle_t semaphore;
+
+// Items sent and received, too big for the CLI task's stack
+static uint8_t large_item[BENCH_LARGE_ITEM];
+static struct BenchSamples samples[BENCH_NUM_OPS];
+
+/**
+ * Add a time to an operation's samples
+ */
+static void Record(struct BenchSamples *sample, uint32_t counts)
+{
+    if(counts < sample->min)
+        sample->min = counts;
+    if(counts > sample->max)
+        sample->max = counts;
+    sample->total += counts;
+}
+
+/**
+ * @return The fewest timer counts between two reads of the timer
+ */
+static uint32_t TimerOverhead(void)
+{
+    uint32_t start, counts, least = UINT32_MAX;
+    int i;
+
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        start = BENCH_COUNTER();
+        counts = BENCH_COUNTER() - start;
+        if(counts < least)
+            least = counts;
+    }
+
+    return least;
+}
+
+/**
+ * Convert timer counts to BENCH_UNITs, less the given overhead
+ */
+static uint32_t Cycles(uint32_t counts, uint32_t overhead)
+{
+    return (counts > overhead) ? (counts - overhead) * BENCH_CYCLES_PER_COUNT : 0;
+}
+
+/**
+ * Set up the queues and semaphore the benchmarks use, before the scheduler
+ * starts
+ */
+void InitBench(void)
+{
+    large_queue = xQueueCreateStatic(1, BENCH_LARGE_ITEM,
+            largeQueueStorage, &largeQueueBuffer);
+    small_queue = xQueueCreateStatic(1, sizeof(uint32_t),
+            smallQueueStorage, &smallQueueBuffer);
+    overwrite_queue = xQueueCreateStatic(1, sizeof(uint32_t),
+            overwriteQueueStorage, &overwriteQueueBuffer);
+    semaphore = xSemaphoreCreateBinaryStatic(&semaphoreBuffer);
+}
+
+/**
+ * Run every benchmark. Tasks below the caller's priority don't run until it's
+ * done, apart from during the delay benchmark.
+ *
+ * @param results Filled in with each operation's cost in BENCH_UNITs
+ */
+void BenchRun(struct BenchResult results[BENCH_NUM_OPS])
+{
+    BaseType_t woken;
+    uint32_t small_item = 0, overhead;
+    int op, i;
+
+    for(op = 0; op < BENCH_NUM_OPS; op++)
+    {
+        samples[op].min = UINT32_MAX;
+        samples[op].max = 0;
+        samples[op].total = 0;
+    }
+
+    overhead = TimerOverhead();
+    caller = xTaskGetCurrentTaskHandle();
+
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        MEASURE(BENCH_QUEUE_SEND_200, xQueueSendToBack(large_queue, large_item, 0));
+        MEASURE(BENCH_QUEUE_RECEIVE_200, xQueueReceive(large_queue, large_item, 0));
+        MEASURE(BENCH_QUEUE_SEND_4, xQueueSendToBack(small_queue, &small_item, 0));
+        MEASURE(BENCH_QUEUE_RECEIVE_4, xQueueReceive(small_queue, &small_item, 0));
+        MEASURE(BENCH_QUEUE_OVERWRITE, xQueueOverwrite(overwrite_queue, &small_item));
+
+        // From a task rather than an ISR, but it's the same code
+        woken = pdFALSE;
+        MEASURE(BENCH_SEM_GIVE_ISR, xSemaphoreGiveFromISR(semaphore, &woken));
+        MEASURE(BENCH_SEM_TAKE, xSemaphoreTake(semaphore, 0));
+
+        MEASURE(BENCH_NOTIFY_GIVE, xTaskNotifyGive(caller));
+        MEASURE(BENCH_NOTIFY_TAKE, ulTaskNotifyTake(pdTRUE, 0));
+
+        // Switches out and back in, as nothing else is ready at this priority
+        MEASURE(BENCH_YIELD, taskYIELD());
+
+        // Over to bench_task, which notifies back and blocks again: two
+        // switches, two gives and two takes
+        MEASURE(BENCH_CONTEXT_SWITCH,
+                xTaskNotifyGive(bench_task); ulTaskNotifyTake(pdTRUE, 0));
+    }
+
+    // Start each delay just after a tick, so it waits a whole tick
+    vTaskDelay(1);
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+        MEASURE(BENCH_DELAY, vTaskDelay(1));
+
+    for(op = 0; op < BENCH_NUM_OPS; op++)
+    {
+        struct BenchSamples *sample = &samples[op];
+        struct BenchResult *result = &results[op];
+        uint32_t less = overhead;
+
+        if(op == BENCH_DELAY)
+            less += BENCH_COUNTS_PER_TICK;
+
+        result->min = Cycles(sample->min, less);
+        result->avg = Cycles(sample->total / BENCH_ITERATIONS, less);
+        result->max = Cycles(sample->max, less);
+
+        if(op == BENCH_CONTEXT_SWITCH)
+        {
+            result->min /= 2;
+            result->avg /= 2;
+            result->max /= 2;
+        }
+    }
+}
+
+/**
+ * @return The operation's name, as the KB command prints it
+ */
+const char *BenchName(enum BENCH_OP op)
+{
+    if(op >= BENCH_NUM_OPS)
+        return "?";
+
+    return names[op];
+}
+
+/**
+ * Context Switch Partner Task
+ *
+ * Notifies the task running the benchmarks straight back whenever it's
+ * notified
+ *
+ * @param pvParameters Not used
+ */
+void taskBench(void *pvParameters)
+{
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(caller);
+    }
+}
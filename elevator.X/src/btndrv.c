@@ -20,7 +20,9 @@
 #include <queue.h>
 #include "uartdrv.h"
 #include "physics.h"
+#include "carstate.h"
 #include "btndrv.h"
+#include "journal.h"
 
 // Macros for button GPIO lines
 #define SW1 BIT_6
@@ -33,6 +35,55 @@
 static const TickType_t swDelay = 15 / portTICK_PERIOD_MS;
 static const TickType_t pollDelay = 100 / portTICK_PERIOD_MS;
 
+// Where the journal replay is up to, only used while replaying
+static struct JournalCursor replay;
+
+/**
+ * While the journal is being replayed, press the buttons it recorded instead
+ * of reading the pins. Takes as long as debouncing did.
+ * 
+ * @param swNum The switch to check
+ * @param sw_pressed Set if the switch was pressed (and wasn't a bounce)
+ * 
+ * @return False once the replay is over and the pins should be read
+ */
+static bool ReplayPress(uint32_t swNum, bool *sw_pressed)
+{
+    struct JournalEntry entry;
+    uint8_t bit = (uint8_t)__builtin_ctz(swNum);
+    
+    if(!JournalReplaying() || !JournalPeek(&replay, &entry))
+        return false;
+    
+    *sw_pressed = false;
+    
+    if(entry.data == bit && entry.tick <= xTaskGetTickCount())
+    {
+        JournalNext(&replay);
+        vTaskDelay(swDelay);
+        
+        // The bounce entry was recorded after the debounce delay
+        *sw_pressed = !(JournalPeek(&replay, &entry) && entry.data == (bit | JOURNAL_BOUNCE));
+        if(!*sw_pressed)
+            JournalNext(&replay);
+    }
+    
+    return true;
+}
+
+/**
+ * Record a switch that read as pressed, and whether debouncing agreed
+ * 
+ * @param swNum The switch
+ * @param bounced True if it wasn't still pressed after the debounce delay
+ */
+static void RecordPress(uint32_t swNum, bool bounced)
+{
+    uint8_t bit = (uint8_t)__builtin_ctz(swNum);
+    
+    JournalRecord(JOURNAL_BUTTON, bounced ? (bit | JOURNAL_BOUNCE) : bit);
+}
+
 /**
  * Checks to see if a button is pressed, and if so, debounces it
  * 
@@ -42,11 +93,17 @@ static bool CheckAndDebounceD(uint32_t swNum)
 {
     bool sw_pressed = false;
     
+    if(ReplayPress(swNum, &sw_pressed))
+        return sw_pressed;
+    
     if(!mPORTDReadBits(swNum))
     {
+        RecordPress(swNum, false);
         vTaskDelay(swDelay);
         if(!mPORTDReadBits(swNum))
             sw_pressed = true;
+        else
+            RecordPress(swNum, true);
     }
     
     return sw_pressed;
@@ -61,24 +118,22 @@ static bool CheckAndDebounceC(uint32_t swNum)
 {
     bool sw_pressed = false;
     
+    if(ReplayPress(swNum, &sw_pressed))
+        return sw_pressed;
+    
     if(!mPORTCReadBits(swNum))
     {
+        RecordPress(swNum, false);
         vTaskDelay(swDelay);
         if(!mPORTCReadBits(swNum))
             sw_pressed = true;
+        else
+            RecordPress(swNum, true);
     }
     
     return sw_pressed;
 }
 
-void SendToFloor(int floor)
-{
-    if(GetGoingUp())
-        SetRequest(floor, UP);
-    else
-        SetRequest(floor, DOWN);
-}
-
 // Handle button presses and debouncing
 void taskButtons(void *pvParameters)
 {
@@ -86,12 +141,14 @@ void taskButtons(void *pvParameters)
     xBtnTaskParameter_t *taskParam;
     taskParam = (xBtnTaskParameter_t *)pvParameters;
     
+    JournalStart(&replay, JOURNAL_BUTTON);
+    
     while(1)
     {
         // P2 button inside car
         if(CheckAndDebounceD(SW1))
         {
-            SendToFloor(2);
+            SetCarRequest(2);
             snprintf(buffer, TX_SIZE, "Floor Requested\r\n");
             xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
         }
@@ -99,7 +156,7 @@ void taskButtons(void *pvParameters)
         // P1 button inside car
         if(CheckAndDebounceD(SW2))
         {
-            SendToFloor(1);
+            SetCarRequest(1);
             snprintf(buffer, TX_SIZE, "Floor Requested\r\n");
             xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
         }
@@ -107,7 +164,7 @@ void taskButtons(void *pvParameters)
         // GD button inside car
         if(CheckAndDebounceD(SW3))
         {
-            SendToFloor(0);
+            SetCarRequest(0);
             snprintf(buffer, TX_SIZE, "Floor Requested\r\n");
             xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
         }
@@ -116,11 +173,11 @@ void taskButtons(void *pvParameters)
         if(CheckAndDebounceC(SW4))
         {
             enum DOOR_MSG msg;
-            if(!GetIsMoving())
+            if(CarStateFlags() & STATE_STOPPED)
             {
                 sprintf(buffer, "Door Opening\r\n");
                 msg = OPEN_CLOSE_SEQ;
-                xQueueOverwrite(taskParam->door_rx_queue, (void*)&msg);
+                MailboxPost(taskParam->door_mailbox, msg);
             }
             else
                 sprintf(buffer, "Can't open door while car is moving\r\n");
@@ -133,11 +190,11 @@ void taskButtons(void *pvParameters)
         {
             enum DOOR_MSG msg;
     
-            if(!GetIsMoving())
+            if(CarStateFlags() & STATE_STOPPED)
             {
                 sprintf(buffer, "Door Closing\r\n");
                 msg = CLOSE;
-                xQueueOverwrite(taskParam->door_rx_queue, (void*)&msg);
+                MailboxPost(taskParam->door_mailbox, msg);
                 xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
             }
         }
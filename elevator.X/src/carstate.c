@@ -0,0 +1,236 @@
+/**
+ * Broadcasts the state of the car.
+ *
+ * The physics and door tasks publish every transition (moving or stopped, door
+ * open or closed, emergency, direction) to an event group, so other tasks can
+ * block until the state they care about comes up instead of polling. The
+ * location and speed change too often for that, so they're kept with a copy of
+ * the flags and read all together as a snapshot. The physics task publishes
+ * where the car will be at the end of each stretch of its motion, and the
+ * location and speed are interpolated along it when read, so they're exact to
+ * the tick however often they're read.
+ *
+ * The snapshot is a seqlock: the sequence number is odd while it's being
+ * written, and a reader copies it until it sees the same even number before
+ * and after the copy. Writers suspend the scheduler, so a reader can never
+ * preempt a half finished write and spin, and readers never lock anything, so
+ * a low priority reader can't hold up the physics task.
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <event_groups.h>
+#include "carstate.h"
+
+static EventGroupHandle_t state_group;
+static StaticEventGroup_t state_group_buffer;
+
+// Only written with the scheduler suspended, read without any lock
+static volatile uint32_t sequence;
+static struct CarState state;
+static struct CarSegment segment;
+
+// Keeps the compiler (and the CPU) from moving accesses across the sequence
+#define SEQ_BARRIER() __sync_synchronize()
+
+// Run in the middle of a reader's copy. The host's thread test (see
+// host/test/carstate_stress.c) yields there, to land writes inside reads, and
+// builds a copy without the retry to show the reads tear without it.
+#ifndef CARSTATE_READ_HOOK
+#define CARSTATE_READ_HOOK()
+#endif
+#ifndef CARSTATE_READ_RETRY
+#define CARSTATE_READ_RETRY 1
+#endif
+
+/**
+ * Start changing the snapshot. Readers retry until EndWrite().
+ */
+static void BeginWrite(void)
+{
+    vTaskSuspendAll();
+    sequence++;
+    SEQ_BARRIER();
+}
+
+/**
+ * Finish changing the snapshot
+ */
+static void EndWrite(void)
+{
+    SEQ_BARRIER();
+    sequence++;
+    xTaskResumeAll();
+}
+
+/**
+ * Create the event group. Must be called before any task publishes or waits
+ * on the state. The car starts stopped on the ground floor, with the door
+ * closed, going up.
+ */
+void InitCarState(void)
+{
+    state_group = xEventGroupCreateStatic(&state_group_buffer);
+
+    state.location = 0.0f;
+    state.speed = 0.0f;
+    state.dest = 0;
+    segment.start = segment.end = 0;
+    segment.location = segment.end_location = 0.0f;
+    segment.speed = segment.end_speed = 0.0f;
+    state.flags = 0;
+
+    CarStateSetFlags(STATE_STOPPED | STATE_DOOR_CLOSED | STATE_NORMAL |
+                     STATE_GOING_UP);
+}
+
+/**
+ * Find where the car is along a segment. Position follows a cubic that
+ * matches the speeds at both ends, speed changes linearly.
+ *
+ * @param from The segment
+ * @param now The tick to find the car at
+ * @param up True if the car is going up
+ * @param snapshot Its location and speed are filled in
+ */
+static void Interpolate(const struct CarSegment *from, TickType_t now, bool up,
+                        struct CarState *snapshot)
+{
+    TickType_t length = from->end - from->start;
+    TickType_t into = now - from->start;
+    float h, u, u2, u3, v0, v1;
+
+    if(length == 0 || (int32_t)(now - from->end) >= 0)
+    {
+        snapshot->location = from->end_location;
+        snapshot->speed = from->end_speed;
+        return;
+    }
+
+    // Published just before it starts
+    if((int32_t)into <= 0)
+    {
+        snapshot->location = from->location;
+        snapshot->speed = from->speed;
+        return;
+    }
+
+    h = (length * portTICK_PERIOD_MS) / 1000.0f;
+    u = (float)into / length;
+    u2 = u * u;
+    u3 = u2 * u;
+    v0 = up ? from->speed : -from->speed;
+    v1 = up ? from->end_speed : -from->end_speed;
+
+    snapshot->location = (2.0f * u3 - 3.0f * u2 + 1.0f) * from->location
+                       + (u3 - 2.0f * u2 + u) * h * v0
+                       + (3.0f * u2 - 2.0f * u3) * from->end_location
+                       + (u3 - u2) * h * v1;
+    snapshot->speed = (1.0f - u) * from->speed + u * from->end_speed;
+}
+
+/**
+ * Publish where the car is while it's standing still. Doesn't wake anybody up.
+ *
+ * @param location The car's location in feet
+ * @param speed The car's speed in feet per second
+ * @param dest The request number of the car's destination
+ */
+void CarStateSetMotion(float location, float speed, int dest)
+{
+    struct CarSegment still;
+
+    still.start = still.end = xTaskGetTickCount();
+    still.location = still.end_location = location;
+    still.speed = still.end_speed = speed;
+
+    CarStateSetSegment(&still, dest);
+}
+
+/**
+ * Publish the next stretch of the car's motion, before the car gets there.
+ * Doesn't wake anybody up.
+ *
+ * @param next The segment
+ * @param dest The request number of the car's destination
+ */
+void CarStateSetSegment(const struct CarSegment *next, int dest)
+{
+    BeginWrite();
+    {
+        segment = *next;
+        state.dest = dest;
+    }
+    EndWrite();
+}
+
+/**
+ * Publish state transitions, waking every task waiting on them
+ *
+ * @param bits The STATE_ bits that are now set. Their partners are cleared.
+ */
+void CarStateSetFlags(EventBits_t bits)
+{
+    EventBits_t partners = STATE_PARTNER(bits);
+
+    // Nobody gets to see a pair with neither bit set
+    vTaskSuspendAll();
+    {
+        BeginWrite();
+        {
+            state.flags = (state.flags & ~partners) | bits;
+        }
+        EndWrite();
+
+        xEventGroupClearBits(state_group, partners);
+        xEventGroupSetBits(state_group, bits);
+    }
+    xTaskResumeAll();
+}
+
+/**
+ * Read every part of the car's state at once. Never blocks. Not for use in
+ * an interrupt, which would spin forever if it landed in the middle of a write.
+ *
+ * @param snapshot Filled in with the state
+ */
+void CarStateGet(struct CarState *snapshot)
+{
+    struct CarSegment along;
+    uint32_t before, after;
+    
+    do
+    {
+        before = sequence;
+        SEQ_BARRIER();
+        *snapshot = state;
+        CARSTATE_READ_HOOK();
+        along = segment;
+        SEQ_BARRIER();
+        after = sequence;
+    } while(CARSTATE_READ_RETRY && ((before & 1) || before != after));
+    
+    Interpolate(&along, xTaskGetTickCount(), (snapshot->flags & STATE_GOING_UP) != 0,
+                snapshot);
+}
+
+/**
+ * @return The STATE_ bits that are set
+ */
+EventBits_t CarStateFlags(void)
+{
+    return xEventGroupGetBits(state_group);
+}
+
+/**
+ * Block until any of the given bits are set
+ *
+ * @param bits The STATE_ bits to wait for
+ * @param timeout How long to wait
+ *
+ * @return The STATE_ bits set when the wait ended. None of the wanted bits are
+ *         set if it timed out.
+ */
+EventBits_t CarStateWait(EventBits_t bits, TickType_t timeout)
+{
+    return xEventGroupWaitBits(state_group, bits, pdFALSE, pdFALSE, timeout);
+}
@@ -5,19 +5,43 @@
  */
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <FreeRTOS.h>
 #include <FreeRTOS_CLI.h>
+#include <task.h>
 #include <queue.h>
 #include "physics.h"
+#include "carstate.h"
+#include "journal.h"
+#include "perfstats.h"
+#include "traffic.h"
+#include "bench.h"
+#include "dispatch.h"
+#include "parking.h"
+#include "energy.h"
+#include "eta.h"
+#include "heapstats.h"
+#include "runstats.h"
+#include "trace.h"
+#include "stackmon.h"
 
 // The maximum length of the parameter strings
 #define MAX_PARAM_LEN 10
 
+// The most tasks the TS command can list
+#define MAX_TASKS 16
+
+// Trace events per line of the TR dump
+#define TRACE_EVENTS_PER_LINE 8
+
 // Strings sent to the terminal
 static const char taskListHdr[] = "Name\t\tStat\tPri\tS/Space\tTCB\r\n";
 
-// Queue for sending door messages
-static QueueHandle_t door_queue;
+// Mailbox for sending door messages
+static struct Mailbox *door_mbox;
+
+// Long enough for the UART to send what's queued before JP resets the board
+static const TickType_t replayResetDelay = 500 / portTICK_PERIOD_MS;
 
 /**
  * Convert a CLI parameter into an integer
@@ -61,15 +85,358 @@ static float GetFloatParam(const char *commandString)
 
 /**
  * Task stats command
+ * 
+ * Prints one task per call so the output never overruns the write buffer,
+ * however many tasks there are
  */
 static portBASE_TYPE prvTaskStatsCommand(char *pcWriteBuffer, 
                                   size_t xWriteBufferLen,
                                   const char *pcCommandString)
 {
-    sprintf(pcWriteBuffer, taskListHdr);
-    pcWriteBuffer += strlen(taskListHdr);
-    vTaskList(pcWriteBuffer);
+    static const char states[] = {'X', 'R', 'B', 'S', 'D'};
+    static TaskStatus_t tasks[MAX_TASKS];
+    static UBaseType_t num_tasks;
+    static UBaseType_t line = 0;
+    TaskStatus_t *task;
+    
+    // Take a snapshot of every task up front so the table is consistent
+    if(line == 0)
+    {
+        num_tasks = uxTaskGetSystemState(tasks, MAX_TASKS, NULL);
+        
+        if(num_tasks == 0)
+            snprintf(pcWriteBuffer, xWriteBufferLen, "More than %d tasks, increase MAX_TASKS\r\n", MAX_TASKS);
+        else
+            snprintf(pcWriteBuffer, xWriteBufferLen, "%s", taskListHdr);
+        
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line <= num_tasks)
+    {
+        task = &tasks[line - 1];
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%-*s\t%c\t%u\t%u\t%u\r\n",
+                 configMAX_TASK_NAME_LEN - 1, task->pcTaskName,
+                 states[task->eCurrentState],
+                 (unsigned int)task->uxCurrentPriority,
+                 (unsigned int)task->usStackHighWaterMark,
+                 (unsigned int)task->xTaskNumber);
+        line++;
+        return pdTRUE;
+    }
+    
+    *pcWriteBuffer = '\0';
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Heap statistics command
+ * 
+ * Prints one line per call so the output never overruns the write buffer
+ */
+static portBASE_TYPE prvHeapStatsCommand(char *pcWriteBuffer, 
+                                  size_t xWriteBufferLen,
+                                  const char *pcCommandString)
+{
+    static struct HeapStats stats;
+    static int line = 0;
+    struct HeapSite site;
+    
+    // Totals first, then the histogram, then each caller
+    if(line == 0)
+    {
+        HeapStatsGet(&stats);
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Free %u  Min ever %u  Largest %u\r\nAllocs %lu  Frees %lu  Fails %lu (last %u bytes)\r\n",
+                 (unsigned int)stats.free_bytes, (unsigned int)stats.min_ever_free_bytes,
+                 (unsigned int)stats.largest_free_block, (unsigned long)stats.allocs,
+                 (unsigned long)stats.frees, (unsigned long)stats.failures,
+                 (unsigned int)stats.last_failed_size);
+        line++;
+        return pdTRUE;
+    }
+    
+    // Skip the empty size classes
+    while(line <= HEAP_STATS_BINS && stats.histogram[line - 1] == 0)
+        line++;
+    
+    if(line <= HEAP_STATS_BINS)
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Free blocks >= %u bytes: %lu\r\n",
+                 1U << (line - 1), (unsigned long)stats.histogram[line - 1]);
+        line++;
+        return pdTRUE;
+    }
+    
+    if(HeapStatsGetSite(line - HEAP_STATS_BINS - 1, &site))
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Caller %08" PRIxPTR ": allocs %lu  fails %lu  bytes %u\r\n",
+                 (uintptr_t)site.caller, (unsigned long)site.allocs,
+                 (unsigned long)site.failures, (unsigned int)site.bytes);
+        line++;
+        return pdTRUE;
+    }
+    
+    *pcWriteBuffer = '\0';
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Run time statistics command
+ * 
+ * "RTS" prints how the CPU was shared since the window was last reset, one
+ * task per call. "RTS R" resets the window.
+ */
+static portBASE_TYPE prvRunTimeStatsCommand(char *pcWriteBuffer, 
+                                  size_t xWriteBufferLen,
+                                  const char *pcCommandString)
+{
+    static struct TaskRunTime tasks[RUN_STATS_MAX_TASKS];
+    static int num_tasks;
+    static uint32_t total;
+    static int line = 0;
+    const char *param;
+    portBASE_TYPE len;
+    uint32_t tenths;
+    
+    if(line == 0)
+    {
+        param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+        
+        if(param != NULL && (*param == 'R' || *param == 'r'))
+        {
+            RunStatsReset();
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Run time stats window reset\r\n");
+            return pdFALSE;
+        }
+        
+        num_tasks = RunStatsGet(tasks, RUN_STATS_MAX_TASKS, &total);
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Window %lu ms\r\nName\t\tTime(us)\t%%CPU\r\n",
+                 (unsigned long)(((uint64_t)total << RUN_STATS_SHIFT) / (configCPU_CLOCK_HZ / 2000)));
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line <= num_tasks)
+    {
+        // Avoid dividing by zero if the window was reset a moment ago
+        if(total > 0)
+            tenths = (uint32_t)(((uint64_t)tasks[line - 1].run_time * 1000) / total);
+        else
+            tenths = 0;
+        
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%s\t\t%lu\t\t%lu.%lu\r\n",
+                 tasks[line - 1].name,
+                 (unsigned long)(((uint64_t)tasks[line - 1].run_time << RUN_STATS_SHIFT) / (configCPU_CLOCK_HZ / 2000000)),
+                 (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+        line++;
+        return pdTRUE;
+    }
+    
+    *pcWriteBuffer = '\0';
+    line = 0;
+    return pdFALSE;
+}
 
+/**
+ * Trace command
+ * 
+ * "TR" pauses the trace recorder and dumps it, then starts a fresh recording.
+ * The dump names every task, queue and interrupt, then lists the events in
+ * hex, a few per call. "TR C" just starts a fresh recording. Capture the dump
+ * and run it through tools/trace2chrome.py to view it.
+ */
+static portBASE_TYPE prvTraceCommand(char *pcWriteBuffer, 
+                                  size_t xWriteBufferLen,
+                                  const char *pcCommandString)
+{
+    static TaskStatus_t tasks[MAX_TASKS];
+    static UBaseType_t num_tasks;
+    static int line = 0;
+    static int item;
+    struct TraceEvent event;
+    const char *param;
+    const char *name;
+    portBASE_TYPE len;
+    int pos, i;
+    
+    if(line == 0)
+    {
+        param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+        
+        if(param != NULL && (*param == 'C' || *param == 'c'))
+        {
+            TraceRestart();
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Trace restarted\r\n");
+            return pdFALSE;
+        }
+        
+        TracePause();
+        num_tasks = uxTaskGetSystemState(tasks, MAX_TASKS, NULL);
+        snprintf(pcWriteBuffer, xWriteBufferLen, "TRACE %lu %d\r\n",
+                 (unsigned long)TRACE_TIMESTAMP_HZ, TraceNumEvents());
+        item = 0;
+        line++;
+        return pdTRUE;
+    }
+    
+    // Names first, so the converter can label the events
+    if(line == 1)
+    {
+        if(item < num_tasks)
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "T %u %s\r\n",
+                     (unsigned int)tasks[item].xTaskNumber, tasks[item].pcTaskName);
+            item++;
+            return pdTRUE;
+        }
+        
+        item = 0;
+        line++;
+    }
+    
+    if(line == 2)
+    {
+        if((name = TraceQueueName(item + 1)) != NULL)
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Q %d %s\r\n", item + 1, name);
+            item++;
+            return pdTRUE;
+        }
+        
+        item = 0;
+        line++;
+    }
+    
+    if(line == 3)
+    {
+        if((name = TraceIsrName(item + 1)) != NULL)
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "I %d %s\r\n", item + 1, name);
+            item++;
+            return pdTRUE;
+        }
+        
+        item = 0;
+        line++;
+    }
+    
+    // Each event is time, type, id and arg packed into 16 hex digits
+    if(line == 4 && item < TraceNumEvents())
+    {
+        pos = snprintf(pcWriteBuffer, xWriteBufferLen, "E");
+        
+        for(i = 0; i < TRACE_EVENTS_PER_LINE && TraceGetEvent(item, &event); i++, item++)
+        {
+            pos += snprintf(pcWriteBuffer + pos, xWriteBufferLen - pos, " %08lx%02x%02x%04x",
+                            (unsigned long)event.time, event.type, event.id, event.arg);
+        }
+        
+        snprintf(pcWriteBuffer + pos, xWriteBufferLen - pos, "\r\n");
+        return pdTRUE;
+    }
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen, "END\r\n");
+    TraceRestart();
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Stack statistics command
+ * 
+ * Prints the stack use the stack monitor has seen for each task, with a
+ * recommended size, one task per call. A recommendation is only as good as
+ * the run it is based on, so exercise every feature before trusting it.
+ */
+static portBASE_TYPE prvStackStatsCommand(char *pcWriteBuffer, 
+                                  size_t xWriteBufferLen,
+                                  const char *pcCommandString)
+{
+    static struct StackUsage tasks[STACK_MON_MAX_TASKS];
+    static int num_tasks;
+    static int line = 0;
+    static uint32_t total_size, total_recommended;
+    struct StackUsage *task;
+    
+    if(line == 0)
+    {
+        num_tasks = StackMonGet(tasks, STACK_MON_MAX_TASKS);
+        total_size = 0;
+        total_recommended = 0;
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Name\t\tSize\tMinFree\tRecommend (words)\r\n");
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line <= num_tasks)
+    {
+        task = &tasks[line - 1];
+        
+        if(task->size > 0)
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "%-*s\t%u\t%u\t%u\r\n",
+                     configMAX_TASK_NAME_LEN - 1, task->name, (unsigned int)task->size,
+                     (unsigned int)task->min_free, (unsigned int)task->recommended);
+            total_size += task->size;
+            total_recommended += task->recommended;
+        }
+        else
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "%-*s\t?\t%u\t?\r\n",
+                     configMAX_TASK_NAME_LEN - 1, task->name, (unsigned int)task->min_free);
+        }
+        
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line == num_tasks + 1)
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%-*s\t%u\t%u\t-\r\n",
+                 configMAX_TASK_NAME_LEN - 1, "ISR", (unsigned int)configISR_STACK_SIZE,
+                 (unsigned int)StackMonIsrMinFree());
+        line++;
+        return pdTRUE;
+    }
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Task stacks %lu words, recommended %lu (%ld bytes saved)\r\n",
+             (unsigned long)total_size, (unsigned long)total_recommended,
+             ((long)total_size - (long)total_recommended) * (long)sizeof(StackType_t));
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Low power command. Shows how often the idle task slept with the tick
+ * suppressed and how many tick interrupts that avoided since reset.
+ */
+static portBASE_TYPE prvLowPowerCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+#if configUSE_TICKLESS_IDLE == 1
+    uint32_t sleeps, suppressed;
+    TickType_t ticks = xTaskGetTickCount();
+    uint32_t tenths = 0;
+    
+    vPortGetTicklessStats(&sleeps, &suppressed);
+    
+    if(ticks > 0)
+        tenths = (uint32_t)(((uint64_t)suppressed * 1000) / ticks);
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Idle sleeps\t%lu\r\nTicks\t\t%lu\r\nWakeups avoided\t%lu (%lu.%lu%%)\r\n",
+             (unsigned long)sleeps, (unsigned long)ticks, (unsigned long)suppressed,
+             (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+#else
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Tickless idle is disabled\r\n");
+#endif
+    
     return pdFALSE;
 }
 
@@ -151,11 +518,11 @@ static portBASE_TYPE prvEmergClearCommand(char *pcWriteBuffer,
 {
     enum DOOR_MSG msg;
     
-    if(!GetIsMoving())
+    if(CarStateFlags() & STATE_STOPPED)
     {
         sprintf(pcWriteBuffer, "Door Closing\r\n");
         msg = CLOSE;
-        xQueueOverwrite(door_queue, (void*)&msg);
+        MailboxPost(door_mbox, msg);
     }
     else
         sprintf(pcWriteBuffer, "wait until the car is stopped before clearing emergency status\r\n");
@@ -174,11 +541,11 @@ static portBASE_TYPE prvDoorInterferenceCommand(char *pcWriteBuffer,
     // We have nothing to output so set it to null
     *pcWriteBuffer = NULL;
     
-    if(!GetIsMoving())
+    if(CarStateFlags() & STATE_STOPPED)
     {
         sprintf(pcWriteBuffer, "Door Opening\r\n");
         msg = OPEN_CLOSE_SEQ;
-        xQueueOverwrite(door_queue, (void*)&msg);
+        MailboxPost(door_mbox, msg);
     }
     else
         sprintf(pcWriteBuffer, "Can't open door while car is moving\r\n");
@@ -218,6 +585,22 @@ static portBASE_TYPE prvChangeAccelCommand(char *pcWriteBuffer,
     return pdFALSE;
 }
 
+/**
+ * Change jerk limit command
+ */
+static portBASE_TYPE prvChangeJerkCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    float jerk = GetFloatParam(pcCommandString);
+    
+    sprintf(pcWriteBuffer, "Jerk limit updated\r\n");
+    
+    SetJerk(jerk);
+    
+    return pdFALSE;
+}
+
 /**
  * Send to floor command
  */
@@ -231,10 +614,7 @@ static portBASE_TYPE prvSendToFloorCommand(char *pcWriteBuffer,
     {
         sprintf(pcWriteBuffer, "Floor Requested\r\n");
 
-        if(GetGoingUp())
-            SetRequest(floor, UP);
-        else
-            SetRequest(floor, DOWN);
+        SetCarRequest(floor);
     }
     else
         sprintf(pcWriteBuffer, "Floor number has to be between 0 and 2\r\n");
@@ -242,6 +622,467 @@ static portBASE_TYPE prvSendToFloorCommand(char *pcWriteBuffer,
     return pdFALSE;
 }
 
+/**
+ * Car state command, every field read from the same snapshot
+ */
+static portBASE_TYPE prvCarStateCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    struct CarState state;
+    
+    CarStateGet(&state);
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "%.2f Feet :: %.2f ft/s :: Floor %s\r\n%s %s %s %s\r\n",
+             state.location, state.speed, GetRequest(state.dest).acronym,
+             (state.flags & STATE_MOVING) ? "Moving" : "Stopped",
+             (state.flags & STATE_GOING_UP) ? "Up" : "Down",
+             (state.flags & STATE_DOOR_OPEN) ? "DoorOpen" : "DoorClosed",
+             (state.flags & STATE_EMERGENCY) ? "Emergency" : "Normal");
+    
+    return pdFALSE;
+}
+
+/**
+ * Journal dump command, one input per call
+ */
+static portBASE_TYPE prvJournalDumpCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    static struct JournalCursor cursor;
+    static int line = 0;
+    struct JournalEntry entry;
+    
+    if(line == 0)
+    {
+        JournalStart(&cursor, JOURNAL_UART | JOURNAL_KEY | JOURNAL_BUTTON);
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Journal: %lu entries, %lu lost, %s\r\n",
+                 (unsigned long)JournalCount(), (unsigned long)JournalLost(),
+                 JournalReplaying() ? "replaying" : "recording");
+        line++;
+        return pdTRUE;
+    }
+    
+    if(!JournalPeek(&cursor, &entry))
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen, "END\r\n");
+        line = 0;
+        return pdFALSE;
+    }
+    
+    JournalNext(&cursor);
+    
+    if(entry.source == JOURNAL_BUTTON)
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%lu\tButton\tbit %u%s\r\n",
+                 (unsigned long)entry.tick, entry.data & ~JOURNAL_BOUNCE,
+                 (entry.data & JOURNAL_BOUNCE) ? " bounce" : "");
+    else if(entry.data >= ' ' && entry.data <= '~')
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%lu\t%s\t'%c'\r\n",
+                 (unsigned long)entry.tick,
+                 (entry.source == JOURNAL_KEY) ? "Key" : "Line", entry.data);
+    else
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%lu\t%s\t0x%02x\r\n",
+                 (unsigned long)entry.tick,
+                 (entry.source == JOURNAL_KEY) ? "Key" : "Line", entry.data);
+    
+    return pdTRUE;
+}
+
+/**
+ * Journal replay command. Resets the board, which then replays every input
+ * recorded since it last booted.
+ */
+static portBASE_TYPE prvJournalReplayCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    static bool resetting = false;
+    
+    // Second call, once the message below has been queued
+    if(resetting)
+    {
+        vTaskDelay(replayResetDelay);
+        JournalReplay();
+    }
+    
+    if(!JournalCanReplay())
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Journal is full and lost its start, can't replay\r\n");
+        return pdFALSE;
+    }
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Resetting to replay the journal\r\n");
+    resetting = true;
+    
+    return pdTRUE;
+}
+
+/**
+ * Performance stats command
+ * 
+ * "PS" prints one key=value line per measurement, all prefixed with PERF so a
+ * script can pick them out of a capture. "PS R" starts measuring again.
+ */
+static portBASE_TYPE prvPerfStatsCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    static const char * const callNames[PERF_NUM_CALLS] = { "wait", "journey" };
+    static struct PerfReport report;
+    static struct EnergyStats energy;
+    static int line = 0;
+    struct PerfTimes *times;
+    const char *param;
+    portBASE_TYPE len;
+    
+    if(line == 0)
+    {
+        param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+        
+        if(param != NULL && (*param == 'R' || *param == 'r'))
+        {
+            PerfReset();
+            EnergyResetStats();
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Performance stats reset\r\n");
+            return pdFALSE;
+        }
+        
+        PerfGetReport(&report);
+        EnergyGetStats(&energy);
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "PERF elapsed_ms=%lu calls_per_hour=%lu policy=%s\r\n",
+                 (unsigned long)report.elapsed_ms, (unsigned long)report.calls_per_hour,
+                 DispatchPolicyName(DispatchGetPolicy()));
+        line++;
+        return pdTRUE;
+    }
+    
+    // Wait and journey times
+    if(line <= PERF_NUM_CALLS)
+    {
+        times = &report.times[line - 1];
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "PERF %s n=%lu avg_ms=%lu p95_ms=%lu p99_ms=%lu max_ms=%lu\r\n",
+                 callNames[line - 1], (unsigned long)times->count,
+                 (unsigned long)times->avg, (unsigned long)times->p95,
+                 (unsigned long)times->p99, (unsigned long)times->max);
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line == PERF_NUM_CALLS + 1)
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "PERF dispatch n=%lu avg_counts=%lu max_counts=%lu avg_us=%lu max_us=%lu intercepts=%lu\r\n",
+                 (unsigned long)report.dispatches, (unsigned long)report.dispatch_avg,
+                 (unsigned long)report.dispatch_max,
+                 (unsigned long)(report.dispatch_avg / PERF_COUNTS_PER_US),
+                 (unsigned long)(report.dispatch_max / PERF_COUNTS_PER_US),
+                 (unsigned long)report.intercepts);
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line == PERF_NUM_CALLS + 2)
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "PERF estop n=%lu last_us=%lu max_us=%lu\r\n",
+                 (unsigned long)report.estops,
+                 (unsigned long)(report.estop_last / PERF_COUNTS_PER_US),
+                 (unsigned long)(report.estop_max / PERF_COUNTS_PER_US));
+        line++;
+        return pdTRUE;
+    }
+    
+    if(line == PERF_NUM_CALLS + 3)
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "PERF energy trips=%lu total_kj=%.1f avg_kj=%.1f eco=%s slack_pct=%lu\r\n",
+                 (unsigned long)energy.trips, energy.total_j / 1000.0f,
+                 energy.trips ? energy.total_j / 1000.0f / energy.trips : 0.0f,
+                 energy.eco ? "on" : "off", (unsigned long)energy.slack);
+        line++;
+        return pdTRUE;
+    }
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "PERF uart_queue samples=%lu avg=%lu.%02lu max=%lu\r\n",
+             (unsigned long)report.queue_samples,
+             (unsigned long)(report.queue_avg_x100 / 100),
+             (unsigned long)(report.queue_avg_x100 % 100),
+             (unsigned long)report.queue_max);
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Traffic generator command
+ * 
+ * "TG" shows what the generator has done, "TG <profile> <calls/hour> [seed]"
+ * starts it (throwing away the last run's passengers) and "TG OFF" stops it
+ */
+static portBASE_TYPE prvTrafficCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    struct TrafficStats stats;
+    enum TRAFFIC_PROFILE profile;
+    const char *param, *name;
+    portBASE_TYPE len, rateLen, seedLen;
+    const char *rate, *seed;
+    
+    param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+    
+    if(param == NULL)
+    {
+        TrafficGetStats(&stats);
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Traffic %s %s %lu/h\r\n"
+                 "arrived=%lu boarded=%lu delivered=%lu waiting=%lu riding=%lu emergencies=%lu\r\n",
+                 stats.running ? "on" : "off", TrafficProfileName(stats.profile),
+                 (unsigned long)stats.calls_per_hour,
+                 (unsigned long)stats.arrived, (unsigned long)stats.boarded,
+                 (unsigned long)stats.delivered, (unsigned long)stats.waiting,
+                 (unsigned long)stats.riding, (unsigned long)stats.emergencies);
+        return pdFALSE;
+    }
+    
+    if(len == 3 && strncmp(param, "OFF", 3) == 0)
+    {
+        TrafficStop();
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Traffic stopped\r\n");
+        return pdFALSE;
+    }
+    
+    for(profile = 0; profile < TRAFFIC_NUM_PROFILES; profile++)
+    {
+        name = TrafficProfileName(profile);
+        if(strlen(name) == (size_t)len && strncmp(param, name, len) == 0)
+            break;
+    }
+    
+    // The numbers end at a space or the end of the line, so strtoul() can
+    // read them where they are
+    rate = FreeRTOS_CLIGetParameter(pcCommandString, 2, &rateLen);
+    seed = FreeRTOS_CLIGetParameter(pcCommandString, 3, &seedLen);
+    
+    if(profile == TRAFFIC_NUM_PROFILES || rate == NULL ||
+       !TrafficStart(profile, strtoul(rate, NULL, 10),
+                     (seed != NULL) ? strtoul(seed, NULL, 10) : xTaskGetTickCount()))
+    {
+        snprintf(pcWriteBuffer, xWriteBufferLen,
+                 "Usage: TG [UNIFORM|UP|DOWN|LUNCH|STORM <calls/hour> [seed]|OFF]\r\n");
+        return pdFALSE;
+    }
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Traffic started\r\n");
+    return pdFALSE;
+}
+
+/**
+ * Kernel benchmark command
+ * 
+ * Runs every benchmark on the first call, then prints one BENCH key=value
+ * line per operation. The controller's other tasks stall while it runs.
+ */
+static portBASE_TYPE prvBenchCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    static struct BenchResult results[BENCH_NUM_OPS];
+    static int line = 0;
+    
+    if(line == 0)
+        BenchRun(results);
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "BENCH %s n=%d min_" BENCH_UNIT "=%lu avg_" BENCH_UNIT "=%lu max_" BENCH_UNIT "=%lu\r\n",
+             BenchName(line), BENCH_ITERATIONS, (unsigned long)results[line].min,
+             (unsigned long)results[line].avg, (unsigned long)results[line].max);
+    
+    if(++line < BENCH_NUM_OPS)
+        return pdTRUE;
+    
+    line = 0;
+    return pdFALSE;
+}
+
+/**
+ * Dispatch policy command
+ * 
+ * "DP" shows the policy and the ones there are, "DP <policy>" changes it
+ */
+static portBASE_TYPE prvDispatchPolicyCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    enum DISPATCH_POLICY policy;
+    const char *param, *name;
+    portBASE_TYPE len;
+    int used;
+    
+    param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+    
+    if(param != NULL)
+    {
+        for(policy = 0; policy < DISPATCH_NUM_POLICIES; policy++)
+        {
+            name = DispatchPolicyName(policy);
+            if(strlen(name) == (size_t)len && strncmp(param, name, len) == 0)
+            {
+                DispatchSetPolicy(policy);
+                snprintf(pcWriteBuffer, xWriteBufferLen, "Dispatch policy %s\r\n", name);
+                return pdFALSE;
+            }
+        }
+    }
+    
+    used = snprintf(pcWriteBuffer, xWriteBufferLen, "Dispatch policy %s, one of",
+                    DispatchPolicyName(DispatchGetPolicy()));
+    
+    for(policy = 0; policy < DISPATCH_NUM_POLICIES && used < (int)xWriteBufferLen; policy++)
+        used += snprintf(pcWriteBuffer + used, xWriteBufferLen - used, " %s",
+                         DispatchPolicyName(policy));
+    
+    if(used < (int)xWriteBufferLen)
+        snprintf(pcWriteBuffer + used, xWriteBufferLen - used, "\r\n");
+    
+    return pdFALSE;
+}
+
+/**
+ * Idle parking command
+ * 
+ * "PK" shows this part of the day's calls and where the car would park,
+ * "PK ON" and "PK OFF" turn parking on and off, "PK R" forgets the calls
+ */
+static portBASE_TYPE prvParkingCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    uint16_t counts[PARKING_FLOORS];
+    const char *param;
+    portBASE_TYPE len;
+    int bucket, floor;
+    
+    param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+    
+    if(param != NULL)
+    {
+        if(len == 2 && strncmp(param, "ON", 2) == 0)
+            ParkingSetEnable(true);
+        else if(len == 3 && strncmp(param, "OFF", 3) == 0)
+            ParkingSetEnable(false);
+        else if(*param == 'R' || *param == 'r')
+            ParkingReset();
+        else
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: PK [ON|OFF|R]\r\n");
+            return pdFALSE;
+        }
+    }
+    
+    bucket = ParkingBucketNow();
+    ParkingGetBucket(bucket, counts);
+    floor = ParkingFloor();
+    
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Parking %s, bucket %d of %d: GD=%u P1=%u P2=%u, parks at %s\r\n",
+             ParkingEnabled() ? "on" : "off", bucket, PARKING_BUCKETS,
+             counts[0], counts[1], counts[2],
+             (floor >= 0) ? GetRequest(floor).acronym : "-");
+    
+    return pdFALSE;
+}
+
+/**
+ * Eco mode command
+ * 
+ * "EM" shows the mode and the last trip's energy, "EM OFF" turns eco mode off
+ * and "EM n" turns it on, letting a trip take up to n percent longer than
+ * the fastest when nobody else is waiting
+ */
+static portBASE_TYPE prvEcoModeCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    struct EnergyStats stats;
+    const char *param;
+    portBASE_TYPE len;
+    int slack;
+    
+    param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &len);
+    
+    if(param != NULL)
+    {
+        EnergyGetStats(&stats);
+        
+        if(len == 3 && strncmp(param, "OFF", 3) == 0)
+            EnergySetEco(false, stats.slack);
+        else if((slack = GetIntParam(pcCommandString)) > 0)
+            EnergySetEco(true, slack);
+        else
+        {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: EM [OFF|slack percent]\r\n");
+            return pdFALSE;
+        }
+    }
+    
+    EnergyGetStats(&stats);
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Eco mode %s, %lu%% slack :: last trip %.1f kJ, %lu trips %.1f kJ\r\n",
+             stats.eco ? "on" : "off", (unsigned long)stats.slack,
+             stats.last_j / 1000.0f, (unsigned long)stats.trips, stats.total_j / 1000.0f);
+    
+    return pdFALSE;
+}
+
+/**
+ * Arrival time command, one floor per line. A * marks a floor the car is
+ * stopping at for a call.
+ */
+static portBASE_TYPE prvEtaCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    static int floor = 0;
+    struct Eta eta;
+    
+    if(EtaGet(floor, &eta))
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%s %lu.%lus%s\r\n",
+                 GetRequest(floor).acronym, (unsigned long)(eta.ms / 1000),
+                 (unsigned long)(eta.ms % 1000) / 100, eta.called ? " *" : "");
+    else
+        snprintf(pcWriteBuffer, xWriteBufferLen, "%s -\r\n", GetRequest(floor).acronym);
+    
+    if(++floor < ETA_FLOORS)
+        return pdTRUE;
+    
+    floor = 0;
+    return pdFALSE;
+}
+
+/**
+ * Change how often the car's location is sent while it moves
+ */
+static portBASE_TYPE prvTelemetryRateCommand(char *pcWriteBuffer, 
+                                 size_t xWriteBufferLen,
+                                 const char *pcCommandString)
+{
+    int hz = GetIntParam(pcCommandString);
+    
+    if(SetTelemetryRate(hz))
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Telemetry rate updated\r\n");
+    else
+        snprintf(pcWriteBuffer, xWriteBufferLen, "Rate must be 1 to 20 Hz\r\n");
+    
+    return pdFALSE;
+}
+
 // Commands available to the user
 static const xCommandLineInput xzCommand = {"z",
             "z:\r\n GD Floor Call outside car\r\n\r\n",
@@ -288,6 +1129,11 @@ static const xCommandLineInput xAPCommand = {"AP",
             prvChangeAccelCommand,
             1};
 
+static const xCommandLineInput xJKCommand = {"JK",
+            "JK n:\r\n Change jerk limit in ft/s^3 (0 disables)\r\n\r\n",
+            prvChangeJerkCommand,
+            1};
+
 static const xCommandLineInput xSFCommand = {"SF",
             "SF 0/1/2:\r\n Send to floor\r\n\r\n",
             prvSendToFloorCommand,
@@ -308,32 +1154,136 @@ static const xCommandLineInput xTSCommand = {"TS",
             prvTaskStatsCommand,
             0};
 
+static const xCommandLineInput xHSCommand = {"HS",
+            "HS:\r\n Heap statistics, free block histogram and allocations per caller\r\n\r\n",
+            prvHeapStatsCommand,
+            0};
+
 static const xCommandLineInput xRTSCommand = {"RTS",
-            "RTS:\r\n Run-time-stats\r\n\r\n",
-            prvTaskStatsCommand,
+            "RTS [R]:\r\n Run-time-stats (CPU use per task since the last RTS R)\r\n\r\n",
+            prvRunTimeStatsCommand,
+            -1};
+
+static const xCommandLineInput xSSCommand = {"SS",
+            "SS:\r\n Stack statistics (least free stack per task and a recommended size)\r\n\r\n",
+            prvStackStatsCommand,
+            0};
+
+static const xCommandLineInput xTRCommand = {"TR",
+            "TR [C]:\r\n Dump the kernel trace (TR C clears it and starts again)\r\n\r\n",
+            prvTraceCommand,
+            -1};
+
+static const xCommandLineInput xLPCommand = {"LP",
+            "LP:\r\n Low power stats (tick interrupts avoided by tickless idle)\r\n\r\n",
+            prvLowPowerCommand,
             0};
 
+static const xCommandLineInput xJDCommand = {"JD",
+            "JD:\r\n Dump the input journal (every button press and typed key, with its tick)\r\n\r\n",
+            prvJournalDumpCommand,
+            0};
+
+static const xCommandLineInput xJPCommand = {"JP",
+            "JP:\r\n Reset and replay the input journal, reproducing this run\r\n\r\n",
+            prvJournalReplayCommand,
+            0};
+
+static const xCommandLineInput xPSCommand = {"PS",
+            "PS [R]:\r\n Performance stats as key=value lines (PS R starts measuring again)\r\n\r\n",
+            prvPerfStatsCommand,
+            -1};
+
+static const xCommandLineInput xCSCommand = {"CS",
+            "CS:\r\n Car state (location, speed, destination and status flags)\r\n\r\n",
+            prvCarStateCommand,
+            0};
+
+static const xCommandLineInput xTGCommand = {"TG",
+            "TG [profile calls/hour [seed] | OFF]:\r\n Synthetic passenger traffic (UNIFORM, UP, DOWN, LUNCH or STORM)\r\n\r\n",
+            prvTrafficCommand,
+            -1};
+
+static const xCommandLineInput xKBCommand = {"KB",
+            "KB:\r\n Kernel benchmarks, CPU cycles per queue, semaphore, notify, yield, switch and delay call\r\n\r\n",
+            prvBenchCommand,
+            0};
+
+static const xCommandLineInput xDPCommand = {"DP",
+            "DP [policy]:\r\n Show or change the dispatch policy (COLLECTIVE, NEAREST, LOOK, ETA or ENERGY)\r\n\r\n",
+            prvDispatchPolicyCommand,
+            -1};
+
+static const xCommandLineInput xPKCommand = {"PK",
+            "PK [ON|OFF|R]:\r\n Idle parking at the floor with the most calls at this time of day (R forgets them)\r\n\r\n",
+            prvParkingCommand,
+            -1};
+
+static const xCommandLineInput xEMCommand = {"EM",
+            "EM [OFF|n]:\r\n Eco mode, trips nobody else is waiting on may take n% longer to save energy\r\n\r\n",
+            prvEcoModeCommand,
+            -1};
+
+static const xCommandLineInput xETCommand = {"ET",
+            "ET:\r\n When the car will get to each floor (* if it's stopping there for a call)\r\n\r\n",
+            prvEtaCommand,
+            0};
+
+static const xCommandLineInput xTMCommand = {"TM",
+            "TM n:\r\n Telemetry rate in Hz (1 to 20), how often the car's location is sent\r\n\r\n",
+            prvTelemetryRateCommand,
+            1};
+
+// Every command, in the order "help" lists them
+static const xCommandLineInput * const commands[] = {
+    &xzCommand,
+    &xxCommand,
+    &xcCommand,
+    &xvCommand,
+    &xbCommand,
+    &xnCommand,
+    &xmCommand,
+    &xSCommand,
+    &xAPCommand,
+    &xJKCommand,
+    &xSFCommand,
+    &xDPCommand,
+    &xPKCommand,
+    &xEMCommand,
+    &xETCommand,
+    &xTMCommand,
+    &xESCommand,
+    &xERCommand,
+    &xTSCommand,
+    &xRTSCommand,
+    &xHSCommand,
+    &xLPCommand,
+    &xTRCommand,
+    &xSSCommand,
+    &xCSCommand,
+    &xJDCommand,
+    &xJPCommand,
+    &xPSCommand,
+    &xTGCommand,
+    &xKBCommand
+};
+
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+// List nodes for the registered commands, so registering doesn't use the heap
+static CLI_Definition_List_Item_t commandListItems[NUM_COMMANDS];
+
 /**
  * Initialize the Command Line Interface (CLI) subsystem
  */
-void InitCLI(QueueHandle_t door_rx_queue)
+void InitCLI(struct Mailbox *door_mailbox)
 {
+    unsigned int i;
+    
     // Register CLI commands
-    FreeRTOS_CLIRegisterCommand(&xzCommand);
-    FreeRTOS_CLIRegisterCommand(&xxCommand);
-    FreeRTOS_CLIRegisterCommand(&xcCommand);
-    FreeRTOS_CLIRegisterCommand(&xvCommand);
-    FreeRTOS_CLIRegisterCommand(&xbCommand);
-    FreeRTOS_CLIRegisterCommand(&xnCommand);
-    FreeRTOS_CLIRegisterCommand(&xmCommand);
-    FreeRTOS_CLIRegisterCommand(&xSCommand);
-    FreeRTOS_CLIRegisterCommand(&xAPCommand);
-    FreeRTOS_CLIRegisterCommand(&xSFCommand);
-    FreeRTOS_CLIRegisterCommand(&xESCommand);
-    FreeRTOS_CLIRegisterCommand(&xERCommand);
-    FreeRTOS_CLIRegisterCommand(&xTSCommand);
-    FreeRTOS_CLIRegisterCommand(&xRTSCommand);
-    
-    // Set door queue
-    door_queue = door_rx_queue;
-}
\ No newline at end of file
+    for(i = 0; i < NUM_COMMANDS; i++)
+        FreeRTOS_CLIRegisterCommandStatic(commands[i], &commandListItems[i]);
+    
+    // Set door mailbox
+    door_mbox = door_mailbox;
+}
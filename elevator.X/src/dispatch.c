@@ -0,0 +1,377 @@
+/**
+ * Dispatch engine.
+ *
+ * Picks the stop the car goes to next. The policy can be changed at any time
+ * (the DP command), and takes effect the next time the car is stopped.
+ *
+ * The collective policy is the original hand-written order for GD, P1 and P2.
+ * The others work for any number of stops. The ETA and energy policies try
+ * each waiting call as the next stop, follow it with the closest call each
+ * time until every call is served, and cost the route with the motion
+ * profile's travel time estimate.
+ *
+ * A moving car can also be turned aside to a call made after it set off, as
+ * long as it can still stop there.
+ */
+#include <stdint.h>
+#include <math.h>
+#include <FreeRTOS.h>
+#include "dispatch.h"
+#include "energy.h"
+
+typedef int (*DispatchPolicyFn)(struct DispatchCar *car,
+                                struct FloorRequest *requests,
+                                int numStops);
+
+struct DispatchPolicy {
+    const char *name;
+    DispatchPolicyFn choose;    // Returns the stop, -1 for none, and takes
+                                // the call there as served
+};
+
+static int Collective(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+static int Nearest(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+static int Look(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+static int LeastTime(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+static int LeastEnergy(struct DispatchCar *car, struct FloorRequest *requests, int numStops);
+
+static const struct DispatchPolicy policies[DISPATCH_NUM_POLICIES] = {
+    [DISPATCH_COLLECTIVE] = { "COLLECTIVE", Collective },
+    [DISPATCH_NEAREST] = { "NEAREST", Nearest },
+    [DISPATCH_LOOK] = { "LOOK", Look },
+    [DISPATCH_ETA] = { "ETA", LeastTime },
+    [DISPATCH_ENERGY] = { "ENERGY", LeastEnergy }
+};
+
+static volatile enum DISPATCH_POLICY policy = DISPATCH_DEFAULT_POLICY;
+
+/**
+ * The original collective control: a fixed order of calls to look at for
+ * each stop the car can be at and the way it's going
+ */
+static int Collective(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    float loc = car->location;
+    int stop = -1;
+
+    // Update the direction
+    if(loc == requests[0].feet)
+        car->going_up = true;
+    else if(loc == requests[1].feet && requests[1].dir == UP)
+        car->going_up = true;
+    else if(loc == requests[1].feet && requests[1].dir == DOWN)
+        car->going_up = false;
+    else if(loc == requests[2].feet)
+        car->going_up = false;
+
+    // A call for both ways at P1 is served one way now, the other way later
+    if(car->going_up)
+    {
+        if(loc == requests[0].feet)
+        {
+            if(requests[0].isRequested) stop = 0;
+            else if(requests[1].isRequested && requests[1].dir == UP) stop = 1;
+            else if(requests[1].isRequested && requests[1].dir == EITHER) { requests[1].dir = DOWN; return 1; }
+            else if(requests[2].isRequested) stop = 2;
+            else if(requests[1].isRequested && requests[1].dir == DOWN) stop = 1;
+        }
+        else if(loc == requests[1].feet)
+        {
+            if(requests[1].isRequested && requests[1].dir == UP) stop = 1;
+            else if(requests[1].isRequested && requests[1].dir == EITHER) { requests[1].dir = DOWN; return 1; }
+            else if(requests[2].isRequested) stop = 2;
+            else if(requests[1].isRequested && requests[1].dir == DOWN) { stop = 1; car->going_up = false; }
+            else if(requests[0].isRequested) { stop = 0; car->going_up = false; }
+        }
+    }
+    else
+    {
+        if(loc == requests[1].feet)
+        {
+            if(requests[1].isRequested && requests[1].dir == DOWN) stop = 1;
+            else if(requests[1].isRequested && requests[1].dir == EITHER) { requests[1].dir = UP; return 1; }
+            else if(requests[0].isRequested) stop = 0;
+            else if(requests[1].isRequested && requests[1].dir == UP) { stop = 1; car->going_up = true; }
+            else if(requests[2].isRequested) { stop = 2; car->going_up = true; }
+        }
+        else if(loc == requests[2].feet)
+        {
+            if(requests[2].isRequested) stop = 2;
+            else if(requests[1].isRequested && requests[1].dir == DOWN) stop = 1;
+            else if(requests[1].isRequested && requests[1].dir == EITHER) { requests[1].dir = UP; return 1; }
+            else if(requests[0].isRequested) stop = 0;
+            else if(requests[1].isRequested && requests[1].dir == UP) stop = 1;
+        }
+    }
+
+    if(stop >= 0)
+        requests[stop].isRequested = false;
+
+    return stop;
+}
+
+/**
+ * @param waiting Bit mask of the calls to pick from
+ *
+ * @return The stop in the mask closest to the location, -1 if none
+ */
+static int Closest(const struct FloorRequest *requests, int numStops,
+                   uint32_t waiting, float location)
+{
+    float distance, best = 0.0f;
+    int i, stop = -1;
+
+    for(i = 0; i < numStops; i++)
+    {
+        if(!(waiting & (1UL << i)))
+            continue;
+
+        distance = fabsf(requests[i].feet - location);
+        if(stop < 0 || distance < best)
+        {
+            stop = i;
+            best = distance;
+        }
+    }
+
+    return stop;
+}
+
+/**
+ * @return Bit mask of the stops with a call waiting
+ */
+static uint32_t Waiting(const struct FloorRequest *requests, int numStops)
+{
+    uint32_t waiting = 0;
+    int i;
+
+    for(i = 0; i < numStops; i++)
+        if(requests[i].isRequested)
+            waiting |= 1UL << i;
+
+    return waiting;
+}
+
+/**
+ * Head for the chosen stop, or if the car is already there, the way the
+ * caller wants to go, and take the call as served
+ *
+ * @return The stop
+ */
+static int Serve(struct DispatchCar *car, struct FloorRequest *requests, int stop)
+{
+    if(stop < 0)
+        return -1;
+
+    if(requests[stop].feet > car->location)
+        car->going_up = true;
+    else if(requests[stop].feet < car->location)
+        car->going_up = false;
+    else if(requests[stop].dir == UP)
+        car->going_up = true;
+    else if(requests[stop].dir == DOWN)
+        car->going_up = false;
+
+    requests[stop].isRequested = false;
+    return stop;
+}
+
+/**
+ * Closest call first, whichever way it is
+ */
+static int Nearest(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    return Serve(car, requests,
+                 Closest(requests, numStops, Waiting(requests, numStops), car->location));
+}
+
+/**
+ * The closest call the way the car is going, or if there are none that way,
+ * the closest call behind it
+ */
+static int Look(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    uint32_t ahead = 0, behind = 0;
+    float offset;
+    int i;
+
+    for(i = 0; i < numStops; i++)
+    {
+        if(!requests[i].isRequested)
+            continue;
+
+        offset = requests[i].feet - car->location;
+        if(!car->going_up)
+            offset = -offset;
+
+        if(offset >= 0.0f)
+            ahead |= 1UL << i;
+        else
+            behind |= 1UL << i;
+    }
+
+    return Serve(car, requests,
+                 Closest(requests, numStops, ahead ? ahead : behind, car->location));
+}
+
+/**
+ * Cost a route that serves every waiting call, starting with the given one
+ * and then going to the closest call each time
+ *
+ * @param energy True to cost the energy used (see energy.c), false the sum of the times
+ *               until each call is served
+ */
+static float RouteCost(const struct DispatchCar *car, const struct FloorRequest *requests,
+                       int numStops, int first, bool energy)
+{
+    uint32_t waiting = Waiting(requests, numStops) & ~(1UL << first);
+    float at = car->location, clock = 0.0f, cost = 0.0f;
+    int stop = first;
+
+    while(stop >= 0)
+    {
+        if(energy)
+            cost += EnergyEstimate(&car->limits, at, requests[stop].feet);
+        else
+        {
+            clock += ProfileTravelTime(&car->limits, fabsf(requests[stop].feet - at));
+            cost += clock;
+            clock += DISPATCH_DOOR_MS / 1000.0f;
+        }
+
+        at = requests[stop].feet;
+        stop = Closest(requests, numStops, waiting, at);
+        if(stop >= 0)
+            waiting &= ~(1UL << stop);
+    }
+
+    return cost;
+}
+
+/**
+ * @return The call whose route is cheapest, -1 if none
+ */
+static int Cheapest(const struct DispatchCar *car, const struct FloorRequest *requests,
+                    int numStops, bool energy)
+{
+    float cost, best = 0.0f;
+    int i, stop = -1;
+
+    for(i = 0; i < numStops; i++)
+    {
+        if(!requests[i].isRequested)
+            continue;
+
+        cost = RouteCost(car, requests, numStops, i, energy);
+        if(stop < 0 || cost < best)
+        {
+            stop = i;
+            best = cost;
+        }
+    }
+
+    return stop;
+}
+
+/**
+ * The call that gets every call served soonest, on average
+ */
+static int LeastTime(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    return Serve(car, requests, Cheapest(car, requests, numStops, false));
+}
+
+/**
+ * The call that gets every call served for the least energy
+ */
+static int LeastEnergy(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    return Serve(car, requests, Cheapest(car, requests, numStops, true));
+}
+
+void DispatchSetPolicy(enum DISPATCH_POLICY newPolicy)
+{
+    if(newPolicy < DISPATCH_NUM_POLICIES)
+        policy = newPolicy;
+}
+
+enum DISPATCH_POLICY DispatchGetPolicy(void)
+{
+    return policy;
+}
+
+/**
+ * @return The policy's name, as the DP command takes it
+ */
+const char *DispatchPolicyName(enum DISPATCH_POLICY which)
+{
+    if(which >= DISPATCH_NUM_POLICIES)
+        return "?";
+
+    return policies[which].name;
+}
+
+/**
+ * Pick the stop the car goes to next with the current policy, taking the call
+ * there as served
+ *
+ * @param car The car. Its direction is updated.
+ * @param requests The calls for each stop
+ * @param numStops The number of stops
+ *
+ * @return The stop to go to, -1 if there's nowhere to go
+ */
+int DispatchNext(struct DispatchCar *car, struct FloorRequest *requests, int numStops)
+{
+    return policies[policy].choose(car, requests, numStops);
+}
+
+/**
+ * Find a call the moving car can still stop for on its way. Calls that want
+ * to go the other way are left for the way back, except with the nearest
+ * policy, which serves calls whichever way they go.
+ *
+ * @param car The car
+ * @param requests The calls for each stop
+ * @param numStops The number of stops
+ * @param dest Where the car is heading in feet
+ * @param braking The shortest distance the car can stop in
+ *
+ * @return The closest such stop, taking the call there as served, -1 if none
+ */
+int DispatchIntercept(const struct DispatchCar *car, struct FloorRequest *requests,
+                      int numStops, float dest, float braking)
+{
+    enum DIR way = car->going_up ? UP : DOWN;
+    float offset, best = 0.0f;
+    float beyond = car->going_up ? dest - car->location : car->location - dest;
+    int i, stop = -1;
+
+    for(i = 0; i < numStops; i++)
+    {
+        if(!requests[i].isRequested)
+            continue;
+
+        if(policy != DISPATCH_NEAREST && requests[i].dir != way && requests[i].dir != EITHER)
+            continue;
+
+        offset = requests[i].feet - car->location;
+        if(!car->going_up)
+            offset = -offset;
+
+        // Behind the car, too close to stop for, or not on the way
+        if(offset <= 0.0f || offset < braking || offset >= beyond)
+            continue;
+
+        if(stop < 0 || offset < best)
+        {
+            stop = i;
+            best = offset;
+        }
+    }
+
+    if(stop >= 0)
+        requests[stop].isRequested = false;
+
+    return stop;
+}
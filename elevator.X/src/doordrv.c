@@ -1,9 +1,10 @@
 /**
  * Handles opening and closing the door on request.
  * 
- * Uses a queue to send and receive messages. This is how the other modules
- * tell the door to open and close (or stay opened in the case of an emergency
- * stop).
+ * Other modules tell the door to open and close (or stay opened in the case of
+ * an emergency stop) through a priority mailbox, and the door says when it has
+ * closed on a queue. Whether the door is open is published with the rest of
+ * the car's state.
  */
 #include <stdint.h>
 #include <stdbool.h>
@@ -12,19 +13,78 @@
 #include <queue.h>
 #include "doordrv.h"
 #include "leddrv.h"
+#include "mailbox.h"
+#include "carstate.h"
 
 // Delays between states
 static const TickType_t ledDelay = 1000 / portTICK_PERIOD_MS;
 static const TickType_t pauseDelay = 5000 / portTICK_PERIOD_MS;
 
+// Door mailbox priorities: an emergency stay open beats a close, which beats
+// an ordinary open. A stay open cancels the pending messages below it, as it
+// opens the door anyway. A close never cancels an open: the idle door ignores
+// closes, and the physics task waits for the CLOSED only an opening sends.
+static const uint8_t mailboxOrder[] = { STAY_OPEN, CLOSE, OPEN_CLOSE_SEQ };
+static const uint32_t mailboxCancels[] = {
+    [OPEN_CLOSE_SEQ] = 0,
+    [STAY_OPEN] = MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+    [CLOSE] = 0,
+    [CLOSED] = 0
+};
+
 // Global variables
 static bool opening;
+static bool stay_opened;
 static uint8_t cur_state;
 static uint8_t next_state;
 
-bool GetDoorClosed()
+/**
+ * Set up the mailbox the door receives messages in
+ * 
+ * @param mailbox The mailbox
+ */
+void InitDoorMailbox(struct Mailbox *mailbox)
+{
+    MailboxInit(mailbox, mailboxOrder, sizeof(mailboxOrder), mailboxCancels);
+}
+
+/**
+ * Act on a message that arrives while the door is moving
+ * 
+ * @param msg The message
+ */
+static void HandleMessage(enum DOOR_MSG msg)
+{
+    if(msg == CLOSE)
+    {
+        // Only close the doors after they've been opened for emergency stop
+        if(!stay_opened || cur_state == 3)
+            opening = false;
+    }
+    else if(msg == OPEN_CLOSE_SEQ)
+        opening = true;
+}
+
+/**
+ * Hold the current door state for a while, acting on messages as soon as they
+ * arrive instead of only between states
+ * 
+ * @param door_mailbox The mailbox the door receives messages in
+ * @param delay How long to hold the state
+ */
+static void WaitState(struct Mailbox *door_mailbox, TickType_t delay)
 {
-    return (cur_state == 0 && !opening);
+    TimeOut_t timeOut;
+    uint8_t msg;
+    
+    vTaskSetTimeOutState(&timeOut);
+    
+    // Updates delay to the time left, returns pdTRUE once it has all gone
+    while(xTaskCheckForTimeOut(&timeOut, &delay) == pdFALSE)
+    {
+        if(MailboxReceive(door_mailbox, &msg, delay))
+            HandleMessage((enum DOOR_MSG)msg);
+    }
 }
 
 /**
@@ -34,13 +94,14 @@ bool GetDoorClosed()
  */
 void taskDoor(void *pvParameters)
 {
-    enum DOOR_MSG msg;
-    bool stay_opened = false;
+    uint8_t msg;
+    enum DOOR_MSG closed;
     bool animation_done = false;
     xDoorTaskParameter_t *taskParam;
     taskParam = (xDoorTaskParameter_t *)pvParameters;
     
     opening = false;
+    stay_opened = false;
     cur_state = 0;
     next_state = 0;
     
@@ -54,7 +115,7 @@ void taskDoor(void *pvParameters)
         // Block until a door open message appears
         do
         {
-            xQueueReceive(taskParam->door_rx_queue, &msg, portMAX_DELAY);
+            MailboxReceive(taskParam->door_mailbox, &msg, portMAX_DELAY);
 
             switch(msg)
             {
@@ -62,28 +123,12 @@ void taskDoor(void *pvParameters)
                 case STAY_OPEN: opening = true; stay_opened = true; break;
             }
         } while(!opening);
+        
+        CarStateSetFlags(STATE_DOOR_OPEN);
            
         // Perform door animation
         while(!animation_done)
         {
-            // Check for any messages
-            if(xQueueReceive(taskParam->door_rx_queue, &msg, 0) == pdTRUE)
-            {
-                if(msg == CLOSE)
-                {
-                    // Only close the doors after they've been opened for emergency stop
-                    if(!stay_opened || (stay_opened && cur_state == 3))
-                        opening = false;
-                }
-                else if(msg == OPEN_CLOSE_SEQ)
-                {
-                    if(!opening && cur_state >= 1 && cur_state <= 3 && !stay_opened)
-                        next_state += 2;
-                    
-                    opening = true;
-                }
-            }
-            
             cur_state = next_state;
             
             // State machine for how "open" the door is
@@ -94,7 +139,7 @@ void taskDoor(void *pvParameters)
                     setLED(LED2, 1);
                     setLED(LED3, 1);
 
-                    vTaskDelay(ledDelay);
+                    WaitState(taskParam->door_mailbox, ledDelay);
                     
                     if(opening)
                         next_state = 1;
@@ -108,7 +153,7 @@ void taskDoor(void *pvParameters)
                     setLED(LED2, 1);
                     setLED(LED3, 0);
 
-                    vTaskDelay(ledDelay);
+                    WaitState(taskParam->door_mailbox, ledDelay);
                     
                     if(opening)
                         next_state = 2;
@@ -122,7 +167,7 @@ void taskDoor(void *pvParameters)
                     setLED(LED2, 0);
                     setLED(LED3, 0);
 
-                    vTaskDelay(ledDelay);
+                    WaitState(taskParam->door_mailbox, ledDelay);
                     
                     if(opening)
                         next_state = 3;
@@ -139,7 +184,7 @@ void taskDoor(void *pvParameters)
                     if(opening)
                     {
                         if(stay_opened)
-                            vTaskDelay(ledDelay);
+                            WaitState(taskParam->door_mailbox, ledDelay);
                         else
                             next_state = 4;
                     }
@@ -149,9 +194,10 @@ void taskDoor(void *pvParameters)
                     break;
                     
                 case 4:
-                    vTaskDelay(pauseDelay);
-                    next_state = 3;
+                    // Opening again during the pause holds the door open
                     opening = false;
+                    WaitState(taskParam->door_mailbox, pauseDelay);
+                    next_state = 3;
                     
                     break;
 
@@ -160,8 +206,13 @@ void taskDoor(void *pvParameters)
         }
         
         // Send the door closed message
-        msg = CLOSED;
-        xQueueOverwrite(taskParam->door_tx_queue, (void*)&msg);
+        CarStateSetFlags(STATE_DOOR_CLOSED);
+        closed = CLOSED;
+        
+        // The queue is in the physics task's queue set, which has room for
+        // one entry per queue slot. Overwriting a full queue would post a
+        // second set entry, while an unread CLOSED already says the same.
+        xQueueSend(taskParam->door_tx_queue, (void*)&closed, 0);
                 
         opening = false;
         stay_opened = false;
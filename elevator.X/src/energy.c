@@ -0,0 +1,221 @@
+/**
+ * Energy model.
+ *
+ * The drive pays for the kinetic energy of everything that moves, for lifting
+ * the car side's extra weight and for friction. Braking and lowering give a
+ * share back through regeneration. Trips are metered step by step from the
+ * motion the physics task actually produces.
+ *
+ * In eco mode a trip with no other calls waiting cruises at the lowest speed
+ * that still gets there within the slack of the fastest trip, which saves the
+ * kinetic energy braking would throw away.
+ */
+#include <math.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "energy.h"
+
+#define GRAVITY 9.81f
+#define METRES_PER_FOOT 0.3048f
+
+// Slowest cruise eco mode will pick, ft/s
+#define ECO_MIN_SPEED 1.0f
+
+// Halvings of the speed range when looking for the eco speed
+#define ECO_ITERATIONS 12
+
+// Only used by the physics task
+static float trip_j;
+static float trip_feet;
+
+// Read by the CLI
+static struct EnergyStats stats = { 0, 0.0f, 0.0f, false, ENERGY_DEFAULT_SLACK };
+
+/**
+ * @return Kinetic energy of the moving mass at a speed in ft/s
+ */
+static float Kinetic(float speed)
+{
+    float metres = speed * METRES_PER_FOOT;
+
+    return 0.5f * ENERGY_MOVING_KG * metres * metres;
+}
+
+/**
+ * Energy to move a distance at a steady speed, ignoring speeding up and
+ * slowing down
+ */
+static float Travel(float feet, bool up)
+{
+    float metres = feet * METRES_PER_FOOT;
+    float lift = ENERGY_UNBALANCED_KG * GRAVITY * metres;
+
+    return ENERGY_FRICTION_N * metres + (up ? lift : -ENERGY_REGEN * lift);
+}
+
+/**
+ * Start metering a trip
+ */
+void EnergyTripStart(void)
+{
+    trip_j = 0.0f;
+    trip_feet = 0.0f;
+}
+
+/**
+ * Add a step of the motion profile to the trip
+ *
+ * @param speedBefore Speed at the start of the step
+ * @param speedAfter Speed at the end of it
+ * @param moved Distance covered in feet
+ * @param up True if the car is going up
+ */
+void EnergyStep(float speedBefore, float speedAfter, float moved, bool up)
+{
+    float change = Kinetic(speedAfter) - Kinetic(speedBefore);
+
+    trip_j += (change > 0.0f) ? change : ENERGY_REGEN * change;
+    trip_j += Travel(moved, up);
+    trip_feet += moved;
+}
+
+void EnergyTripSave(struct EnergyMeter *meter)
+{
+    meter->joules = trip_j;
+    meter->feet = trip_feet;
+}
+
+/**
+ * Go back to where the trip's metering was saved, forgetting the steps since
+ */
+void EnergyTripRestore(const struct EnergyMeter *meter)
+{
+    trip_j = meter->joules;
+    trip_feet = meter->feet;
+}
+
+/**
+ * Finish metering a trip. Trips that went nowhere aren't counted.
+ *
+ * @return The energy the trip took in joules
+ */
+float EnergyTripEnd(void)
+{
+    if(trip_feet <= 0.0f)
+        return 0.0f;
+
+    taskENTER_CRITICAL();
+    {
+        stats.trips++;
+        stats.total_j += trip_j;
+        stats.last_j = trip_j;
+    }
+    taskEXIT_CRITICAL();
+
+    return trip_j;
+}
+
+/**
+ * Estimate the energy of a rest-to-rest trip
+ *
+ * @param limits The limits the trip is made with
+ * @param from Where it starts in feet
+ * @param to Where it ends
+ *
+ * @return The energy in joules
+ */
+float EnergyEstimate(const struct MotionLimits *limits, float from, float to)
+{
+    float distance = fabsf(to - from);
+    float peak;
+
+    if(distance <= 0.0f)
+        return 0.0f;
+
+    // Top speed of a trapezoid profile, near enough with jerk limiting too
+    peak = sqrtf(limits->accel * distance);
+    if(peak > limits->max_speed)
+        peak = limits->max_speed;
+
+    return (1.0f - ENERGY_REGEN) * Kinetic(peak) + Travel(distance, to > from);
+}
+
+/**
+ * Find the lowest cruise speed that keeps a trip within the eco slack of the
+ * fastest trip
+ *
+ * @param limits The limits of the fastest trip
+ * @param distance How far the trip is in feet
+ *
+ * @return The cruise speed, no more than limits->max_speed
+ */
+float EnergyEcoSpeed(const struct MotionLimits *limits, float distance)
+{
+    struct MotionLimits eco = *limits;
+    float bound, low = ECO_MIN_SPEED, high = limits->max_speed;
+    int i;
+
+    if(high <= low)
+        return high;
+
+    bound = ProfileTravelTime(limits, distance) * (100 + stats.slack) / 100.0f;
+
+    eco.max_speed = low;
+    if(ProfileTravelTime(&eco, distance) <= bound)
+        return low;
+
+    // The trip only gets longer as the speed comes down
+    for(i = 0; i < ECO_ITERATIONS; i++)
+    {
+        eco.max_speed = 0.5f * (low + high);
+
+        if(ProfileTravelTime(&eco, distance) <= bound)
+            high = eco.max_speed;
+        else
+            low = eco.max_speed;
+    }
+
+    return high;
+}
+
+/**
+ * @param eco True to slow down trips when nothing else is waiting
+ * @param slack How much longer than the fastest a trip may take, in percent
+ */
+void EnergySetEco(bool eco, uint32_t slack)
+{
+    taskENTER_CRITICAL();
+    {
+        stats.eco = eco;
+        stats.slack = slack;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool EnergyEcoEnabled(void)
+{
+    return stats.eco;
+}
+
+/**
+ * Forget the trips metered so far
+ */
+void EnergyResetStats(void)
+{
+    taskENTER_CRITICAL();
+    {
+        stats.trips = 0;
+        stats.total_j = 0.0f;
+        stats.last_j = 0.0f;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void EnergyGetStats(struct EnergyStats *out)
+{
+    taskENTER_CRITICAL();
+    {
+        *out = stats;
+    }
+    taskEXIT_CRITICAL();
+}
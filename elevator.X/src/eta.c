@@ -0,0 +1,163 @@
+/**
+ * Arrival time service.
+ *
+ * Answers "when will the car get to floor X" for any task. The physics task
+ * works the answers out whenever something changes: a call, a new trip or the
+ * car arriving. It walks the trip under way and then the calls in the order
+ * the dispatch policy will serve them, adding up the motion profile's travel
+ * times and the door's dwell. The answers are kept as the tick the car gets
+ * there, so they stay right as time passes and asking costs a copy however
+ * often it's done.
+ */
+#include <string.h>
+#include <math.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "dispatch.h"
+#include "eta.h"
+
+static TickType_t arrival[ETA_FLOORS];
+static bool called[ETA_FLOORS];
+static bool valid;
+
+/**
+ * Time left on the trip under way. Assumes the car cruises at its current
+ * speed and brakes at full deceleration.
+ *
+ * @param input What the physics task knows
+ * @param remaining Distance left in feet
+ *
+ * @return The time in seconds
+ */
+static float TripLeft(const struct EtaInput *input, float remaining)
+{
+    struct MotionLimits limits = input->limits;
+    float speed = input->speed, braking;
+
+    limits.max_speed = input->cruise_speed;
+
+    if(speed <= 0.0f || limits.accel <= 0.0f)
+        return ProfileTravelTime(&limits, remaining);
+
+    braking = (speed * speed) / (2.0f * limits.accel);
+    if(remaining <= braking)
+        return 2.0f * remaining / speed;
+
+    return (remaining - braking) / speed + speed / limits.accel;
+}
+
+/**
+ * Work out the arrival time at every floor again
+ *
+ * @param input What the physics task knows
+ * @param requests The calls waiting at each floor
+ */
+void EtaUpdate(const struct EtaInput *input, const struct FloorRequest *requests)
+{
+    struct FloorRequest pending[ETA_FLOORS];
+    struct DispatchCar car;
+    float seconds[ETA_FLOORS];
+    bool seen[ETA_FLOORS] = { false };
+    bool stopping[ETA_FLOORS] = { false };
+    float clock = input->door_left_ms / 1000.0f;
+    float at = input->location;
+    TickType_t now;
+    int stop, i;
+
+    // The trip under way
+    if(input->dest >= 0 && input->dest < ETA_FLOORS)
+    {
+        stop = input->dest;
+        clock += TripLeft(input, fabsf(requests[stop].feet - at));
+        at = requests[stop].feet;
+        seconds[stop] = clock;
+        seen[stop] = true;
+        stopping[stop] = input->door_at_dest;
+
+        if(input->door_at_dest)
+            clock += DISPATCH_DOOR_MS / 1000.0f;
+    }
+
+    // Then the calls, in the order the policy picks them. A call for both
+    // ways can be picked twice, so that's the most there can be.
+    memcpy(pending, requests, sizeof(pending));
+    car.location = at;
+    car.going_up = input->going_up;
+    car.limits = input->limits;
+
+    for(i = 0; i < 2 * ETA_FLOORS; i++)
+    {
+        stop = DispatchNext(&car, pending, ETA_FLOORS);
+        if(stop < 0)
+            break;
+
+        clock += ProfileTravelTime(&car.limits, fabsf(pending[stop].feet - at));
+        at = pending[stop].feet;
+        car.location = at;
+
+        if(!seen[stop])
+        {
+            seconds[stop] = clock;
+            seen[stop] = true;
+            stopping[stop] = true;
+        }
+
+        clock += DISPATCH_DOOR_MS / 1000.0f;
+    }
+
+    // A floor nobody has called for is reached after all that
+    for(i = 0; i < ETA_FLOORS; i++)
+        if(!seen[i])
+            seconds[i] = clock + ProfileTravelTime(&car.limits, fabsf(requests[i].feet - at));
+
+    now = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+    {
+        for(i = 0; i < ETA_FLOORS; i++)
+        {
+            arrival[i] = now + (TickType_t)(seconds[i] * 1000.0f) / portTICK_PERIOD_MS;
+            called[i] = stopping[i];
+        }
+        valid = true;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * There's no telling when the car will get anywhere, as in an emergency
+ */
+void EtaInvalidate(void)
+{
+    valid = false;
+}
+
+/**
+ * When will the car get to a floor. Just copies what the physics task last
+ * worked out, so any task can call it as often as it likes.
+ *
+ * @param floor The floor
+ * @param eta Filled in with the arrival time
+ *
+ * @return False if there's no answer, in an emergency or for a bad floor
+ */
+bool EtaGet(int floor, struct Eta *eta)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t when;
+
+    if(floor < 0 || floor >= ETA_FLOORS)
+        return false;
+
+    taskENTER_CRITICAL();
+    {
+        when = arrival[floor];
+        eta->called = called[floor];
+        eta->valid = valid;
+    }
+    taskEXIT_CRITICAL();
+
+    eta->ms = ((int32_t)(when - now) > 0) ? (when - now) * portTICK_PERIOD_MS : 0;
+
+    return eta->valid;
+}
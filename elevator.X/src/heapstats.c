@@ -0,0 +1,135 @@
+/**
+ * Keeps statistics on the FreeRTOS heap.
+ *
+ * The heap calls into this module through the traceMALLOC() and traceFREE()
+ * hooks (see FreeRTOSConfig.h). Every pvPortMalloc() caller gets its own
+ * counters so it's easy to see who is using the heap, and the heap itself is
+ * asked for its free block histogram when the statistics are read.
+ */
+#include <stdbool.h>
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "heapstats.h"
+
+// Per-caller counters, the last entry collects everyone that didn't fit
+static struct HeapSite sites[HEAP_STATS_SITES];
+static int num_sites;
+
+// Whole heap counters
+static uint32_t allocs;
+static uint32_t frees;
+static uint32_t failures;
+static size_t last_failed_size;
+
+/**
+ * Find (or claim) the counters for a pvPortMalloc() caller
+ *
+ * @param caller The return address into the calling function
+ *
+ * @return The counters to update
+ */
+static struct HeapSite *FindSite(void *caller)
+{
+    int i;
+
+    for(i = 0; i < num_sites; i++)
+    {
+        if(sites[i].caller == caller)
+            return &sites[i];
+    }
+
+    // Out of slots, so lump it in with the last one
+    if(num_sites == HEAP_STATS_SITES)
+    {
+        sites[HEAP_STATS_SITES - 1].caller = NULL;
+        return &sites[HEAP_STATS_SITES - 1];
+    }
+
+    sites[num_sites].caller = caller;
+    return &sites[num_sites++];
+}
+
+/**
+ * Record a call to pvPortMalloc(). Runs with the scheduler suspended.
+ *
+ * @param address The block handed out, or NULL if the allocation failed
+ * @param size The size of the block (including its header)
+ * @param caller The return address into the function that called pvPortMalloc()
+ */
+void HeapStatsRecordMalloc(void *address, size_t size, void *caller)
+{
+    struct HeapSite *site = FindSite(caller);
+
+    if(address != NULL)
+    {
+        allocs++;
+        site->allocs++;
+        site->bytes += size;
+    }
+    else
+    {
+        failures++;
+        last_failed_size = size;
+        site->failures++;
+    }
+}
+
+/**
+ * Record a call to vPortFree(). Runs with the scheduler suspended.
+ *
+ * @param address The block being freed
+ * @param size The size of the block (including its header)
+ */
+void HeapStatsRecordFree(void *address, size_t size)
+{
+    (void)address;
+    (void)size;
+
+    frees++;
+}
+
+/**
+ * Take a snapshot of the heap statistics
+ *
+ * @param stats Filled in with the statistics
+ */
+void HeapStatsGet(struct HeapStats *stats)
+{
+    vTaskSuspendAll();
+    {
+        stats->free_bytes = xPortGetFreeHeapSize();
+        stats->min_ever_free_bytes = xPortGetMinimumEverFreeHeapSize();
+        stats->allocs = allocs;
+        stats->frees = frees;
+        stats->failures = failures;
+        stats->last_failed_size = last_failed_size;
+        stats->largest_free_block = xPortGetFreeBlockHistogram(stats->histogram, HEAP_STATS_BINS);
+    }
+    xTaskResumeAll();
+}
+
+/**
+ * Read the counters for one pvPortMalloc() caller
+ *
+ * @param siteNum Which caller to read, starting at zero
+ * @param site Filled in with the counters
+ *
+ * @return True if siteNum was valid, false once past the last caller
+ */
+bool HeapStatsGetSite(int siteNum, struct HeapSite *site)
+{
+    bool valid = false;
+
+    vTaskSuspendAll();
+    {
+        if(siteNum >= 0 && siteNum < num_sites)
+        {
+            *site = sites[siteNum];
+            valid = true;
+        }
+    }
+    xTaskResumeAll();
+
+    return valid;
+}
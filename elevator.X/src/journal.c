@@ -0,0 +1,280 @@
+/**
+ * Input journal.
+ *
+ * Records every external input (UART bytes, single key commands and button
+ * presses) with the tick it was acted on, so a run can be fed back into the
+ * firmware later. The journal is kept in RAM that a reset doesn't clear. The
+ * JP command resets the board, and the next boot replays the journal instead
+ * of reading the pins and the UART: the car starts from the same state and
+ * gets the same inputs on the same ticks, so it reproduces the run.
+ *
+ * Entries are stored as the ticks since the one before, so one only takes 4
+ * bytes. Long quiet spells take an extra gap entry.
+ */
+#define _SUPPRESS_PLIB_WARNING 1
+#define _DISABLE_OPENADC10_CONFIGPORT_WARNING 1
+
+#include <plib.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "journal.h"
+
+// Marks the persistent RAM as holding a journal, it's random after power up
+#define JOURNAL_MAGIC 0x4a524e4cUL
+
+// One stored input. A gap entry's data holds the ticks above the low 16 bits.
+struct JournalSlot {
+    uint16_t ticks;     // Since the entry before
+    uint8_t source;
+    uint8_t data;
+};
+
+// Survives a reset, so it's only set up by InitJournal()
+static struct {
+    uint32_t magic;
+    uint32_t total;             // Entries ever recorded
+    uint32_t line_start;        // Entry the CLI line being typed started at
+    uint32_t replay_end;        // Entries a replay feeds back
+    TickType_t first_tick;      // Time of the entry before the oldest one kept
+    TickType_t last_tick;       // Time of the newest entry
+    bool replay_requested;
+    struct JournalSlot entries[JOURNAL_ENTRIES];
+} journal __attribute__((persistent));
+
+static bool replaying;
+
+/**
+ * @param slot A stored entry
+ *
+ * @return The ticks between the entry before and this one
+ */
+static TickType_t SlotTicks(const struct JournalSlot *slot)
+{
+    if(slot->source == JOURNAL_GAP)
+        return slot->ticks + ((TickType_t)slot->data << 16);
+
+    return slot->ticks;
+}
+
+/**
+ * Add an entry, writing over the oldest one if the journal is full. Called in
+ * a critical section.
+ */
+static void Append(uint16_t ticks, uint8_t source, uint8_t data)
+{
+    struct JournalSlot *slot = &journal.entries[journal.total % JOURNAL_ENTRIES];
+
+    if(journal.total >= JOURNAL_ENTRIES)
+        journal.first_tick += SlotTicks(slot);
+
+    slot->ticks = ticks;
+    slot->source = source;
+    slot->data = data;
+
+    journal.last_tick += SlotTicks(slot);
+    journal.total++;
+}
+
+/**
+ * Set the journal up at boot, before the scheduler starts. Starts a new
+ * journal unless the reset was JournalReplay() asking for a replay.
+ */
+void InitJournal(void)
+{
+    if(journal.magic == JOURNAL_MAGIC && journal.replay_requested &&
+       journal.total <= JOURNAL_ENTRIES && journal.replay_end <= journal.total)
+    {
+        // A reset in the middle of the replay goes back to recording
+        journal.replay_requested = false;
+        replaying = true;
+        return;
+    }
+
+    journal.magic = JOURNAL_MAGIC;
+    journal.total = 0;
+    journal.line_start = 0;
+    journal.replay_end = 0;
+    journal.first_tick = 0;
+    journal.last_tick = 0;
+    journal.replay_requested = false;
+    replaying = false;
+}
+
+/**
+ * @return True if this boot is replaying the journal
+ */
+bool JournalReplaying(void)
+{
+    return replaying;
+}
+
+/**
+ * Record an input at the current tick
+ *
+ * @param source Where the input came from (JOURNAL_UART, _KEY or _BUTTON)
+ * @param data The input
+ */
+void JournalRecord(uint8_t source, uint8_t data)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t delta, high;
+
+    if(replaying)
+        return;
+
+    taskENTER_CRITICAL();
+    {
+        delta = now - journal.last_tick;
+
+        while(delta > UINT16_MAX)
+        {
+            high = delta >> 16;
+            if(high > UINT8_MAX)
+                high = UINT8_MAX;
+
+            Append(0, JOURNAL_GAP, (uint8_t)high);
+            delta -= high << 16;
+        }
+
+        Append((uint16_t)delta, source, data);
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note that the next UART entry starts a new CLI command line, so a replay
+ * can stop before the line that asked for it
+ */
+void JournalLineStart(void)
+{
+    taskENTER_CRITICAL();
+    {
+        journal.line_start = journal.total;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @return The number of inputs ever recorded, counting gap entries
+ */
+uint32_t JournalCount(void)
+{
+    return journal.total;
+}
+
+/**
+ * @return The number of entries written over because the journal was full
+ */
+uint32_t JournalLost(void)
+{
+    uint32_t total = journal.total;
+
+    return (total > JOURNAL_ENTRIES) ? total - JOURNAL_ENTRIES : 0;
+}
+
+/**
+ * Point a cursor at the oldest entry. While replaying, readers only see the
+ * entries being replayed.
+ *
+ * @param cursor The cursor
+ * @param sources The JOURNAL_ sources to read
+ */
+void JournalStart(struct JournalCursor *cursor, uint8_t sources)
+{
+    taskENTER_CRITICAL();
+    {
+        cursor->index = JournalLost();
+        cursor->tick = journal.first_tick;
+    }
+    taskEXIT_CRITICAL();
+
+    cursor->sources = sources;
+}
+
+/**
+ * Look at the next entry from the cursor's sources without moving past it
+ *
+ * @param cursor The cursor
+ * @param entry Filled in with the entry
+ *
+ * @return False if there are no more entries, or the ones the cursor was on
+ *         have been written over
+ */
+bool JournalPeek(struct JournalCursor *cursor, struct JournalEntry *entry)
+{
+    struct JournalSlot *slot;
+    uint32_t end;
+    bool found = false;
+
+    taskENTER_CRITICAL();
+    {
+        end = replaying ? journal.replay_end : journal.total;
+
+        if(cursor->index + JOURNAL_ENTRIES < journal.total)
+            cursor->index = end;
+
+        while(cursor->index < end)
+        {
+            slot = &journal.entries[cursor->index % JOURNAL_ENTRIES];
+
+            if(slot->source & cursor->sources)
+            {
+                entry->tick = cursor->tick + SlotTicks(slot);
+                entry->source = slot->source;
+                entry->data = slot->data;
+                found = true;
+                break;
+            }
+
+            // Skip the other sources, keeping their time
+            cursor->tick += SlotTicks(slot);
+            cursor->index++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return found;
+}
+
+/**
+ * Move past the entry JournalPeek() found
+ *
+ * @param cursor The cursor
+ */
+void JournalNext(struct JournalCursor *cursor)
+{
+    taskENTER_CRITICAL();
+    {
+        cursor->tick += SlotTicks(&journal.entries[cursor->index % JOURNAL_ENTRIES]);
+        cursor->index++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @return False if the start of the journal has been written over, so a
+ *         replay wouldn't start from the state the car booted in
+ */
+bool JournalCanReplay(void)
+{
+    return replaying || JournalLost() == 0;
+}
+
+/**
+ * Reset the board so the next boot replays the journal. Replays everything
+ * before the CLI line being typed, which is the one asking for the replay.
+ * Replaying again replays the same inputs. Doesn't return.
+ */
+void JournalReplay(void)
+{
+    taskENTER_CRITICAL();
+    {
+        if(!replaying)
+            journal.replay_end = journal.line_start;
+
+        journal.replay_requested = true;
+    }
+    taskEXIT_CRITICAL();
+
+    SoftReset();
+}
@@ -0,0 +1,115 @@
+/**
+ * Priority mailbox.
+ *
+ * Replaces a length-1 queue written with xQueueOverwrite(), which silently
+ * drops whatever message was waiting. Pending messages are kept as a bit mask
+ * and a binary semaphore wakes the receiver, so senders never block and the
+ * receiver always gets the most important message first.
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include "mailbox.h"
+
+/**
+ * Set up a mailbox
+ *
+ * @param mailbox The mailbox
+ * @param order Every message the mailbox carries, highest priority first
+ * @param numMsgs The number of entries in order
+ * @param cancels Indexed by message, the MAILBOX_BIT()s of the pending
+ *                messages that posting it cancels. They must all come after it
+ *                in order.
+ */
+void MailboxInit(struct Mailbox *mailbox, const uint8_t *order, int numMsgs,
+                 const uint32_t *cancels)
+{
+    uint32_t lower = 0;
+    int i;
+
+    configASSERT(numMsgs <= MAILBOX_MAX_MSGS);
+
+    // Work up from the lowest priority, checking nothing cancels its betters
+    for(i = numMsgs - 1; i >= 0; i--)
+    {
+        configASSERT(order[i] < MAILBOX_MAX_MSGS);
+        configASSERT((cancels[order[i]] & ~lower) == 0);
+        lower |= MAILBOX_BIT(order[i]);
+    }
+
+    mailbox->pending = 0;
+    mailbox->order = order;
+    mailbox->num_msgs = numMsgs;
+    mailbox->cancels = cancels;
+    mailbox->signal = xSemaphoreCreateBinaryStatic(&mailbox->signal_buffer);
+}
+
+/**
+ * Post a message. Never blocks.
+ *
+ * @param mailbox The mailbox
+ * @param msg The message
+ */
+void MailboxPost(struct Mailbox *mailbox, uint8_t msg)
+{
+    taskENTER_CRITICAL();
+    {
+        mailbox->pending &= ~mailbox->cancels[msg];
+        mailbox->pending |= MAILBOX_BIT(msg);
+    }
+    taskEXIT_CRITICAL();
+
+    // Already given if something else was pending, which is fine
+    xSemaphoreGive(mailbox->signal);
+}
+
+/**
+ * Wait for a message and take the one with the highest priority
+ *
+ * @param mailbox The mailbox
+ * @param msg Filled in with the message
+ * @param timeout How long to wait for a message
+ *
+ * @return True if a message was received, false if the wait timed out
+ */
+bool MailboxReceive(struct Mailbox *mailbox, uint8_t *msg, TickType_t timeout)
+{
+    TimeOut_t timeOut;
+    uint32_t remaining;
+    bool found = false;
+    int i;
+
+    vTaskSetTimeOutState(&timeOut);
+
+    do
+    {
+        if(xSemaphoreTake(mailbox->signal, timeout) != pdTRUE)
+            return false;
+
+        taskENTER_CRITICAL();
+        {
+            for(i = 0; i < mailbox->num_msgs; i++)
+            {
+                if(mailbox->pending & MAILBOX_BIT(mailbox->order[i]))
+                {
+                    *msg = mailbox->order[i];
+                    mailbox->pending &= ~MAILBOX_BIT(*msg);
+                    found = true;
+                    break;
+                }
+            }
+
+            remaining = mailbox->pending;
+        }
+        taskEXIT_CRITICAL();
+
+        // Keep the signal given while there's more to receive
+        if(remaining != 0)
+            xSemaphoreGive(mailbox->signal);
+
+        // A post can give the signal after its message was already taken
+        // here, so the signal doesn't always mean something is pending
+    } while(!found && xTaskCheckForTimeOut(&timeOut, &timeout) == pdFALSE);
+
+    return found;
+}
@@ -22,6 +22,7 @@
 #include "doordrv.h"
 #include "btndrv.h"
 #include "motordrv.h"
+#include "app.h"
 
 /* Hardware configuration. */
 #pragma config FPLLMUL = MUL_20, FPLLIDIV = DIV_2, FPLLODIV = DIV_1, FWDTEN = OFF
@@ -37,62 +38,8 @@ int main(void)
     /* Perform any hardware initialization that may be necessary. */
     prvSetupHardware();
 
-    // Create the queues
-    QueueHandle_t uartQueue = xQueueCreate(20, sizeof(char) * TX_SIZE);
-    QueueHandle_t door_rx_queue = xQueueCreate(1, sizeof(enum DOOR_MSG));
-    QueueHandle_t door_tx_queue = xQueueCreate(1, sizeof(enum DOOR_MSG));
-    
-    // Parameters for the tasks
-    xUartTaskParameter_t xUartParam = {uartQueue};
-    xPhysicsTaskParameter_t xPhysicsParam = {uartQueue, door_rx_queue, door_tx_queue};
-    xDoorTaskParameter_t xDoorParam = {door_rx_queue, door_tx_queue};
-    xBtnTaskParameter_t xBtnParam = {uartQueue, door_rx_queue};
-    
-    // Initialize the command line interface
-    InitCLI(door_rx_queue);
-    
-    // Create the tasks
-    xTaskCreate(taskPhysics,
-            "Physics",
-            configMINIMAL_STACK_SIZE,
-            (void*)&xPhysicsParam,
-            3,
-            NULL);
-    
-    xTaskCreate(taskDoor,
-            "Door",
-            configMINIMAL_STACK_SIZE,
-            (void*)&xDoorParam,
-            1,
-            NULL);
-    
-    xTaskCreate(taskButtons,
-            "Buttons",
-            configMINIMAL_STACK_SIZE,
-            (void*)&xBtnParam,
-            1,
-            NULL);
-    
-    xTaskCreate(taskMotor,
-            "Motor",
-            configMINIMAL_STACK_SIZE,
-            NULL,
-            1,
-            NULL);
-    
-    xTaskCreate(taskUARTRx,
-            "UartRx",
-            configMINIMAL_STACK_SIZE,
-            (void*)&xUartParam,
-            4,
-            &rx_task);
-    
-    xTaskCreate(taskUARTTx,
-            "UartTx",
-            configMINIMAL_STACK_SIZE,
-            (void*)&xUartParam,
-            2,
-            NULL);
+    // Create the queues and tasks
+    InitApp();
     
     /* Start the scheduler so the tasks start executing.  This function should not return. */
     vTaskStartScheduler();
@@ -1,39 +1,50 @@
 /**
- * Pulses a GPIO pin (in this case, RF8) 1Hz for every 10ft/s of movement
+ * Pulses a GPIO pin (in this case, RF8) 1Hz for every 10ft/s of movement.
+ * Sleeps while the car is stopped instead of checking the speed every second.
  */
 #define _SUPPRESS_PLIB_WARNING 1
 #define _DISABLE_OPENADC10_CONFIGPORT_WARNING 1
 
 #include <plib.h>
 #include <xc.h>
-#include <math.h>
 #include <FreeRTOS.h>
 #include <task.h>
-#include "physics.h"
+#include "carstate.h"
+
+// Slowest the pin is ever toggled at (1Hz)
+static const TickType_t maxToggleDelay = 1000 / portTICK_PERIOD_MS;
 
 // Handle toggling the motor
 void taskMotor(void *pvParameters)
 {
-    float cur_speed;
-    int hz = 1;
+    struct CarState state;
+    TickType_t toggleDelay;
     
     while(1)
     {
-        cur_speed = GetCurrentSpeed();
+        CarStateGet(&state);
         
-        if(cur_speed > 0.0f)
+        if(state.speed > 0.0f)
         {
-            hz = (int)floorf(cur_speed / 10.0f);
-            if(hz < 1)
-                hz = 1;
+            // 1Hz for every 10ft/s, without rounding down to a whole Hz
+            toggleDelay = (TickType_t)((10000.0f / state.speed) / portTICK_PERIOD_MS);
+            if(toggleDelay > maxToggleDelay)
+                toggleDelay = maxToggleDelay;
+            else if(toggleDelay < 1)
+                toggleDelay = 1;
             mPORTFToggleBits(BIT_8);
+            
+            // Stop toggling as soon as the car stops
+            CarStateWait(STATE_STOPPED, toggleDelay);
         }
         else
         {
-            hz = 1;
             mPORTFClearBits(BIT_8);
+            
+            // The speed stays at zero until the car's first step, so don't
+            // spin on the moving bit until then
+            if(CarStateWait(STATE_MOVING, portMAX_DELAY) & STATE_MOVING)
+                vTaskDelay(maxToggleDelay);
         }
-        
-        vTaskDelay((1000 / hz) / portTICK_PERIOD_MS);
     }
 }
@@ -0,0 +1,115 @@
+/**
+ * Predictive idle parking.
+ *
+ * Counts the hall calls made at each floor in each part of the day. When the
+ * car has nothing to do, it waits at the floor that has had the most calls in
+ * this part of the day and the next, so the next call is likely to find it
+ * already there.
+ */
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "parking.h"
+
+static uint16_t calls[PARKING_BUCKETS][PARKING_FLOORS];
+static volatile bool enabled = true;
+
+/**
+ * @return The bucket the current time of day falls in
+ */
+int ParkingBucketNow(void)
+{
+    uint32_t ms = (xTaskGetTickCount() * portTICK_PERIOD_MS) % PARKING_DAY_MS;
+
+    return ms / (PARKING_DAY_MS / PARKING_BUCKETS);
+}
+
+/**
+ * Count a hall call. A bucket that fills up is halved, so old history fades
+ * rather than sticking.
+ *
+ * @param floor The floor the call was made at
+ */
+void ParkingCall(int floor)
+{
+    int bucket = ParkingBucketNow();
+    int i;
+
+    if(floor < 0 || floor >= PARKING_FLOORS)
+        return;
+
+    taskENTER_CRITICAL();
+    {
+        if(calls[bucket][floor] == UINT16_MAX)
+            for(i = 0; i < PARKING_FLOORS; i++)
+                calls[bucket][i] /= 2;
+
+        calls[bucket][floor]++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @return The floor expected to make the next call, -1 if parking is off or
+ *         there's no history for this part of the day
+ */
+int ParkingFloor(void)
+{
+    int bucket = ParkingBucketNow();
+    int next = (bucket + 1) % PARKING_BUCKETS;
+    uint32_t expected, most = 0;
+    int floor, best = -1;
+
+    if(!enabled)
+        return -1;
+
+    for(floor = 0; floor < PARKING_FLOORS; floor++)
+    {
+        expected = calls[bucket][floor] + calls[next][floor];
+        if(expected > most)
+        {
+            most = expected;
+            best = floor;
+        }
+    }
+
+    return best;
+}
+
+void ParkingSetEnable(bool enable)
+{
+    enabled = enable;
+}
+
+bool ParkingEnabled(void)
+{
+    return enabled;
+}
+
+/**
+ * Forget every call counted
+ */
+void ParkingReset(void)
+{
+    taskENTER_CRITICAL();
+    {
+        memset(calls, 0, sizeof(calls));
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @param bucket The part of the day
+ * @param counts Filled in with the calls counted at each floor
+ */
+void ParkingGetBucket(int bucket, uint16_t counts[PARKING_FLOORS])
+{
+    if(bucket < 0 || bucket >= PARKING_BUCKETS)
+        bucket = 0;
+
+    taskENTER_CRITICAL();
+    {
+        memcpy(counts, calls[bucket], sizeof(calls[bucket]));
+    }
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,262 @@
+/**
+ * Performance statistics.
+ *
+ * Measures how well the controller serves its traffic, whatever makes it
+ * (buttons, the CLI or a journal replay): how long hall calls wait for the
+ * car, how long car calls take to get there, how many calls are served an
+ * hour, what each destination decision costs in CPU time and how full the
+ * UART TX queue runs. The PS command prints it all as key=value lines for
+ * scripts to compare between builds.
+ */
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "perfstats.h"
+
+struct PerfHistogram {
+    uint16_t buckets[PERF_BUCKETS];
+    uint32_t count;
+    uint32_t total_ms;
+    uint32_t max_ms;
+};
+
+static struct PerfHistogram histograms[PERF_NUM_CALLS];
+
+// When each floor's oldest unserved call of each type was made, 0 if none
+static TickType_t call_ticks[PERF_FLOORS][PERF_NUM_CALLS];
+
+static TickType_t start_tick;
+
+static uint32_t dispatches;
+static uint32_t dispatch_total;
+static uint32_t dispatch_max;
+static uint32_t intercepts;
+
+static uint32_t estops;
+static uint32_t estop_last;
+static uint32_t estop_max;
+
+static uint32_t queue_samples;
+static uint32_t queue_total;
+static uint32_t queue_max;
+
+/**
+ * Add a time to a histogram. Called in a critical section.
+ */
+static void AddTime(struct PerfHistogram *histogram, uint32_t ms)
+{
+    uint32_t bucket = ms / PERF_BUCKET_MS;
+
+    if(bucket >= PERF_BUCKETS)
+        bucket = PERF_BUCKETS - 1;
+
+    if(histogram->buckets[bucket] < UINT16_MAX)
+        histogram->buckets[bucket]++;
+
+    histogram->count++;
+    histogram->total_ms += ms;
+    if(ms > histogram->max_ms)
+        histogram->max_ms = ms;
+}
+
+/**
+ * Find the time a percentage of the histogram is at or under
+ *
+ * @return The upper edge of the bucket it falls in, no more than the maximum
+ */
+static uint32_t Percentile(const struct PerfHistogram *histogram, uint32_t percent)
+{
+    uint32_t wanted = (histogram->count * percent + 99) / 100;
+    uint32_t seen = 0, edge;
+    int i;
+
+    for(i = 0; i < PERF_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if(seen >= wanted)
+            break;
+    }
+
+    edge = (uint32_t)(i + 1) * PERF_BUCKET_MS;
+    return (edge < histogram->max_ms) ? edge : histogram->max_ms;
+}
+
+/**
+ * Note a call being made. A call for a floor that already has one of the
+ * same type waiting is timed from the first.
+ *
+ * @param floor The floor called for
+ * @param type A hall or car call
+ */
+void PerfCall(int floor, enum PERF_CALL type)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    if(floor < 0 || floor >= PERF_FLOORS)
+        return;
+
+    taskENTER_CRITICAL();
+    {
+        // 0 means no call, so a call on the very first tick is a tick late
+        if(call_ticks[floor][type] == 0)
+            call_ticks[floor][type] = (now != 0) ? now : 1;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note the car arriving at a floor and opening the door, which serves every
+ * call waiting for it
+ *
+ * @param floor The floor
+ */
+void PerfArrive(int floor)
+{
+    TickType_t now = xTaskGetTickCount();
+    int type;
+
+    if(floor < 0 || floor >= PERF_FLOORS)
+        return;
+
+    taskENTER_CRITICAL();
+    {
+        for(type = 0; type < PERF_NUM_CALLS; type++)
+        {
+            if(call_ticks[floor][type] != 0)
+            {
+                AddTime(&histograms[type],
+                        (now - call_ticks[floor][type]) * portTICK_PERIOD_MS);
+                call_ticks[floor][type] = 0;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note the cost of a destination decision
+ *
+ * @param counts Core timer counts the decision took
+ */
+void PerfDispatch(uint32_t counts)
+{
+    taskENTER_CRITICAL();
+    {
+        dispatches++;
+        dispatch_total += counts;
+        if(counts > dispatch_max)
+            dispatch_max = counts;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note a call picked up by a car already on its way somewhere else
+ */
+void PerfIntercept(void)
+{
+    taskENTER_CRITICAL();
+    {
+        intercepts++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note how long the car took to start braking for an emergency stop
+ *
+ * @param counts Core timer counts from the command to the braking
+ */
+void PerfEmergency(uint32_t counts)
+{
+    taskENTER_CRITICAL();
+    {
+        estops++;
+        estop_last = counts;
+        if(counts > estop_max)
+            estop_max = counts;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Note how many items were in the UART TX queue
+ *
+ * @param items The items waiting
+ */
+void PerfQueueSample(UBaseType_t items)
+{
+    taskENTER_CRITICAL();
+    {
+        queue_samples++;
+        queue_total += items;
+        if(items > queue_max)
+            queue_max = items;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Summarise everything since the stats were last reset
+ *
+ * @param report Filled in with the summary
+ */
+void PerfGetReport(struct PerfReport *report)
+{
+    uint32_t served = 0;
+    int type;
+
+    // The histograms are too big to copy in a critical section, and only
+    // tasks write them
+    vTaskSuspendAll();
+    {
+        report->elapsed_ms = (xTaskGetTickCount() - start_tick) * portTICK_PERIOD_MS;
+
+        for(type = 0; type < PERF_NUM_CALLS; type++)
+        {
+            struct PerfHistogram *histogram = &histograms[type];
+            struct PerfTimes *times = &report->times[type];
+
+            times->count = histogram->count;
+            times->avg = histogram->count ? histogram->total_ms / histogram->count : 0;
+            times->p95 = Percentile(histogram, 95);
+            times->p99 = Percentile(histogram, 99);
+            times->max = histogram->max_ms;
+            served += histogram->count;
+        }
+
+        report->dispatches = dispatches;
+        report->dispatch_avg = dispatches ? dispatch_total / dispatches : 0;
+        report->dispatch_max = dispatch_max;
+        report->intercepts = intercepts;
+        report->estops = estops;
+        report->estop_last = estop_last;
+        report->estop_max = estop_max;
+
+        report->queue_samples = queue_samples;
+        report->queue_avg_x100 = queue_samples ?
+                (uint32_t)(((uint64_t)queue_total * 100) / queue_samples) : 0;
+        report->queue_max = queue_max;
+    }
+    xTaskResumeAll();
+
+    report->calls_per_hour = report->elapsed_ms ?
+            (uint32_t)(((uint64_t)served * 3600000UL) / report->elapsed_ms) : 0;
+}
+
+/**
+ * Throw the stats away and start measuring again. Calls already waiting are
+ * still timed.
+ */
+void PerfReset(void)
+{
+    vTaskSuspendAll();
+    {
+        memset(histograms, 0, sizeof(histograms));
+        start_tick = xTaskGetTickCount();
+        dispatches = dispatch_total = dispatch_max = intercepts = 0;
+        estops = estop_last = estop_max = 0;
+        queue_samples = queue_total = queue_max = 0;
+    }
+    xTaskResumeAll();
+}
@@ -12,8 +12,17 @@
 #include <FreeRTOS.h>
 #include <timers.h>
 #include <queue.h>
+#include <semphr.h>
 #include "physics.h"
+#include "profile.h"
+#include "dispatch.h"
+#include "parking.h"
+#include "energy.h"
+#include "eta.h"
 #include "doordrv.h"
+#include "carstate.h"
+#include "perfstats.h"
+#include "trace.h"
 
 // Size of buffer of characters that get sent to the UART TX
 #define BUFFER_SIZE 50
@@ -21,14 +30,58 @@
 // Number of stops this elevator makes
 #define NUM_STOPS 3
 
+// The motion is worked out half a second at a time, stepping the profile this
+// many times
+#define PROFILE_STEPS 50
+#define PROFILE_STEP_MS (500 / PROFILE_STEPS)
+#define PROFILE_DT (PROFILE_STEP_MS / 1000.0f)
+
+// Telemetry rates the CLI can pick from
+#define MIN_TELEMETRY_HZ 1
+#define MAX_TELEMETRY_HZ 20
+
+// Close enough to the destination to call it stopped
+#define STOP_DISTANCE 0.05f
+#define STOP_SPEED 0.5f
+
 // Global variables
 static volatile float cur_loc;
 static volatile struct FloorRequest *dest;
-static volatile float cur_speed, max_speed, accel;
-static volatile bool going_up, accel_up;
+static volatile float cur_speed, max_speed, accel, jerk;
+static volatile bool going_up;
+static struct MotionState motion;
+static float cruise_speed;      // This trip's, eco mode can make it slower
+static bool parking;            // This trip's only to park, the door stays shut
 static volatile bool emerg_stop_enabled;
-static const TickType_t moveDelay = 500 / portTICK_PERIOD_MS;
-static const TickType_t noDestPolling = 100 / portTICK_PERIOD_MS;
+static volatile bool eta_stale = true;
+static TickType_t door_closes_at;
+static volatile bool estop_pending;    // Not yet braking for it
+static volatile bool estop_unpublished; // Asked for from an interrupt
+static volatile uint32_t estop_count;   // Core timer when it was asked for
+static volatile TickType_t telemetryDelay = 500 / portTICK_PERIOD_MS;
+TaskHandle_t physics_task;
+
+// Where the segment the car is in started from
+static struct {
+    TickType_t start;
+    struct MotionState motion;
+    float location;
+    struct MotionLimits limits;
+    struct EnergyMeter meter;
+    bool emergency;                     // Worked out for an emergency stop
+    bool braking;                       // ...and the car brakes for it
+} current;
+
+static const TickType_t parkDelay = PARKING_IDLE_MS / portTICK_PERIOD_MS;
+
+// Given whenever a floor is requested, so an idle car wakes up straight away
+static SemaphoreHandle_t request_semaphore;
+static StaticSemaphore_t request_semaphore_buffer;
+
+// The idle car waits on a new request and the door closing at the same time
+static QueueSetHandle_t wait_set;
+static StaticQueue_t wait_set_buffer;
+static uint8_t wait_set_storage[2 * sizeof(QueueHandle_t)];
 
 struct FloorRequest requests[] = {
     { false, UP, 0.0f, "GD" },
@@ -42,17 +95,18 @@ static const char stopped[] = "Stopped";
 static const char moving[] = "Moving";
 
 /** Getters and Setters **/
-bool GetIsMoving()
-{
-    return !((cur_loc == dest->feet) && (cur_speed == 0.0f));
-}
-
 struct FloorRequest GetRequest(int requestNum)
 {
     return requests[requestNum];
 }
 
-void SetRequest(int requestNum, enum DIR dir)
+/**
+ * Add a request for a floor, merging it with one already waiting
+ * 
+ * @param requestNum The floor's request number
+ * @param dir The way the caller wants to go
+ */
+static void AddRequest(int requestNum, enum DIR dir)
 {
     if(requests[requestNum].isRequested && 
       ((requests[requestNum].dir == UP && dir == DOWN) || 
@@ -62,112 +116,551 @@ void SetRequest(int requestNum, enum DIR dir)
         requests[requestNum].dir = dir;
     
     requests[requestNum].isRequested = true;
+    eta_stale = true;
+    xSemaphoreGive(request_semaphore);
 }
 
-bool GetGoingUp(void)
+/**
+ * Hall call, made from outside the car
+ * 
+ * @param requestNum The floor's request number
+ * @param dir The way the caller wants to go
+ */
+void SetRequest(int requestNum, enum DIR dir)
 {
-    return going_up;
+    PerfCall(requestNum, PERF_HALL);
+    ParkingCall(requestNum);
+    AddRequest(requestNum, dir);
 }
 
-float GetCurrentSpeed(void)
+/**
+ * Car call, made from inside the car. Goes the way the car is going.
+ * 
+ * @param requestNum The floor's request number
+ */
+void SetCarRequest(int requestNum)
 {
-    return cur_speed;
+    PerfCall(requestNum, PERF_CAR);
+    
+    if(CarStateFlags() & STATE_GOING_UP)
+        AddRequest(requestNum, UP);
+    else
+        AddRequest(requestNum, DOWN);
 }
 
 void SetMaxSpeed(float speed)
 {
     max_speed = speed;
+    eta_stale = true;
 }
 
 void SetAccel(float new_accel)
 {
     accel = new_accel;
+    eta_stale = true;
+}
+
+void SetJerk(float new_jerk)
+{
+    jerk = new_jerk;
+    eta_stale = true;
 }
 
+/**
+ * Set how often the car's location is sent while it's moving
+ * 
+ * @param hz Reports a second, limited to what the UART can keep up with
+ * 
+ * @return False if the rate is out of range
+ */
+bool SetTelemetryRate(int hz)
+{
+    if(hz < MIN_TELEMETRY_HZ || hz > MAX_TELEMETRY_HZ)
+        return false;
+    
+    telemetryDelay = (1000 / hz) / portTICK_PERIOD_MS;
+    return true;
+}
+
+/**
+ * Emergency stop. A moving car is woken straight away and starts braking from
+ * where it is, rather than at the end of the segment it's in.
+ */
 void SetEmergStopEnable()
 {
+    // Only the first press is timed
+    if(!emerg_stop_enabled)
+    {
+        estop_count = _CP0_GET_COUNT();
+        estop_pending = true;
+    }
+    
     emerg_stop_enabled = true;
+    eta_stale = true;
+    CarStateSetFlags(STATE_EMERGENCY);
+    xTaskNotifyGive(physics_task);
+    xSemaphoreGive(request_semaphore);
 }
 
 /**
- * Move the elevator car (update location and speed)
+ * Emergency stop from an interrupt. The car state can't be published from an
+ * interrupt, so the physics task publishes it once it's woken. The interrupt
+ * should end with portEND_SWITCHING_ISR(), so the physics task runs as soon as
+ * it exits.
+ * 
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if the physics task should
+ *                                  run when the interrupt exits
  */
-static void MoveCar(xPhysicsTaskParameter_t *taskParam)
+void SetEmergStopEnableFromISR(BaseType_t *pxHigherPriorityTaskWoken)
 {
-    char buffer[BUFFER_SIZE];
-    float decel_speed;
+    // Only the first press is timed
+    if(!emerg_stop_enabled)
+    {
+        estop_count = _CP0_GET_COUNT();
+        estop_pending = true;
+    }
+    
+    emerg_stop_enabled = true;
+    eta_stale = true;
+    estop_unpublished = true;
+    vTaskNotifyGiveFromISR(physics_task, pxHigherPriorityTaskWoken);
+    xSemaphoreGiveFromISR(request_semaphore, pxHigherPriorityTaskWoken);
+}
+
+/**
+ * Publish an emergency stop that was asked for from an interrupt
+ */
+static void PublishEmergency(void)
+{
+    if(!estop_unpublished)
+        return;
+    
+    estop_unpublished = false;
+    CarStateSetFlags(STATE_EMERGENCY);
+}
+
+/**
+ * Create what the physics task waits on. Must be called before any requests
+ * are made.
+ * 
+ * @param door_tx_queue The queue the door says it has closed on
+ */
+void InitPhysics(QueueHandle_t door_tx_queue)
+{
+    request_semaphore = xSemaphoreCreateBinaryStatic(&request_semaphore_buffer);
+    
+    // Room for one event from each member
+    wait_set = xQueueCreateSetStatic(2, wait_set_storage, &wait_set_buffer);
+    xQueueAddToSet(request_semaphore, wait_set);
+    xQueueAddToSet(door_tx_queue, wait_set);
+    
+    TraceNameQueue(request_semaphore, "Request");
+}
+
+/**
+ * Wait for a new request or a message from the door. Members of the queue
+ * set are only ever read here, so the set never holds stale entries.
+ * 
+ * @param taskParam The task's parameter struct
+ * @param timeout How long to wait
+ * 
+ * @return True if the door said it has closed
+ */
+static bool WaitForEvent(xPhysicsTaskParameter_t *taskParam, TickType_t timeout)
+{
+    QueueSetMemberHandle_t member;
+    enum DOOR_MSG msg;
+    
+    member = xQueueSelectFromSet(wait_set, timeout);
+    PublishEmergency();
+    
+    if(member == taskParam->door_tx_queue)
+        return (xQueueReceive(taskParam->door_tx_queue, (void*)&msg, 0) == pdTRUE && msg == CLOSED);
+    
+    // A new request, the caller looks for it
+    if(member == request_semaphore)
+        xSemaphoreTake(request_semaphore, 0);
+    
+    return false;
+}
+
+/**
+ * Work out the arrival times at each floor again, from where the car is now
+ * 
+ * @param moving True if the car is on its way to dest
+ */
+static void UpdateEta(bool moving)
+{
+    struct EtaInput input;
+    TickType_t now = xTaskGetTickCount();
+    
+    eta_stale = false;
+    
+    if(emerg_stop_enabled)
+    {
+        EtaInvalidate();
+        return;
+    }
+    
+    input.location = cur_loc;
+    input.speed = moving ? cur_speed : 0.0f;
+    input.dest = moving ? dest - requests : -1;
+    input.door_at_dest = !parking;
+    input.going_up = going_up;
+    input.limits.max_speed = max_speed;
+    input.limits.accel = accel;
+    input.limits.jerk = jerk;
+    input.cruise_speed = moving ? cruise_speed : max_speed;
+    
+    // The door task may not have started opening the door yet
+    if((int32_t)(door_closes_at - now) > 0)
+        input.door_left_ms = (door_closes_at - now) * portTICK_PERIOD_MS;
+    else
+        input.door_left_ms = 0;
     
-    accel_up = going_up;
+    EtaUpdate(&input, requests);
+}
+
+/**
+ * Send the door a message and wait for it to close again
+ * 
+ * @param taskParam The task's parameter struct
+ * @param msg The message to send
+ */
+static void CycleDoor(xPhysicsTaskParameter_t *taskParam, enum DOOR_MSG msg)
+{
+    // Throw away a closed message left over from a door sequence nobody
+    // waited for. Requests are looked for again once the door closes.
+    while(uxQueueMessagesWaiting(wait_set) > 0)
+        WaitForEvent(taskParam, 0);
+    
+    door_closes_at = xTaskGetTickCount() + DISPATCH_DOOR_MS / portTICK_PERIOD_MS;
+    MailboxPost(taskParam->door_mailbox, msg);
     
-    while(cur_loc != dest->feet)
+    do
     {
-        vTaskDelay(moveDelay);  // Wait half a second
+        if(eta_stale)
+            UpdateEta(false);
+    } while(!WaitForEvent(taskParam, portMAX_DELAY));
+}
 
-        // Start slowing down if we're in an emergency stop
-        if(emerg_stop_enabled)
+/**
+ * @return True if a call is waiting besides the one being served
+ */
+static bool CallsWaiting(void)
+{
+    int i;
+    
+    for(i = 0; i < NUM_STOPS; i++)
+        if(requests[i].isRequested)
+            return true;
+    
+    return false;
+}
+
+/**
+ * Pick the speed to cruise at. In eco mode a trip nobody else is waiting on
+ * goes as slowly as the ETA bound allows.
+ */
+static void PlanTrip(void)
+{
+    struct MotionLimits limits;
+    
+    cruise_speed = max_speed;
+    
+    if(!EnergyEcoEnabled() || emerg_stop_enabled || CallsWaiting())
+        return;
+    
+    limits.max_speed = max_speed;
+    limits.accel = accel;
+    limits.jerk = jerk;
+    cruise_speed = EnergyEcoSpeed(&limits, fabsf(dest->feet - cur_loc));
+}
+
+/**
+ * Step the motion profile towards the destination
+ * 
+ * @param limits The limits to move with
+ * @param steps The most steps to take
+ * 
+ * @return The steps taken, fewer if the car arrived
+ */
+static int RunSteps(const struct MotionLimits *limits, int steps)
+{
+    float remaining, moved, speed;
+    int step;
+    
+    for(step = 0; step < steps; step++)
+    {
+        if(going_up)
+            remaining = dest->feet - cur_loc;
+        else
+            remaining = cur_loc - dest->feet;
+        
+        speed = motion.speed;
+        moved = ProfileStep(&motion, limits, remaining, PROFILE_DT);
+        
+        // We've reached our destination, at the end of this step
+        if(moved >= remaining || (remaining - moved <= STOP_DISTANCE && motion.speed <= STOP_SPEED))
         {
-            if(going_up)
-            {
-                dest = &(requests[3]);
-                requests[3].feet = cur_loc + (cur_speed * cur_speed) / (2.0f * accel);
-            }
-            else
-            {
-                dest = &(requests[0]);
-                accel_up = going_up;
-            }
+            EnergyStep(speed, 0.0f, remaining, going_up);
+            motion.speed = 0.0f;
+            motion.accel = 0.0f;
+            motion.braking = false;
+            cur_loc = dest->feet;
+            return step + 1;
         }
         
-        // Update location
+        EnergyStep(speed, motion.speed, moved, going_up);
+        
         if(going_up)
-            cur_loc += cur_speed / 2;
+            cur_loc += moved;
         else
-            cur_loc -= cur_speed / 2;
-
-        // Update speed
-        if(going_up == accel_up)
-            cur_speed += accel / 2;
-        else
-            cur_speed -= accel / 2;
+            cur_loc -= moved;
+    }
+    
+    return steps;
+}
 
-        if(cur_speed > max_speed)
-            cur_speed = max_speed;
+/**
+ * Work out the car's next half second, or less if it arrives sooner, and
+ * publish it before the car gets there
+ * 
+ * @param start The tick the segment starts at
+ * 
+ * @return The tick it ends at
+ */
+static TickType_t StepSegment(TickType_t start)
+{
+    struct MotionLimits limits;
+    struct CarSegment segment;
+    int steps;
+    
+    // Somebody else is waiting now, so stop saving energy
+    if(cruise_speed < max_speed && CallsWaiting())
+        cruise_speed = max_speed;
+    
+    limits.max_speed = (cruise_speed < max_speed) ? cruise_speed : max_speed;
+    
+    if(eta_stale)
+        UpdateEta(true);
+    limits.accel = accel;
+    limits.jerk = jerk;
 
-        // If we're at max speed, then don't consider acceleration into the location (because it would be zero)
-        if(cur_speed != max_speed)
+    // Start slowing down if we're in an emergency stop. On the way down the car
+    // carries on to the ground floor, so only an upward trip brakes.
+    current.braking = false;
+    if(emerg_stop_enabled)
+    {
+        if(going_up)
         {
-            if(accel_up)
-                cur_loc += (0.125f * accel);
-            else
-                cur_loc += (-0.125f * accel);
+            dest = &(requests[3]);
+            requests[3].feet = cur_loc + ProfileBrakingDistance(&motion, &limits);
+            current.braking = true;
         }
-
-        // Calculate speed at which we should have started decelerating
-        if(going_up)
-            decel_speed = sqrtf(2.0f * accel * (dest->feet - cur_loc));
         else
-            decel_speed = sqrtf(2.0f * accel * (cur_loc - dest->feet));
+            dest = &(requests[0]);
+    }
+    
+    // Kept so the segment can be cut short
+    current.start = start;
+    current.motion = motion;
+    current.location = cur_loc;
+    current.limits = limits;
+    current.emergency = emerg_stop_enabled;
+    EnergyTripSave(&current.meter);
+    
+    segment.start = start;
+    segment.location = cur_loc;
+    segment.speed = cur_speed;
+    
+    steps = RunSteps(&limits, PROFILE_STEPS);
+    cur_speed = motion.speed;
+    
+    segment.end = start + (steps * PROFILE_STEP_MS) / portTICK_PERIOD_MS;
+    segment.end_location = cur_loc;
+    segment.end_speed = cur_speed;
+    CarStateSetSegment(&segment, dest - requests);
+    
+    return segment.end;
+}
 
-        // Correct for overshoot
-        if(cur_speed >= decel_speed)
-        {
-            // Reverse the direction of acceleration if we haven't already
-            if(accel_up == going_up)
-                accel_up = !accel_up;
+/**
+ * Throw away the rest of the segment the car is in and start braking from the
+ * step it's at now
+ * 
+ * @param now The tick the emergency is handled at
+ * 
+ * @return The tick the new segment ends at
+ */
+static TickType_t BrakeNow(TickType_t now)
+{
+    int steps = ((now - current.start) * portTICK_PERIOD_MS) / PROFILE_STEP_MS;
+    
+    // Back to the start of the segment, then forward to now again, which
+    // works out the same as it did the first time
+    motion = current.motion;
+    cur_loc = current.location;
+    EnergyTripRestore(&current.meter);
+    RunSteps(&current.limits, steps);
+    cur_speed = motion.speed;
+    
+    return StepSegment(current.start + (steps * PROFILE_STEP_MS) / portTICK_PERIOD_MS);
+}
 
-            cur_speed = decel_speed;
-        }
+/**
+ * Turn the moving car aside to a call it can still stop for on the way. The
+ * call it was heading for waits until it sets off again.
+ * 
+ * @return True if the car has a new destination
+ */
+static bool Intercept(void)
+{
+    struct DispatchCar car;
+    struct MotionLimits limits;
+    int stop;
+    
+    if(emerg_stop_enabled)
+        return false;
+    
+    limits.max_speed = max_speed;
+    limits.accel = accel;
+    limits.jerk = jerk;
+    
+    car.location = cur_loc;
+    car.going_up = going_up;
+    car.limits = limits;
+    
+    stop = DispatchIntercept(&car, requests, NUM_STOPS, dest->feet,
+                             ProfileBrakingDistance(&motion, &limits));
+    if(stop < 0)
+        return false;
+    
+    // A trip to park wasn't for a call, so there's nothing to put back
+    if(!parking)
+        dest->isRequested = true;
+    
+    dest = &(requests[stop]);
+    parking = false;
+    eta_stale = true;
+    PerfIntercept();
+    
+    return true;
+}
+
+/**
+ * Send where the car is right now
+ */
+static void Report(xPhysicsTaskParameter_t *taskParam)
+{
+    char buffer[BUFFER_SIZE];
+    struct CarState state;
+    
+    CarStateGet(&state);
+    snprintf(buffer, BUFFER_SIZE, "%.2f Feet :: %.2f ft/s\r\n", state.location, state.speed);
+    xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
+}
 
-        // If our speed is zero or below, then we've reached our destination
-        if(cur_speed <= 0.0f || (!going_up && cur_loc <= dest->feet) || (going_up && cur_loc >= dest->feet))
+/**
+ * Say how long it took from the emergency stop being asked for to the car
+ * braking for it, the first time only. Nothing is said when the car is going
+ * down, as it doesn't brake.
+ */
+static void ReportBraking(xPhysicsTaskParameter_t *taskParam)
+{
+    char buffer[BUFFER_SIZE];
+    uint32_t counts;
+    
+    if(!estop_pending || !current.braking)
+        return;
+    
+    counts = _CP0_GET_COUNT() - estop_count;
+    estop_pending = false;
+    PerfEmergency(counts);
+    
+    snprintf(buffer, BUFFER_SIZE, "Braking %lu us after the emergency stop\r\n",
+             (unsigned long)(counts / PERF_COUNTS_PER_US));
+    xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
+}
+
+/**
+ * Move the elevator car (update location and speed). The physics runs a
+ * segment ahead of the car, the telemetry reports at its own rate in between.
+ * Calls made on the way are looked at before each segment. An emergency stop
+ * wakes the task and cuts the segment short.
+ */
+static void MoveCar(xPhysicsTaskParameter_t *taskParam)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t segment_end = now, next_report = now + telemetryDelay, wake;
+    char buffer[BUFFER_SIZE];
+    
+    if(cur_loc == dest->feet)
+        return;
+    
+    while(1)
+    {
+        now = xTaskGetTickCount();
+        PublishEmergency();
+        
+        // An emergency stop came in part way through a segment
+        if(emerg_stop_enabled && !current.emergency && (int32_t)(now - segment_end) < 0)
         {
-            cur_speed = 0.0f;
-            cur_loc = dest->feet;
+            segment_end = BrakeNow(now);
+            ReportBraking(taskParam);
+        }
+        
+        // The car has got to the end of the last segment
+        if((int32_t)(now - segment_end) >= 0)
+        {
+            if(cur_loc == dest->feet)
+                break;
+            
+            if(Intercept())
+            {
+                snprintf(buffer, BUFFER_SIZE, "Floor %s %s\r\n", dest->acronym, moving);
+                xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
+            }
+            
+            segment_end = StepSegment(segment_end);
+            ReportBraking(taskParam);
+        }
+        
+        if((int32_t)(now - next_report) >= 0)
+        {
+            Report(taskParam);
+            next_report += telemetryDelay;
+            
+            // Skip the reports there wasn't time for
+            if((int32_t)(now - next_report) >= 0)
+                next_report = now + telemetryDelay;
         }
+        
+        wake = ((int32_t)(next_report - segment_end) < 0) ? next_report : segment_end;
+        if((int32_t)(wake - now) > 0)
+            ulTaskNotifyTake(pdTRUE, wake - now);
+    }
+    
+    // Exactly where it stopped
+    Report(taskParam);
+}
 
-        // Print out the current speed and destination
-        snprintf(buffer, BUFFER_SIZE, "%.2f Feet :: %.2f ft/s\r\n", cur_loc, cur_speed);
-        xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
+/**
+ * Update the UP/DN LEDs and the car state to the way the car is going
+ */
+static void ShowDirection(void)
+{
+    if(going_up)
+    {
+        mPORTBSetBits(BIT_5);
+        mPORTBClearBits(BIT_4);
+        CarStateSetFlags(STATE_GOING_UP);
+    }
+    else
+    {
+        mPORTBSetBits(BIT_4);
+        mPORTBClearBits(BIT_5);
+        CarStateSetFlags(STATE_GOING_DOWN);
     }
 }
 
@@ -180,20 +673,14 @@ static void MoveCar(xPhysicsTaskParameter_t *taskParam)
  */
 bool UpdateDestination(xPhysicsTaskParameter_t *taskParam)
 {
+    struct DispatchCar car;
     bool updated = false;
-    
-    // Update the direction
-    if(cur_loc == requests[0].feet)
-        going_up = true;
-    else if(cur_loc == requests[1].feet && requests[1].dir == UP)
-        going_up = true;
-    else if(cur_loc == requests[1].feet && requests[1].dir == DOWN)
-        going_up = false;
-    else if(cur_loc == requests[2].feet)
-        going_up = false;
+    int stop;
     
     if(emerg_stop_enabled)
     {
+        // Stopped already, or went down to the ground floor without braking
+        estop_pending = false;
         dest = &(requests[0]);
         dest->isRequested = false;
         updated = true;
@@ -201,67 +688,109 @@ bool UpdateDestination(xPhysicsTaskParameter_t *taskParam)
     }
     else
     {
-        if(going_up)
-        {
-            if(cur_loc == requests[0].feet)
-            {
-                if(requests[0].isRequested) { dest = &(requests[0]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == UP) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == EITHER) { dest = &(requests[1]); requests[1].dir = DOWN; updated = true; }
-                else if(requests[2].isRequested) { dest = &(requests[2]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == DOWN) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-            }
-            else if(cur_loc == requests[1].feet)
-            {
-                if(requests[1].isRequested && requests[1].dir == UP) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == EITHER) { dest = &(requests[1]); requests[1].dir = DOWN; updated = true; }
-                else if(requests[2].isRequested) { dest = &(requests[2]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == DOWN) { dest = &(requests[1]); dest->isRequested = false; updated = true; going_up = false; }
-                else if(requests[0].isRequested) { dest = &(requests[0]); dest->isRequested = false; updated = true; going_up = false; }
-            }
-        }
-        else
+        car.location = cur_loc;
+        car.going_up = going_up;
+        car.limits.max_speed = max_speed;
+        car.limits.accel = accel;
+        car.limits.jerk = jerk;
+        
+        stop = DispatchNext(&car, requests, NUM_STOPS);
+        going_up = car.going_up;
+        
+        if(stop >= 0)
         {
-            if(cur_loc == requests[1].feet)
-            {
-                if(requests[1].isRequested && requests[1].dir == DOWN) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == EITHER) { dest = &(requests[1]); requests[1].dir = UP; updated = true; }
-                else if(requests[0].isRequested) { dest = &(requests[0]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == UP) { dest = &(requests[1]); dest->isRequested = false; updated = true; going_up = true; }
-                else if(requests[2].isRequested) { dest = &(requests[2]); dest->isRequested = false; updated = true; going_up = true; }
-            }
-            else if(cur_loc == requests[2].feet)
-            {
-                if(requests[2].isRequested) { dest = &(requests[2]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == DOWN) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == EITHER) { dest = &(requests[1]); requests[1].dir = UP; updated = true; }
-                else if(requests[0].isRequested) { dest = &(requests[0]); dest->isRequested = false; updated = true; }
-                else if(requests[1].isRequested && requests[1].dir == UP) { dest = &(requests[1]); dest->isRequested = false; updated = true; }
-            }
+            dest = &(requests[stop]);
+            updated = true;
         }
     }
     
-    // Update UP/DN Leds
-    if(going_up)
-    {
-        mPORTBSetBits(BIT_5);
-        mPORTBClearBits(BIT_4);
-    }
-    else
-    {
-        mPORTBSetBits(BIT_4);
-        mPORTBClearBits(BIT_5);
-    }
+    ShowDirection();
+    
+    return updated;
+}
+
+/**
+ * Pick the next destination, timing how long the decision takes
+ * 
+ * @param taskParam The task's parameter struct
+ * 
+ * @return True if the destination was updated, false otherwise
+ */
+static bool Dispatch(xPhysicsTaskParameter_t *taskParam)
+{
+    uint32_t start = _CP0_GET_COUNT();
+    bool updated = UpdateDestination(taskParam);
+    
+    PerfDispatch(_CP0_GET_COUNT() - start);
     
     return updated;
 }
 
+/**
+ * Send the idle car to wait where the next call is most likely
+ * 
+ * @return True if the car has somewhere to go
+ */
+static bool Park(void)
+{
+    int floor = ParkingFloor();
+    
+    if(floor < 0 || requests[floor].feet == cur_loc)
+        return false;
+    
+    dest = &(requests[floor]);
+    going_up = (dest->feet > cur_loc);
+    ShowDirection();
+    
+    return true;
+}
+
+/**
+ * Wait for somewhere to go. Once the door has been closed with nothing to do
+ * for long enough, the car parks.
+ * 
+ * @param taskParam The task's parameter struct
+ * 
+ * @return True if the car is only parking
+ */
+static bool WaitForDestination(xPhysicsTaskParameter_t *taskParam)
+{
+    TickType_t idle_since = xTaskGetTickCount(), idle;
+    bool parked = false;
+    
+    while(1)
+    {
+        idle = xTaskGetTickCount() - idle_since;
+        
+        // If somebody opened the door, or there's no destination, then wait
+        if(!(CarStateFlags() & STATE_DOOR_CLOSED))
+        {
+            idle_since += idle;
+            idle = 0;
+        }
+        else if(Dispatch(taskParam))
+            return false;
+        else if(!parked && !emerg_stop_enabled && idle >= parkDelay)
+        {
+            // Only once until the car next moves
+            parked = true;
+            if(Park())
+                return true;
+        }
+        
+        if(eta_stale)
+            UpdateEta(false);
+        
+        WaitForEvent(taskParam, parked ? portMAX_DELAY : parkDelay - idle);
+    }
+}
+
 // Handle all of the physics calculations
 void taskPhysics(void *pvParameters)
 {
     char buffer[BUFFER_SIZE];
-    enum DOOR_MSG msg;
     xPhysicsTaskParameter_t *taskParam;
+    float energy;
     taskParam = (xPhysicsTaskParameter_t *)pvParameters;
     
     // Set defaults
@@ -270,52 +799,55 @@ void taskPhysics(void *pvParameters)
     cur_loc = 0.0f;
     cur_speed = 0.0f;
     accel = 10.0f;
+    jerk = 20.0f;
     going_up = true;
-    accel_up = going_up;
+    motion.speed = 0.0f;
+    motion.accel = 0.0f;
+    motion.braking = false;
     emerg_stop_enabled = false;
     
     while(1)
     {
-        // If there's no destination, then wait
-        while(!UpdateDestination(taskParam))
-        {
-            vTaskDelay(noDestPolling);
-            
-            // If somebody opened the door, wait for it to close
-            if(!GetDoorClosed())
-                xQueueReceive(taskParam->door_tx_queue, (void*)&msg, portMAX_DELAY);
-        }
+        parking = WaitForDestination(taskParam);
         
         // If we're moving, say so
         if(cur_loc != dest->feet)
         {
+            CarStateSetMotion(cur_loc, cur_speed, dest - requests);
+            CarStateSetFlags(STATE_MOVING);
             snprintf(buffer, BUFFER_SIZE, "Floor %s %s\r\n", dest->acronym, moving);
             xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
         }
         
+        PlanTrip();
+        UpdateEta(true);
+        EnergyTripStart();
         MoveCar(taskParam);
+        CarStateSetFlags(STATE_STOPPED);
+        eta_stale = true;
+        energy = EnergyTripEnd();
         
         // The elevator has arrived at its destination
         snprintf(buffer, BUFFER_SIZE, "Floor %s %s\r\n", dest->acronym, stopped);
         xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
         
+        if(energy != 0.0f)
+        {
+            snprintf(buffer, BUFFER_SIZE, "Trip energy %.1f kJ\r\n", energy / 1000.0f);
+            xQueueSendToBack(taskParam->tx_queue, (void*)buffer, 0);
+        }
+        
         // Handle door animation
         if(emerg_stop_enabled && (cur_loc == requests[0].feet))
         {
-            msg = STAY_OPEN;
-            xQueueOverwrite(taskParam->door_rx_queue, (void*)&msg);
             emerg_stop_enabled = false;
-            
-            // Wait for door to close
-            xQueueReceive(taskParam->door_tx_queue, (void*)&msg, portMAX_DELAY);
+            CarStateSetFlags(STATE_NORMAL);
+            CycleDoor(taskParam, STAY_OPEN);
         }
-        else if(!emerg_stop_enabled)
+        else if(!emerg_stop_enabled && !parking)
         {
-            msg = OPEN_CLOSE_SEQ;
-            xQueueOverwrite(taskParam->door_rx_queue, (void*)&msg);
-            
-            // Wait for door to close
-            xQueueReceive(taskParam->door_tx_queue, (void*)&msg, portMAX_DELAY);
+            PerfArrive(dest - requests);
+            CycleDoor(taskParam, OPEN_CLOSE_SEQ);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,287 @@
+/**
+ * Jerk-limited (S-curve) motion profile generator used by the physics task.
+ *
+ * The profile is closed-loop: every step it looks at how far away the stop is
+ * and picks the acceleration it wants to be at (full acceleration, cruise or
+ * full braking). The acceleration is then slewed towards that target at no
+ * more than the jerk limit, so the car never changes acceleration instantly.
+ * Setting the jerk limit to zero gives back the old trapezoid profile.
+ */
+#include <math.h>
+#include "profile.h"
+
+static float Integrate(struct MotionState *state,
+                       const struct MotionLimits *limits,
+                       float target,
+                       float dt);
+
+/**
+ * Advance a constant-jerk segment
+ *
+ * @param speed Speed at the start of the segment (updated)
+ * @param accel Acceleration at the start of the segment (updated)
+ * @param jerk The jerk applied for the whole segment
+ * @param t Length of the segment in seconds
+ *
+ * @return The distance covered during the segment
+ */
+static float AdvanceSegment(float *speed, float *accel, float jerk, float t)
+{
+    float dist = (*speed * t) + (0.5f * *accel * t * t) + (jerk * t * t * t / 6.0f);
+
+    *speed += (*accel * t) + (0.5f * jerk * t * t);
+    *accel += jerk * t;
+
+    return dist;
+}
+
+/**
+ * Distance needed to come to a complete stop from the given state
+ *
+ * @param state The current motion state
+ * @param limits The limits the braking has to respect
+ *
+ * @return The braking distance in feet
+ */
+float ProfileBrakingDistance(const struct MotionState *state,
+                             const struct MotionLimits *limits)
+{
+    float speed = state->speed;
+    float accel = state->accel;
+    float jerk = limits->jerk;
+    float dist = 0.0f;
+    float peak, hold;
+
+    // Infinite jerk, so this is the usual constant deceleration formula
+    if(jerk <= 0.0f)
+        return (speed * speed) / (2.0f * limits->accel);
+
+    // Still speeding up, so the acceleration has to be wound back first
+    if(accel > 0.0f)
+        dist += AdvanceSegment(&speed, &accel, -jerk, accel / jerk);
+
+    // Deceleration we'd peak at if we never had to hold it (accel <= 0 here)
+    peak = sqrtf(jerk * speed + 0.5f * accel * accel);
+    if(peak < -accel)
+        peak = -accel;
+
+    // Ramp into the deceleration, hold it if we hit the limit, then release
+    if(peak > limits->accel)
+    {
+        peak = limits->accel;
+        dist += AdvanceSegment(&speed, &accel, -jerk, (peak + accel) / jerk);
+
+        hold = (speed - (peak * peak) / (2.0f * jerk)) / peak;
+        if(hold > 0.0f)
+            dist += AdvanceSegment(&speed, &accel, 0.0f, hold);
+    }
+    else
+        dist += AdvanceSegment(&speed, &accel, -jerk, (peak + accel) / jerk);
+
+    dist += AdvanceSegment(&speed, &accel, jerk, -accel / jerk);
+
+    return dist;
+}
+
+/**
+ * Acceleration to head towards when not braking (speed up, or cruise)
+ *
+ * @param state The current motion state
+ * @param limits The limits of the profile
+ * @param ease Speed still gained or lost while the acceleration winds back
+ * @param dt The time step in seconds
+ *
+ * @return The target acceleration
+ */
+static float CruiseAccel(const struct MotionState *state,
+                         const struct MotionLimits *limits,
+                         float ease,
+                         float dt)
+{
+    // Someone lowered the maximum speed while we were moving
+    if(state->speed > limits->max_speed)
+    {
+        if(state->accel < 0.0f && state->speed - limits->max_speed <= ease - state->accel * dt)
+            return 0.0f;
+
+        return -limits->accel;
+    }
+
+    // Ease into the cruise speed instead of slamming into it
+    if(state->accel > 0.0f && limits->max_speed - state->speed <= ease + state->accel * dt)
+        return 0.0f;
+
+    if(state->speed >= limits->max_speed)
+        return 0.0f;
+
+    return limits->accel;
+}
+
+/**
+ * Acceleration to head towards once the car has committed to stopping
+ *
+ * @param state The current motion state
+ * @param limits The limits of the profile
+ * @param ease Speed still lost while the deceleration winds back
+ * @param remaining The distance left to the stop
+ * @param dt The time step in seconds
+ *
+ * @return The target acceleration
+ */
+static float BrakeAccel(const struct MotionState *state,
+                        const struct MotionLimits *limits,
+                        float ease,
+                        float remaining,
+                        float dt)
+{
+    struct MotionState next;
+    float moved;
+
+    // Let go of the brake so speed and acceleration reach zero together
+    if(state->accel < 0.0f && state->speed <= ease - state->accel * dt)
+        return 0.0f;
+
+    // Started braking a touch early, so don't brake any harder yet
+    next = *state;
+    moved = Integrate(&next, limits, state->accel, dt);
+    if(ProfileBrakingDistance(&next, limits) + moved < remaining)
+        return state->accel;
+
+    return -limits->accel;
+}
+
+/**
+ * Slew the acceleration towards a target and integrate speed over one step
+ *
+ * @param state The motion state to update
+ * @param limits The limits of the profile
+ * @param target The acceleration to head towards
+ * @param dt The time step in seconds
+ *
+ * @return The distance covered during the step
+ */
+static float Integrate(struct MotionState *state,
+                       const struct MotionLimits *limits,
+                       float target,
+                       float dt)
+{
+    float prev_accel = state->accel;
+    float prev_speed = state->speed;
+    float slew = limits->jerk * dt;
+
+    // Never change acceleration faster than the jerk limit allows
+    if(limits->jerk <= 0.0f || fabsf(target - state->accel) <= slew)
+        state->accel = target;
+    else if(target > state->accel)
+        state->accel += slew;
+    else
+        state->accel -= slew;
+
+    state->speed += 0.5f * (prev_accel + state->accel) * dt;
+
+    if(state->speed <= 0.0f)
+    {
+        state->speed = 0.0f;
+        state->accel = 0.0f;
+        state->braking = false;
+    }
+    else if(!state->braking && prev_speed <= limits->max_speed &&
+            state->speed > limits->max_speed)
+    {
+        state->speed = limits->max_speed;
+        state->accel = 0.0f;
+    }
+
+    return 0.5f * (prev_speed + state->speed) * dt;
+}
+
+/**
+ * Advance the profile by dt seconds towards a stop "remaining" feet away
+ *
+ * @param state The motion state to update
+ * @param limits The limits of the profile
+ * @param remaining The distance left to the stop
+ * @param dt The time step in seconds
+ *
+ * @return The distance covered during the step
+ */
+float ProfileStep(struct MotionState *state,
+                  const struct MotionLimits *limits,
+                  float remaining,
+                  float dt)
+{
+    struct MotionState next;
+    float ease, target, moved;
+
+    // How much speed we'll still gain or lose while the acceleration winds back
+    if(limits->jerk > 0.0f)
+        ease = (state->accel * state->accel) / (2.0f * limits->jerk);
+    else
+        ease = 0.0f;
+
+    target = CruiseAccel(state, limits, ease, dt);
+
+    // Look one step ahead so we never commit to braking too late
+    if(!state->braking)
+    {
+        next = *state;
+        moved = Integrate(&next, limits, target, dt);
+
+        if(ProfileBrakingDistance(&next, limits) + moved >= remaining)
+            state->braking = true;
+    }
+
+    if(state->braking)
+        target = BrakeAccel(state, limits, ease, remaining, dt);
+
+    return Integrate(state, limits, target, dt);
+}
+
+/**
+ * Time a rest-to-rest move takes, for weighing up destinations. Uses the
+ * closed form S-curve, so it ignores the physics task's half second steps and
+ * the slack it allows when stopping.
+ *
+ * @param limits The limits of the profile
+ * @param distance How far the car has to go in feet
+ *
+ * @return The time in seconds
+ */
+float ProfileTravelTime(const struct MotionLimits *limits, float distance)
+{
+    float speed = limits->max_speed;
+    float accel = limits->accel;
+    float jerk = limits->jerk;
+    float ramp, peak;
+
+    if(distance <= 0.0f || speed <= 0.0f || accel <= 0.0f)
+        return 0.0f;
+
+    // Time spent winding the acceleration up and back down, zero without
+    // jerk limiting
+    ramp = (jerk > 0.0f) ? accel / jerk : 0.0f;
+
+    if(jerk <= 0.0f || speed >= accel * ramp)
+    {
+        // Full acceleration is reached. Speeding up to cruise takes
+        // speed / accel + ramp seconds, at an average of half the speed.
+        if(distance >= speed * (speed / accel + ramp))
+            return distance / speed + speed / accel + ramp;
+
+        // Too short to cruise: the peak speed solves
+        // distance = peak * (peak / accel + ramp)
+        peak = 0.5f * accel * (sqrtf(ramp * ramp + 4.0f * distance / accel) - ramp);
+        if(jerk <= 0.0f || peak >= accel * ramp)
+            return 2.0f * (peak / accel + ramp);
+    }
+    else if(distance >= 2.0f * speed * sqrtf(speed / jerk))
+    {
+        // Cruise is reached before full acceleration
+        return distance / speed + 2.0f * sqrtf(speed / jerk);
+    }
+
+    // Neither is reached, the acceleration only ramps up and down:
+    // distance = 2 * peak^1.5 / sqrt(jerk)
+    peak = powf(0.5f * distance * sqrtf(jerk), 2.0f / 3.0f);
+    return 4.0f * sqrtf(peak / jerk);
+}
@@ -0,0 +1,125 @@
+/**
+ * Per-task run time statistics.
+ *
+ * The kernel charges each task with the time it spent running, measured with
+ * the PIC32 core timer (see portGET_RUN_TIME_COUNTER_VALUE() in
+ * FreeRTOSConfig.h). This module also keeps a copy of every task's counter
+ * from when the window was last reset, so the CLI can show how the CPU was
+ * shared over just the part of a run that is of interest.
+ */
+#include <string.h>
+#include <xc.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "runstats.h"
+
+// A task's run time counter at the start of the window
+struct TaskBaseline {
+    TaskHandle_t handle;
+    uint32_t run_time;
+};
+
+// Extends the 32-bit core timer so the counter doesn't jump when it wraps
+static uint32_t last_count;
+static uint32_t wraps;
+
+// Counters at the start of the window
+static struct TaskBaseline baseline[RUN_STATS_MAX_TASKS];
+static int num_baseline;
+static uint32_t baseline_total;
+
+// Scratch space for uxTaskGetSystemState(), only used from the CLI task
+static TaskStatus_t status[RUN_STATS_MAX_TASKS];
+
+/**
+ * Set up the run time counter. Called by the kernel when the scheduler starts.
+ *
+ * The core timer always runs at half the CPU clock, so there is nothing to
+ * configure besides where the counter starts from.
+ */
+void RunStatsInit(void)
+{
+    last_count = _CP0_GET_COUNT();
+    wraps = 0;
+    num_baseline = 0;
+    baseline_total = 0;
+}
+
+/**
+ * Read the run time counter. The kernel calls this on every context switch,
+ * which happens far more often than the 107 seconds it takes the core timer
+ * to wrap, so every wrap is seen.
+ *
+ * @return The core timer divided by 2^RUN_STATS_SHIFT
+ */
+uint32_t RunStatsGetCounter(void)
+{
+    uint32_t count = _CP0_GET_COUNT();
+
+    if(count < last_count)
+        wraps++;
+    last_count = count;
+
+    return (wraps << (32 - RUN_STATS_SHIFT)) | (count >> RUN_STATS_SHIFT);
+}
+
+/**
+ * Start a new measurement window
+ */
+void RunStatsReset(void)
+{
+    UBaseType_t num, i;
+    uint32_t total;
+
+    num = uxTaskGetSystemState(status, RUN_STATS_MAX_TASKS, &total);
+
+    for(i = 0; i < num; i++)
+    {
+        baseline[i].handle = status[i].xHandle;
+        baseline[i].run_time = status[i].ulRunTimeCounter;
+    }
+
+    num_baseline = num;
+    baseline_total = total;
+}
+
+/**
+ * Read the run time of every task since the window was last reset
+ *
+ * @param tasks Filled in with the run time of each task
+ * @param maxTasks The number of entries in tasks
+ * @param total Filled in with the length of the window
+ *
+ * @return The number of tasks filled in
+ */
+int RunStatsGet(struct TaskRunTime *tasks, int maxTasks, uint32_t *total)
+{
+    UBaseType_t num, i;
+    uint32_t now;
+    int j, count = 0;
+
+    num = uxTaskGetSystemState(status, RUN_STATS_MAX_TASKS, &now);
+
+    for(i = 0; i < num && count < maxTasks; i++)
+    {
+        strncpy(tasks[count].name, status[i].pcTaskName, configMAX_TASK_NAME_LEN);
+        tasks[count].name[configMAX_TASK_NAME_LEN - 1] = '\0';
+        tasks[count].run_time = status[i].ulRunTimeCounter;
+
+        // Tasks created since the reset have no baseline to take off
+        for(j = 0; j < num_baseline; j++)
+        {
+            if(baseline[j].handle == status[i].xHandle)
+            {
+                tasks[count].run_time -= baseline[j].run_time;
+                break;
+            }
+        }
+
+        count++;
+    }
+
+    *total = now - baseline_total;
+
+    return count;
+}
@@ -0,0 +1,218 @@
+/**
+ * Stack monitor.
+ *
+ * Every task is created with a stack of configMINIMAL_STACK_SIZE words,
+ * whatever it actually needs. This task checks the high water mark of every
+ * stack once a period and remembers the least free space each task ever had,
+ * so the CLI can print a recommended size for each stack without scanning the
+ * stacks itself. The ISR stack is checked the same way.
+ */
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "stackmon.h"
+
+// What the monitor knows about one task
+struct StackRecord {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t size;
+    uint16_t min_free;
+};
+
+// Provided by app.c, also tells us how big the idle task's stack is
+extern void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                          StackType_t **ppxIdleTaskStackBuffer,
+                                          uint16_t *pusIdleTaskStackSize);
+
+#if configCHECK_FOR_STACK_OVERFLOW > 2
+// The ISR stack in port.c, which fills it with 0xee when the scheduler starts
+extern StackType_t xISRStack[];
+#define ISR_STACK_FILL 0xeeeeeeeeUL
+#endif
+
+static const TickType_t samplePeriod = STACK_MON_PERIOD_MS / portTICK_PERIOD_MS;
+
+static struct StackRecord records[STACK_MON_MAX_TASKS];
+static int num_records;
+static uint16_t isr_min_free = configISR_STACK_SIZE;
+
+// Scratch space for uxTaskGetSystemState(), only used by the monitor task
+static TaskStatus_t status[STACK_MON_MAX_TASKS];
+
+/**
+ * Find (or claim) the record for a task. Called with the scheduler suspended.
+ *
+ * @param task The task's handle
+ *
+ * @return The record, or NULL if there's no room left
+ */
+static struct StackRecord *FindRecord(TaskHandle_t task)
+{
+    int i;
+
+    for(i = 0; i < num_records; i++)
+    {
+        if(records[i].handle == task)
+            return &records[i];
+    }
+
+    if(num_records == STACK_MON_MAX_TASKS)
+        return NULL;
+
+    records[num_records].handle = task;
+    records[num_records].name[0] = '\0';
+    records[num_records].size = 0;
+    records[num_records].min_free = UINT16_MAX;
+    return &records[num_records++];
+}
+
+/**
+ * Count the ISR stack words that have never been written
+ *
+ * @return The free ISR stack in words
+ */
+static uint16_t IsrStackFree(void)
+{
+    uint16_t count = 0;
+
+#if configCHECK_FOR_STACK_OVERFLOW > 2
+    // The stack grows down, so the untouched words are at the start
+    while(count < configISR_STACK_SIZE && xISRStack[count] == ISR_STACK_FILL)
+        count++;
+#endif
+
+    return count;
+}
+
+/**
+ * Check every stack and keep the lowest free space seen
+ */
+static void Sample(void)
+{
+    struct StackRecord *record;
+    UBaseType_t num, i;
+    uint16_t isr_free;
+
+    // Scanning the stacks is the slow part, so do it before suspending
+    num = uxTaskGetSystemState(status, STACK_MON_MAX_TASKS, NULL);
+    isr_free = IsrStackFree();
+
+    vTaskSuspendAll();
+    {
+        for(i = 0; i < num; i++)
+        {
+            record = FindRecord(status[i].xHandle);
+            if(record == NULL)
+                continue;
+
+            strncpy(record->name, status[i].pcTaskName, configMAX_TASK_NAME_LEN);
+            record->name[configMAX_TASK_NAME_LEN - 1] = '\0';
+
+            if(status[i].usStackHighWaterMark < record->min_free)
+                record->min_free = status[i].usStackHighWaterMark;
+        }
+
+        if(isr_free < isr_min_free)
+            isr_min_free = isr_free;
+    }
+    xTaskResumeAll();
+}
+
+/**
+ * Tell the monitor how big a task's stack is, so it can recommend a size.
+ * Tasks that aren't registered are still monitored.
+ *
+ * @param task The task's handle
+ * @param size The stack depth the task was created with, in words
+ */
+void StackMonRegister(TaskHandle_t task, uint16_t size)
+{
+    struct StackRecord *record;
+
+    vTaskSuspendAll();
+    {
+        record = FindRecord(task);
+        if(record != NULL)
+            record->size = size;
+    }
+    xTaskResumeAll();
+}
+
+/**
+ * Read the stack use of every task the monitor has seen
+ *
+ * @param tasks Filled in with the stack use of each task
+ * @param maxTasks The number of entries in tasks
+ *
+ * @return The number of tasks filled in
+ */
+int StackMonGet(struct StackUsage *tasks, int maxTasks)
+{
+    uint32_t used, margin;
+    int i, count = 0;
+
+    vTaskSuspendAll();
+    {
+        // Skip tasks that were registered but haven't been sampled yet
+        for(i = 0; i < num_records && count < maxTasks; i++)
+        {
+            if(records[i].min_free == UINT16_MAX)
+                continue;
+
+            memcpy(tasks[count].name, records[i].name, configMAX_TASK_NAME_LEN);
+            tasks[count].size = records[i].size;
+            tasks[count].min_free = records[i].min_free;
+            tasks[count].recommended = 0;
+
+            if(records[i].size > 0)
+            {
+                used = records[i].size - records[i].min_free;
+                margin = (used * STACK_MON_MARGIN_PERCENT) / 100;
+                if(margin < STACK_MON_MIN_MARGIN)
+                    margin = STACK_MON_MIN_MARGIN;
+
+                // Keep the stack a multiple of 8 bytes
+                tasks[count].recommended = (uint16_t)((used + margin + 1) & ~1UL);
+            }
+
+            count++;
+        }
+    }
+    xTaskResumeAll();
+
+    return count;
+}
+
+/**
+ * @return The least free ISR stack ever seen, in words
+ */
+uint16_t StackMonIsrMinFree(void)
+{
+    return isr_min_free;
+}
+
+/**
+ * Stack Monitor Task
+ *
+ * @param pvParameters Unused
+ */
+void taskStackMonitor(void *pvParameters)
+{
+    StaticTask_t *idleTCB;
+    StackType_t *idleStack;
+    uint16_t idleStackSize;
+    TickType_t lastWake;
+
+    // The idle task only exists once the scheduler is running
+    vApplicationGetIdleTaskMemory(&idleTCB, &idleStack, &idleStackSize);
+    StackMonRegister(xTaskGetIdleTaskHandle(), idleStackSize);
+
+    lastWake = xTaskGetTickCount();
+
+    while(1)
+    {
+        Sample();
+        vTaskDelayUntil(&lastWake, samplePeriod);
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * Kernel trace recorder.
+ *
+ * The kernel's trace hooks (see FreeRTOSConfig.h) and the UART interrupt log
+ * compact timestamped events into a RAM ring buffer: context switches, queue
+ * and semaphore traffic, and interrupt entry and exit. The TR command dumps the
+ * buffer over the UART, and tools/trace2chrome.py turns the dump into a file
+ * the Chrome/Perfetto trace viewer can open.
+ */
+#include <stddef.h>
+#include <xc.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include "trace.h"
+
+#if (TRACE_EVENTS & (TRACE_EVENTS - 1)) != 0
+#error TRACE_EVENTS must be a power of two
+#endif
+
+// The ring buffer and the number of events written to it since the restart
+static struct TraceEvent events[TRACE_EVENTS];
+static volatile uint32_t num_recorded;
+static volatile bool recording = true;
+
+// Names for the dump, number n is entry n - 1
+static const char *queue_names[TRACE_MAX_QUEUES];
+static int num_queues;
+static const char * const isr_names[] = {"UART1"};
+
+/**
+ * Record an event. Called from inside the kernel, often with interrupts
+ * already masked, so this has to be short.
+ *
+ * @param type One of the TRACE_ event types
+ * @param id The task, queue or interrupt the event is about
+ * @param arg Extra information, depending on the type
+ */
+void TraceRecord(uint8_t type, uint8_t id, uint16_t arg)
+{
+    struct TraceEvent *event;
+    unsigned int status;
+
+    // Mask everything for a few instructions. Restoring the old status rather
+    // than unmasking makes this safe before the scheduler starts and in ISRs.
+    status = __builtin_disable_interrupts();
+
+    if(recording)
+    {
+        event = &events[num_recorded & (TRACE_EVENTS - 1)];
+        event->time = _CP0_GET_COUNT();
+        event->type = type;
+        event->id = id;
+        event->arg = arg;
+        num_recorded++;
+    }
+
+    _CP0_SET_STATUS(status);
+}
+
+/**
+ * Number a queue or semaphore so its events can be told apart, and remember
+ * its name for the dump. Queues that aren't named all show up as number 0.
+ *
+ * @param queue The queue or semaphore handle
+ * @param name The name to show in the dump
+ */
+void TraceNameQueue(void *queue, const char *name)
+{
+    if(num_queues == TRACE_MAX_QUEUES)
+        return;
+
+    queue_names[num_queues++] = name;
+    vQueueSetQueueNumber((QueueHandle_t)queue, num_queues);
+}
+
+/**
+ * Look up a queue name
+ *
+ * @param num The queue number, starting at 1
+ *
+ * @return The name, or NULL once past the last named queue
+ */
+const char *TraceQueueName(int num)
+{
+    if(num < 1 || num > num_queues)
+        return NULL;
+
+    return queue_names[num - 1];
+}
+
+/**
+ * Look up an interrupt name
+ *
+ * @param num The interrupt number, starting at 1
+ *
+ * @return The name, or NULL once past the last interrupt
+ */
+const char *TraceIsrName(int num)
+{
+    if(num < 1 || num > (int)(sizeof(isr_names) / sizeof(isr_names[0])))
+        return NULL;
+
+    return isr_names[num - 1];
+}
+
+/**
+ * Stop recording so the buffer can be read without it changing
+ */
+void TracePause(void)
+{
+    recording = false;
+}
+
+/**
+ * Empty the buffer and start recording again
+ */
+void TraceRestart(void)
+{
+    taskENTER_CRITICAL();
+    {
+        num_recorded = 0;
+        recording = true;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @return The number of events in the buffer
+ */
+int TraceNumEvents(void)
+{
+    if(num_recorded > TRACE_EVENTS)
+        return TRACE_EVENTS;
+
+    return (int)num_recorded;
+}
+
+/**
+ * Read an event from the buffer. Only meaningful while recording is paused.
+ *
+ * @param eventNum Which event to read, 0 being the oldest
+ * @param event Filled in with the event
+ *
+ * @return True if eventNum was valid, false once past the newest event
+ */
+bool TraceGetEvent(int eventNum, struct TraceEvent *event)
+{
+    uint32_t first = 0;
+
+    if(eventNum < 0 || eventNum >= TraceNumEvents())
+        return false;
+
+    // Once the buffer has wrapped, the oldest event is the next to be replaced
+    if(num_recorded > TRACE_EVENTS)
+        first = num_recorded - TRACE_EVENTS;
+
+    *event = events[(first + eventNum) & (TRACE_EVENTS - 1)];
+    return true;
+}
@@ -0,0 +1,398 @@
+/**
+ * Synthetic passenger traffic.
+ *
+ * Passengers turn up as a Poisson process whose rate follows the profile's
+ * curve, at an origin and with a destination drawn from the profile's
+ * origin-destination matrix. Each one makes a hall call, gets on when the door
+ * opens at their floor and makes a car call, then gets off when the door opens
+ * at their destination. Calls go through the same entry points as the keys
+ * and buttons, so the dispatch logic and the performance stats can't tell the
+ * difference.
+ *
+ * The rate curve is followed by thinning: arrivals are drawn at the curve's
+ * peak rate and each one is kept with the probability rate / peak rate.
+ *
+ * The generator only knows the time and the car's state from what
+ * TrafficStep() is given, so something other than its task can run it: the
+ * host's traffic-bench steps it through millions of passengers in virtual
+ * time.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "physics.h"
+#include "carstate.h"
+#include "traffic.h"
+
+struct TrafficProfile {
+    const char *name;
+    uint8_t curve[TRAFFIC_CURVE_SEGMENTS];              // Percent of the peak rate
+    uint8_t od[TRAFFIC_FLOORS][TRAFFIC_FLOORS];         // Weights, [origin][destination]
+};
+
+static const struct TrafficProfile profiles[TRAFFIC_NUM_PROFILES] = {
+    [TRAFFIC_UNIFORM] = { "UNIFORM",
+        { 100, 100, 100, 100, 100, 100, 100, 100 },
+        { { 0, 1, 1 }, { 1, 0, 1 }, { 1, 1, 0 } } },
+    [TRAFFIC_UP_PEAK] = { "UP",
+        { 20, 50, 100, 100, 70, 40, 20, 10 },
+        { { 0, 40, 40 }, { 5, 0, 5 }, { 5, 5, 0 } } },
+    [TRAFFIC_DOWN_PEAK] = { "DOWN",
+        { 20, 50, 100, 100, 70, 40, 20, 10 },
+        { { 0, 5, 5 }, { 40, 0, 5 }, { 40, 5, 0 } } },
+    [TRAFFIC_LUNCH] = { "LUNCH",
+        { 30, 60, 100, 80, 80, 100, 60, 30 },
+        { { 0, 40, 40 }, { 40, 0, 10 }, { 40, 10, 0 } } },
+    [TRAFFIC_STORM] = { "STORM",
+        { 100, 100, 100, 100, 100, 100, 100, 100 },
+        { { 0, 1, 1 }, { 1, 0, 1 }, { 1, 1, 0 } } }
+};
+
+// One emergency stop for this many passengers in the storm profile
+#define STORM_PASSENGERS 20
+
+// The generator's task, woken when the generator is started
+TaskHandle_t traffic_task;
+
+// Set by the CLI, read by the generator
+static volatile bool running;
+static enum TRAFFIC_PROFILE profile;
+static uint32_t calls_per_hour;
+static uint32_t rng_state;
+
+// Only written by the generator
+static uint32_t waiting[TRAFFIC_FLOORS][TRAFFIC_FLOORS];   // [origin][destination]
+static uint32_t riding[TRAFFIC_FLOORS];                     // [destination]
+static struct TrafficStats stats;
+
+// When the generator next has something to do, and where it's up to
+static TickType_t next_arrival, next_storm, clear_at;
+static bool opened;         // Passengers have been let on at this stop
+static bool storm_pending, clearing;
+static struct Mailbox *door_mailbox;
+
+/**
+ * xorshift32, so a run can be repeated from its seed
+ *
+ * @return The next pseudo-random number
+ */
+static uint32_t Random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+ * @return A pseudo-random number in (0, 1]
+ */
+static float RandomUnit(void)
+{
+    return ((Random() >> 8) + 1) / 16777216.0f;
+}
+
+/**
+ * Draw the time to the next arrival at the given rate
+ *
+ * Rounded to the nearest tick, so the gaps average what the rate asks for
+ * even when they're only a few ticks long, but never less than one
+ *
+ * @param perHour Arrivals an hour
+ *
+ * @return Ticks to wait
+ */
+static TickType_t NextGap(uint32_t perHour)
+{
+    float ms = -logf(RandomUnit()) * (3600000.0f / perHour);
+    TickType_t ticks = (TickType_t)(ms / portTICK_PERIOD_MS + 0.5f);
+
+    return (ticks > 0) ? ticks : 1;
+}
+
+/**
+ * @param when A tick to wait for
+ * @param now The current tick
+ *
+ * @return Ticks until then, 0 if it has passed
+ */
+static TickType_t Until(TickType_t when, TickType_t now)
+{
+    return ((int32_t)(when - now) > 0) ? when - now : 0;
+}
+
+/**
+ * @param now The current tick
+ *
+ * @return The percentage of the peak rate the profile's curve is at
+ */
+static uint8_t CurveAt(TickType_t now)
+{
+    uint32_t ms = (now * portTICK_PERIOD_MS) % TRAFFIC_CURVE_MS;
+
+    return profiles[profile].curve[ms / (TRAFFIC_CURVE_MS / TRAFFIC_CURVE_SEGMENTS)];
+}
+
+/**
+ * A passenger turns up: pick where from and where to, and call the car
+ */
+static void Arrive(void)
+{
+    const struct TrafficProfile *p = &profiles[profile];
+    uint32_t total = 0, pick;
+    int origin, dest;
+
+    for(origin = 0; origin < TRAFFIC_FLOORS; origin++)
+        for(dest = 0; dest < TRAFFIC_FLOORS; dest++)
+            total += p->od[origin][dest];
+
+    pick = Random() % total;
+
+    for(origin = 0; origin < TRAFFIC_FLOORS; origin++)
+    {
+        for(dest = 0; dest < TRAFFIC_FLOORS; dest++)
+        {
+            if(pick < p->od[origin][dest])
+            {
+                waiting[origin][dest]++;
+                stats.arrived++;
+                stats.waiting++;
+                SetRequest(origin, (dest > origin) ? UP : DOWN);
+                return;
+            }
+
+            pick -= p->od[origin][dest];
+        }
+    }
+}
+
+/**
+ * The door has opened at a floor: let everybody off who's getting off, and
+ * everybody waiting on, each pressing the button for where they're going
+ *
+ * @param floor The floor
+ */
+static void OpenAt(int floor)
+{
+    int dest;
+
+    stats.delivered += riding[floor];
+    stats.riding -= riding[floor];
+    riding[floor] = 0;
+
+    for(dest = 0; dest < TRAFFIC_FLOORS; dest++)
+    {
+        if(waiting[floor][dest] == 0)
+            continue;
+
+        riding[dest] += waiting[floor][dest];
+        stats.boarded += waiting[floor][dest];
+        stats.riding += waiting[floor][dest];
+        stats.waiting -= waiting[floor][dest];
+        waiting[floor][dest] = 0;
+
+        SetCarRequest(dest);
+    }
+}
+
+/**
+ * @param state The car's state
+ *
+ * @return The floor the car is stopped at, or -1 if it isn't at one
+ */
+static int FloorOf(const struct CarState *state)
+{
+    if(state->dest < 0 || state->dest >= TRAFFIC_FLOORS)
+        return -1;
+
+    if(state->location != GetRequest(state->dest).feet)
+        return -1;
+
+    return state->dest;
+}
+
+/**
+ * Start generating traffic, throwing away any passengers from the last run
+ *
+ * @param newProfile The traffic profile
+ * @param callsPerHour Passengers an hour at the peak of the profile's curve
+ * @param seed Seeds the random numbers, so a run can be repeated
+ *
+ * @return False if the profile or rate is no good
+ */
+bool TrafficStart(enum TRAFFIC_PROFILE newProfile, uint32_t callsPerHour, uint32_t seed)
+{
+    if(newProfile >= TRAFFIC_NUM_PROFILES || callsPerHour == 0)
+        return false;
+
+    // Stop the generator first so it doesn't see a half changed setup
+    running = false;
+
+    vTaskSuspendAll();
+    {
+        profile = newProfile;
+        calls_per_hour = callsPerHour;
+        rng_state = (seed != 0) ? seed : 1;
+        memset(waiting, 0, sizeof(waiting));
+        memset(riding, 0, sizeof(riding));
+        memset(&stats, 0, sizeof(stats));
+        running = true;
+    }
+    xTaskResumeAll();
+
+    xTaskNotifyGive(traffic_task);
+    return true;
+}
+
+/**
+ * Stop generating traffic. Passengers already in the building are forgotten
+ * about, but their calls are still served.
+ */
+void TrafficStop(void)
+{
+    running = false;
+}
+
+/**
+ * @param out Filled in with what the generator has done since it started
+ */
+void TrafficGetStats(struct TrafficStats *out)
+{
+    vTaskSuspendAll();
+    {
+        *out = stats;
+        out->running = running;
+        out->profile = profile;
+        out->calls_per_hour = calls_per_hour;
+    }
+    xTaskResumeAll();
+}
+
+/**
+ * @return The profile's name, as the TG command takes it
+ */
+const char *TrafficProfileName(enum TRAFFIC_PROFILE which)
+{
+    if(which >= TRAFFIC_NUM_PROFILES)
+        return "?";
+
+    return profiles[which].name;
+}
+
+/**
+ * Start the generator's clock, once TrafficStart() has been called
+ *
+ * @param now The current tick
+ */
+void TrafficBegin(TickType_t now)
+{
+    next_arrival = now + NextGap(calls_per_hour);
+    next_storm = now + NextGap(calls_per_hour / STORM_PASSENGERS + 1);
+    storm_pending = clearing = opened = false;
+}
+
+/**
+ * Do whatever is due, and work out what to wait for before the next step
+ *
+ * @param now The current tick
+ * @param bits The car's state bits that were set when the wait ended
+ * @param wait Filled in with the bits to wait for and the ticks to wait
+ */
+void TrafficStep(TickType_t now, EventBits_t bits, struct TrafficWait *wait)
+{
+    EventBits_t wanted = opened ? STATE_DOOR_CLOSED : STATE_DOOR_OPEN;
+    struct CarState state;
+    TickType_t timeout;
+    int floor;
+
+    if((wanted & STATE_DOOR_OPEN) && (bits & STATE_DOOR_OPEN))
+    {
+        CarStateGet(&state);
+        floor = FloorOf(&state);
+        if(floor >= 0)
+            OpenAt(floor);
+        opened = true;
+
+        // Emergency over, the car is at the ground floor with the door
+        // held open. Close it after a while, like the ER command.
+        if(storm_pending && floor == 0)
+        {
+            storm_pending = false;
+            clearing = true;
+            clear_at = now + TRAFFIC_STORM_HOLD_MS / portTICK_PERIOD_MS;
+        }
+    }
+    else if((wanted & STATE_DOOR_CLOSED) && (bits & STATE_DOOR_CLOSED))
+        opened = false;
+
+    if(Until(next_arrival, now) == 0)
+    {
+        // Thinning: keep the arrival with the curve's share of the peak
+        if(Random() % 100 < CurveAt(now))
+            Arrive();
+        next_arrival = now + NextGap(calls_per_hour);
+    }
+
+    if(profile == TRAFFIC_STORM && !storm_pending && !clearing &&
+       Until(next_storm, now) == 0)
+    {
+        SetEmergStopEnable();
+        stats.emergencies++;
+        storm_pending = true;
+        next_storm = now + NextGap(calls_per_hour / STORM_PASSENGERS + 1);
+    }
+
+    if(clearing && Until(clear_at, now) == 0)
+    {
+        clearing = false;
+        if(CarStateFlags() & STATE_STOPPED)
+            MailboxPost(door_mailbox, CLOSE);
+    }
+
+    // Sleep until the next thing the generator has to do
+    timeout = Until(next_arrival, now);
+    if(profile == TRAFFIC_STORM && !storm_pending && !clearing &&
+       Until(next_storm, now) < timeout)
+        timeout = Until(next_storm, now);
+    if(clearing && Until(clear_at, now) < timeout)
+        timeout = Until(clear_at, now);
+
+    wait->bits = opened ? STATE_DOOR_CLOSED : STATE_DOOR_OPEN;
+    wait->ticks = timeout;
+}
+
+/**
+ * Traffic Generator Task
+ *
+ * Runs the generator on the kernel's clock and the car's state event group
+ *
+ * @param pvParameters The task's parameters
+ */
+void taskTraffic(void *pvParameters)
+{
+    xTrafficTaskParameter_t *taskParam = (xTrafficTaskParameter_t *)pvParameters;
+    struct TrafficWait wait;
+    EventBits_t bits;
+
+    door_mailbox = taskParam->door_mailbox;
+
+    while(1)
+    {
+        if(!running)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            TrafficBegin(xTaskGetTickCount());
+            TrafficStep(xTaskGetTickCount(), 0, &wait);
+            continue;
+        }
+
+        bits = CarStateWait(wait.bits, wait.ticks);
+
+        if(running)
+            TrafficStep(xTaskGetTickCount(), bits, &wait);
+    }
+}
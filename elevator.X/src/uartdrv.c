@@ -16,16 +16,27 @@
 #include <semphr.h>
 #include "FreeRTOS_CLI.h"
 #include "uartdrv.h"
+#include "trace.h"
+#include "journal.h"
+#include "perfstats.h"
 
 // The UART module to be using
 volatile static UART_MODULE uart_module;
 
-// When performing polled transmit IO, delay for this much time
+// When performing polled transmit IO, delay for this much time. Only
+// vUartPutC() polls, and only while the transmitter is busy. The receive task
+// blocks on rx_semaphore, so an idle UART never wakes the tickless idle task.
 static const TickType_t pollDelay = 2 / portTICK_PERIOD_MS;
 
 // For transmitting a newline
 static const char newLine[] = "\r\n";
 
+// Sent once the journal has been replayed
+static const char replayDone[] = "\r\nJournal replay finished\r\n";
+
+// Keys that run a command straight away, without waiting for enter
+static const char keyCommands[] = "zxcvbnm";
+
 // Transmit/Receive buffers
 static char tx_buffer[TX_SIZE];
 static char rx_buffer;
@@ -38,6 +49,8 @@ TaskHandle_t rx_task;
 // Mutexes
 SemaphoreHandle_t rx_semaphore;
 SemaphoreHandle_t tx_semaphore;
+static StaticSemaphore_t rx_semaphore_buffer;
+static StaticSemaphore_t tx_semaphore_buffer;
 
 // Assembly ISR wrapper
 void __attribute__((interrupt(IPL1AUTO), vector(_UART1_VECTOR)))
@@ -71,9 +84,12 @@ void InitUART(UART_MODULE umPortNum, uint32_t ui32WantedBaud)
     uart_module = umPortNum;
     
     // Create Semaphores
-    rx_semaphore = xSemaphoreCreateBinary();
-    tx_semaphore = xSemaphoreCreateBinary();
+    rx_semaphore = xSemaphoreCreateBinaryStatic(&rx_semaphore_buffer);
+    tx_semaphore = xSemaphoreCreateBinaryStatic(&tx_semaphore_buffer);
     xSemaphoreGive(tx_semaphore);
+    
+    TraceNameQueue(rx_semaphore, "RxSem");
+    TraceNameQueue(tx_semaphore, "TxSem");
 }
 
 /**
@@ -120,6 +136,52 @@ char UartGetChar(void)
     return rx_buffer;
 }
 
+/**
+ * Get the next character from the journal while it's being replayed, waiting
+ * for the tick it was originally received on
+ * 
+ * @param cursor Where the replay is up to
+ * @param c Filled in with the character
+ * 
+ * @return False if there's nothing left to replay
+ */
+static bool ReplayChar(struct JournalCursor *cursor, char *c)
+{
+    struct JournalEntry entry;
+    TickType_t now;
+    
+    if(!JournalPeek(cursor, &entry))
+        return false;
+    
+    now = xTaskGetTickCount();
+    if(entry.tick > now)
+        vTaskDelay(entry.tick - now);
+    
+    JournalNext(cursor);
+    *c = (char)entry.data;
+    
+    return true;
+}
+
+/**
+ * Record a received character in the journal
+ * 
+ * @param c The character
+ * @param lineStart True if nothing has been typed on the current line yet
+ */
+static void RecordChar(char c, bool lineStart)
+{
+    if(c != '\0' && strchr(keyCommands, c) != NULL)
+        JournalRecord(JOURNAL_KEY, (uint8_t)c);
+    else
+    {
+        if(lineStart)
+            JournalLineStart();
+        
+        JournalRecord(JOURNAL_UART, (uint8_t)c);
+    }
+}
+
 /**
  * UART Transmit Task
  * 
@@ -137,6 +199,7 @@ void taskUARTTx(void *pvParameters)
     {
         // Handle queue messages
         xQueueReceive(pxTaskParameter->tx_queue, (void*)&message, portMAX_DELAY);
+        PerfQueueSample(uxQueueMessagesWaiting(pxTaskParameter->tx_queue) + 1);
         vUartPutStr(UART1, message, strlen(message));
     }
 }
@@ -155,16 +218,34 @@ void taskUARTRx(void *pvParameters)
     typedChar[1] = '\0';
     uint16_t buffer_index = 0;
     portBASE_TYPE moreData;
+    struct JournalCursor replay;
+    bool replaying = JournalReplaying();
     
     /* The parameter points to an xTaskParameters_t structure. */
     pxTaskParameter = (xUartTaskParameter_t *) pvParameters;
     
+    JournalStart(&replay, JOURNAL_UART | JOURNAL_KEY);
+    
     while(1)
     {
-        xSemaphoreTake(rx_semaphore, portMAX_DELAY);
+        // Grab the currently being typed command, from the journal instead of
+        // the UART until the replay is over
+        if(replaying && !ReplayChar(&replay, &buffer[buffer_index]))
+        {
+            replaying = false;
+            
+            // Drop anything typed during the replay
+            xSemaphoreTake(rx_semaphore, 0);
+            xQueueSendToBack(pxTaskParameter->tx_queue, (void*)&replayDone, portMAX_DELAY);
+        }
+        
+        if(!replaying)
+        {
+            xSemaphoreTake(rx_semaphore, portMAX_DELAY);
+            buffer[buffer_index] = UartGetChar();
+            RecordChar(buffer[buffer_index], buffer_index == 0);
+        }
         
-        // Grab the currently being typed command
-        buffer[buffer_index] = UartGetChar();
         typedChar[0] = buffer[buffer_index];
         
         // If its command, process it
@@ -177,7 +258,10 @@ void taskUARTRx(void *pvParameters)
             {
                 moreData = FreeRTOS_CLIProcessCommand(buffer, message, TX_SIZE - 1);
                 message[TX_SIZE - 1] = '\0';
-                xQueueSendToBack(pxTaskParameter->tx_queue, (void*)&message, 0);
+                
+                // Long outputs (help, TR) are more lines than the queue holds,
+                // so wait for the TX task to make room rather than drop them
+                xQueueSendToBack(pxTaskParameter->tx_queue, (void*)&message, portMAX_DELAY);
             } while(moreData != pdFALSE);
             
             buffer_index = 0;
@@ -229,6 +313,8 @@ void vUART1_ISR(void)
 {
     portBASE_TYPE xHigherPriorityTaskWoken;
     
+    TraceRecord(TRACE_ISR_ENTER, TRACE_ISR_UART1, 0);
+    
     if(INTGetFlag(INT_U1TX))
     {
         if(tx_buffer[tx_index] == '\0')
@@ -253,5 +339,7 @@ void vUART1_ISR(void)
         xSemaphoreGiveFromISR(rx_semaphore, &xHigherPriorityTaskWoken);
     }
     
+    TraceRecord(TRACE_ISR_EXIT, TRACE_ISR_UART1, 0);
+    
     portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
 }
\ No newline at end of file
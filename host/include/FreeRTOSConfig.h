@@ -0,0 +1,49 @@
+/*
+    FreeRTOS configuration for the host build.
+
+    The firmware's own configuration is used as it is, apart from the few
+    settings below that the virtual time port (see
+    FreeRTOS/Source/portable/GCC/Posix_Sim/port.c) needs changed.
+*/
+
+#ifndef HOST_FREERTOS_CONFIG_H
+#define HOST_FREERTOS_CONFIG_H
+
+#include "../../elevator.X/include/FreeRTOSConfig.h"
+
+/* The tickless test (see the Makefile) builds the sim both with the
+firmware's tickless idle and without it. */
+#ifdef HOST_TICKLESS_IDLE
+	#undef configUSE_TICKLESS_IDLE
+	#define configUSE_TICKLESS_IDLE             HOST_TICKLESS_IDLE
+#endif
+
+/* There is no ISR stack to check, interrupts run on the stack of the task
+that was running last. */
+#undef configCHECK_FOR_STACK_OVERFLOW
+#define configCHECK_FOR_STACK_OVERFLOW          2
+
+/* The heap's block headers are twice the size with 64-bit pointers. */
+#undef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 64 )
+
+/* The timing wheel benchmark (see test/wheel_bench.c) builds the kernel both
+with and without the wheel. */
+#ifdef HOST_DELAY_TIMING_WHEEL
+	#undef configUSE_DELAY_TIMING_WHEEL
+	#define configUSE_DELAY_TIMING_WHEEL        HOST_DELAY_TIMING_WHEEL
+#endif
+
+/* Room in perfstats.c's histograms for waits up to about 8.5 minutes, the
+board's 64 seconds are too short for a busy hour. */
+#define PERF_BUCKETS                            1024
+
+/* bench.c times the kernel in nanoseconds of the host's clock. A tick of
+virtual time takes none of it, so vTaskDelay(1) costs only what the kernel
+does. */
+#define BENCH_COUNTER()                         SimBenchCounter()
+#define BENCH_CYCLES_PER_COUNT                  1
+#define BENCH_COUNTS_PER_TICK                   0
+#define BENCH_UNIT                              "ns"
+
+#endif /* HOST_FREERTOS_CONFIG_H */
@@ -0,0 +1,121 @@
+/**
+ * Stands in for the PIC32 peripheral library on the host build.
+ *
+ * Only the calls the firmware makes are here. GPIO ports and UART1 are
+ * simulated by sim.c, everything to do with clocks and interrupt priorities
+ * does nothing.
+ */
+#ifndef PLIB_H
+#define	PLIB_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sim.h"
+
+#define BIT_0  (1U << 0)
+#define BIT_1  (1U << 1)
+#define BIT_2  (1U << 2)
+#define BIT_3  (1U << 3)
+#define BIT_4  (1U << 4)
+#define BIT_5  (1U << 5)
+#define BIT_6  (1U << 6)
+#define BIT_7  (1U << 7)
+#define BIT_8  (1U << 8)
+#define BIT_9  (1U << 9)
+#define BIT_10 (1U << 10)
+#define BIT_11 (1U << 11)
+#define BIT_12 (1U << 12)
+#define BIT_13 (1U << 13)
+#define BIT_14 (1U << 14)
+#define BIT_15 (1U << 15)
+
+// GPIO
+#define mPORTBSetBits(bits) SimPortWrite(SIM_PORT_B, (bits), 0, 0)
+#define mPORTBClearBits(bits) SimPortWrite(SIM_PORT_B, 0, (bits), 0)
+#define mPORTBToggleBits(bits) SimPortWrite(SIM_PORT_B, 0, 0, (bits))
+#define mPORTBReadBits(bits) (SimPortRead(SIM_PORT_B) & (bits))
+#define mPORTBSetPinsDigitalOut(bits) SimPortDirection(SIM_PORT_B, (bits), 0)
+#define mPORTBSetPinsDigitalIn(bits) SimPortDirection(SIM_PORT_B, 0, (bits))
+
+#define mPORTCSetBits(bits) SimPortWrite(SIM_PORT_C, (bits), 0, 0)
+#define mPORTCClearBits(bits) SimPortWrite(SIM_PORT_C, 0, (bits), 0)
+#define mPORTCToggleBits(bits) SimPortWrite(SIM_PORT_C, 0, 0, (bits))
+#define mPORTCReadBits(bits) (SimPortRead(SIM_PORT_C) & (bits))
+#define mPORTCSetPinsDigitalOut(bits) SimPortDirection(SIM_PORT_C, (bits), 0)
+#define mPORTCSetPinsDigitalIn(bits) SimPortDirection(SIM_PORT_C, 0, (bits))
+
+#define mPORTDSetBits(bits) SimPortWrite(SIM_PORT_D, (bits), 0, 0)
+#define mPORTDClearBits(bits) SimPortWrite(SIM_PORT_D, 0, (bits), 0)
+#define mPORTDToggleBits(bits) SimPortWrite(SIM_PORT_D, 0, 0, (bits))
+#define mPORTDReadBits(bits) (SimPortRead(SIM_PORT_D) & (bits))
+#define mPORTDSetPinsDigitalOut(bits) SimPortDirection(SIM_PORT_D, (bits), 0)
+#define mPORTDSetPinsDigitalIn(bits) SimPortDirection(SIM_PORT_D, 0, (bits))
+
+#define mPORTFSetBits(bits) SimPortWrite(SIM_PORT_F, (bits), 0, 0)
+#define mPORTFClearBits(bits) SimPortWrite(SIM_PORT_F, 0, (bits), 0)
+#define mPORTFToggleBits(bits) SimPortWrite(SIM_PORT_F, 0, 0, (bits))
+#define mPORTFReadBits(bits) (SimPortRead(SIM_PORT_F) & (bits))
+#define mPORTFSetPinsDigitalOut(bits) SimPortDirection(SIM_PORT_F, (bits), 0)
+#define mPORTFSetPinsDigitalIn(bits) SimPortDirection(SIM_PORT_F, 0, (bits))
+
+// The switches have pull-ups in the simulation whether they're asked for
+#define CN15_PULLUP_ENABLE (1U << 15)
+#define CN16_PULLUP_ENABLE (1U << 16)
+#define CN19_PULLUP_ENABLE (1U << 19)
+#define ConfigCNPullups(config) ((void)(config))
+
+// Clocks
+#define OSC_PB_DIV_2 2
+#define SYSTEMConfigPerformance(hz) ((void)(hz))
+#define mOSCSetPBDIV(div) ((void)(div))
+
+// Interrupts
+typedef enum {
+    INT_U1TX = SIM_INT_U1TX,
+    INT_U1RX = SIM_INT_U1RX
+} INT_SOURCE;
+
+#define INT_DISABLED 0
+#define INT_ENABLED 1
+#define INT_UART_1_VECTOR 24
+#define INT_PRIORITY_LEVEL_1 1
+
+#define INTEnableSystemMultiVectoredInt() ((void)0)
+#define INTSetVectorPriority(vector, priority) ((void)(vector), (void)(priority))
+#define INTEnable(source, enable) SimIntEnable((source), (enable))
+#define INTGetFlag(source) SimIntGetFlag(source)
+#define INTClearFlag(source) SimIntClearFlag(source)
+
+// UART, only UART1 is simulated
+typedef enum {
+    UART1,
+    UART2
+} UART_MODULE;
+
+#define UART_PERIPHERAL 0x01
+#define UART_RX 0x02
+#define UART_TX 0x04
+#define UART_ENABLE_FLAGS(flags) (flags)
+#define UART_INTERRUPT_ON_RX_NOT_EMPTY 0x01
+#define UART_INTERRUPT_ON_TX_DONE 0x02
+
+#define UARTSetDataRate(module, clock, baud) SimUartSetBaud(baud)
+#define UARTEnable(module, flags) ((void)(module), (void)(flags))
+#define UARTSetFifoMode(module, mode) ((void)(module), (void)(mode))
+#define UARTSendDataByte(module, byte) SimUartSend(byte)
+#define UARTGetDataByte(module) SimUartReceive()
+#define UARTTransmitterIsReady(module) SimUartTxReady()
+
+// Resets. What the firmware keeps in persistent RAM goes in a section of its
+// own, which SimSoftReset() carries over into the next boot.
+#define SoftReset() SimSoftReset()
+#define persistent section("persistent")
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PLIB_H */
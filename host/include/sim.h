@@ -0,0 +1,80 @@
+#ifndef SIM_H
+#define	SIM_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// GPIO ports the firmware uses
+enum SIM_PORT {
+    SIM_PORT_B,
+    SIM_PORT_C,
+    SIM_PORT_D,
+    SIM_PORT_F,
+    SIM_NUM_PORTS
+};
+
+// Interrupt sources the firmware uses
+enum SIM_INT {
+    SIM_INT_U1TX,
+    SIM_INT_U1RX,
+    SIM_NUM_INTS
+};
+
+// The car's five switches, SW1 to SW5
+#define SIM_NUM_SWITCHES 5
+
+// Set up the simulated hardware. Output is where the UART's TX bytes go.
+void SimInit(FILE *output, bool virtualTimer);
+
+// GPIO, for plib.h
+void SimPortWrite(enum SIM_PORT port, uint32_t set, uint32_t clear, uint32_t toggle);
+uint32_t SimPortRead(enum SIM_PORT port);
+void SimPortDirection(enum SIM_PORT port, uint32_t outputs, uint32_t inputs);
+
+// Interrupt flags, for plib.h
+void SimIntEnable(int source, int enable);
+int SimIntGetFlag(int source);
+void SimIntClearFlag(int source);
+
+// UART1, for plib.h
+void SimUartSetBaud(uint32_t baud);
+void SimUartSend(uint8_t byte);
+uint8_t SimUartReceive(void);
+bool SimUartTxReady(void);
+
+// Core timer and interrupt masking, for xc.h
+uint32_t SimCoreTimer(void);
+unsigned int SimDisableInterrupts(void);
+void SimRestoreInterrupts(unsigned int status);
+
+// The host's clock in nanoseconds, for bench.c
+uint32_t SimBenchCounter(void);
+
+// SoftReset() boots the firmware again, by running the sim again with the
+// same command line and -R with a file holding the persistent RAM
+void SimSetCommandLine(int argc, char **argv);
+void SimSoftReset(void) __attribute__((noreturn));
+bool SimLoadReset(const char *path, uint64_t *bootUs);
+
+// Inputs, at a time in microseconds of virtual time
+void SimUartInput(uint64_t us, uint8_t byte);
+void SimSwitch(uint64_t us, int sw, bool pressed);
+void SimEmergencyStopIsr(uint64_t us);
+void SimEnd(uint64_t us);
+
+// Microseconds the UART takes to send or receive a byte
+uint32_t SimUartByteTime(void);
+
+// Read a script of inputs (see scenario.c), from the time this boot started
+bool ScenarioLoad(const char *path, uint64_t bootUs);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SIM_H */
@@ -0,0 +1,30 @@
+/**
+ * Stands in for the XC32 device header on the host build.
+ *
+ * The core timer counts at half the PIC32's 80 MHz clock, like the real one,
+ * but follows the host's clock (or virtual time, see SimCoreTimer()). Masking
+ * interrupts masks the simulated ones.
+ */
+#ifndef XC_H
+#define	XC_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "sim.h"
+
+#define _CP0_GET_COUNT() SimCoreTimer()
+
+#define __builtin_disable_interrupts() SimDisableInterrupts()
+#define _CP0_SET_STATUS(status) SimRestoreInterrupts(status)
+
+// Interrupt handlers are plain functions the simulation calls, so the vector
+// attributes on their assembly wrappers mean nothing here
+#define interrupt(ipl) unused
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* XC_H */
@@ -0,0 +1,148 @@
+/**
+ * Runs the elevator firmware on a host, in virtual time.
+ *
+ *     elevator-sim [-o <file>] [-v] [-i] <script>
+ *
+ * The firmware's tasks are created just as on the board (see app.c) and fed
+ * the inputs in the script (see scenario.c). Everything the UART sends goes
+ * to stdout, or the file given with -o. With -v the core timer runs in
+ * virtual time too, so even the timings the firmware reports come out the
+ * same every run. With -i the sim prints to stderr at the end how many ticks
+ * went by with every task blocked and none woken, run or suppressed by
+ * tickless idle, and how many tickless idle suppressed.
+ *
+ * When the firmware resets (the JP command does, to replay its journal) the
+ * sim runs itself again with -R <file>, see SimSoftReset(). The new boot adds
+ * its output to the old one's and takes the rest of the script.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <plib.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "sim.h"
+#include "app.h"
+#include "leddrv.h"
+#include "uartdrv.h"
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: elevator-sim [-o <file>] [-v] [-i] <script>\n");
+    exit(2);
+}
+
+/**
+ * The same setup as on the board, less the clocks
+ */
+static void SetupHardware(void)
+{
+    initializeLedDriver();
+    InitUART(UART1, 9600);
+
+    // Motor pin
+    mPORTFClearBits(BIT_8);
+    mPORTFSetPinsDigitalOut(BIT_8);
+
+    // UP/DN LEDs
+    mPORTBClearBits(BIT_4 | BIT_5);
+    mPORTBSetPinsDigitalOut(BIT_4 | BIT_5);
+
+    // Switches
+    mPORTDSetPinsDigitalIn(BIT_6 | BIT_7 | BIT_13);
+    mPORTCSetPinsDigitalIn(BIT_1 | BIT_2);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *output = stdout;
+    const char *outputPath = NULL, *resetImage = NULL;
+    bool virtualTimer = false, idleTicks = false;
+    uint64_t bootUs = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:viR:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o':
+                outputPath = optarg;
+                break;
+            case 'v':
+                virtualTimer = true;
+                break;
+            case 'i':
+                idleTicks = true;
+                break;
+            case 'R':
+                resetImage = optarg;
+                break;
+            default:
+                Usage();
+        }
+    }
+
+    if(optind != argc - 1)
+        Usage();
+
+    // After a reset, carry on where the boot before left off
+    if(resetImage != NULL && !SimLoadReset(resetImage, &bootUs))
+        return 1;
+
+    if(outputPath != NULL)
+    {
+        output = fopen(outputPath, resetImage != NULL ? "a" : "w");
+        if(output == NULL)
+        {
+            perror(outputPath);
+            return 1;
+        }
+    }
+
+    SimInit(output, virtualTimer);
+    SimSetCommandLine(argc, argv);
+    SetupHardware();
+    InitApp();
+
+    if(!ScenarioLoad(argv[optind], bootUs))
+        return 1;
+
+    // Returns when the script ends the run
+    vTaskStartScheduler();
+
+    if(idleTicks)
+    {
+#if configUSE_TICKLESS_IDLE == 1
+        uint32_t sleeps, suppressed;
+
+        vPortGetTicklessStats(&sleeps, &suppressed);
+        fprintf(stderr, "ticks=%lu idle_ticks=%lu sleeps=%lu suppressed=%lu\n",
+                (unsigned long)xTaskGetTickCount(), (unsigned long)ulPortGetIdleTicks(),
+                (unsigned long)sleeps, (unsigned long)suppressed);
+#else
+        fprintf(stderr, "ticks=%lu idle_ticks=%lu\n", (unsigned long)xTaskGetTickCount(),
+                (unsigned long)ulPortGetIdleTicks());
+#endif
+    }
+
+    fflush(output);
+    return 0;
+}
+
+void vApplicationMallocFailedHook(void)
+{
+    fprintf(stderr, "sim: pvPortMalloc() failed\n");
+    abort();
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+    fprintf(stderr, "sim: stack overflow in %s\n", pcTaskName);
+    abort();
+}
+
+void vAssertCalled(const char *pcFile, unsigned long ulLine)
+{
+    fprintf(stderr, "sim: assertion failed at %s:%lu\n", pcFile, ulLine);
+    abort();
+}
@@ -0,0 +1,205 @@
+/**
+ * Input scripts for the host build.
+ *
+ * A script lists the inputs of a run, one per line, each at a time since the
+ * scheduler started:
+ *
+ *     <time> type <text>       Type a CLI command line, then enter
+ *     <time> key <c>           Type one character, like a z/x/c/v key command
+ *     <time> press <n> [<ms>]  Hold switch SWn down, 120 ms unless given
+ *     <time> estop-isr         Emergency stop from an interrupt
+ *     <time> end               Stop the run
+ *
+ * A time is a number of milliseconds, or of seconds, minutes or hours with an
+ * s, m or h after it. A + in front makes it relative to the line before.
+ * Typed characters arrive one UART byte time apart. Blank lines and lines
+ * starting with # are skipped.
+ *
+ * After the firmware resets, the board boots again at time zero (see
+ * SimSoftReset()) and gets what the script does from the time of the reset
+ * on, so a script's times stay those of the first boot.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sim.h"
+
+// Longest line a script can have
+#define MAX_LINE 256
+
+// Long enough for the 100 ms button poll and the 15 ms debounce to see one
+// press, not so long that the next poll sees another
+#define DEFAULT_PRESS_MS 120
+
+// When this boot started, in the time of the script
+static uint64_t boot_us;
+
+/**
+ * Queue up an input at a time of the script, unless it was before this boot
+ */
+static void UartInput(uint64_t us, uint8_t byte)
+{
+    if(us >= boot_us)
+        SimUartInput(us - boot_us, byte);
+}
+
+static void Switch(uint64_t us, int sw, bool pressed)
+{
+    if(us >= boot_us)
+        SimSwitch(us - boot_us, sw, pressed);
+}
+
+static void EmergencyStopIsr(uint64_t us)
+{
+    if(us >= boot_us)
+        SimEmergencyStopIsr(us - boot_us);
+}
+
+static void End(uint64_t us)
+{
+    if(us >= boot_us)
+        SimEnd(us - boot_us);
+}
+
+/**
+ * Read a time
+ *
+ * @param text The time, as described above
+ * @param last The time of the line before, for a relative time
+ * @param us Filled in with the time in microseconds
+ *
+ * @return False if it isn't a time
+ */
+static bool ParseTime(const char *text, uint64_t last, uint64_t *us)
+{
+    bool relative = false;
+    char *end;
+    double value;
+
+    if(*text == '+')
+    {
+        relative = true;
+        text++;
+    }
+
+    value = strtod(text, &end);
+    if(end == text || value < 0)
+        return false;
+
+    if(strcmp(end, "h") == 0)
+        value *= 3600000.0;
+    else if(strcmp(end, "m") == 0)
+        value *= 60000.0;
+    else if(strcmp(end, "s") == 0)
+        value *= 1000.0;
+    else if(strcmp(end, "ms") != 0 && *end != '\0')
+        return false;
+
+    *us = (uint64_t)(value * 1000.0 + 0.5) + (relative ? last : 0);
+    return true;
+}
+
+/**
+ * Queue up the inputs for one line of a script
+ *
+ * @param line The line, without its newline
+ * @param last The time of the line before, updated to this line's
+ *
+ * @return False if the line doesn't make sense
+ */
+static bool ParseLine(char *line, uint64_t *last)
+{
+    char *when, *action, *arg;
+    uint64_t us;
+    size_t i;
+    int sw, ms;
+
+    when = strtok(line, " \t");
+    if(when == NULL || *when == '#')
+        return true;
+
+    action = strtok(NULL, " \t");
+    arg = strtok(NULL, "");
+    if(action == NULL || !ParseTime(when, *last, &us))
+        return false;
+
+    *last = us;
+
+    if(strcmp(action, "type") == 0)
+    {
+        if(arg == NULL)
+            arg = "";
+        for(i = 0; arg[i] != '\0'; i++)
+            UartInput(us + i * SimUartByteTime(), (uint8_t)arg[i]);
+        UartInput(us + i * SimUartByteTime(), '\r');
+    }
+    else if(strcmp(action, "key") == 0)
+    {
+        if(arg == NULL || strlen(arg) != 1)
+            return false;
+        UartInput(us, (uint8_t)arg[0]);
+    }
+    else if(strcmp(action, "press") == 0)
+    {
+        ms = DEFAULT_PRESS_MS;
+        if(arg == NULL || sscanf(arg, "%d %d", &sw, &ms) < 1 ||
+           sw < 1 || sw > SIM_NUM_SWITCHES || ms <= 0)
+            return false;
+        Switch(us, sw, true);
+        Switch(us + (uint64_t)ms * 1000, sw, false);
+    }
+    else if(strcmp(action, "estop-isr") == 0)
+        EmergencyStopIsr(us);
+    else if(strcmp(action, "end") == 0)
+        End(us);
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * Queue up every input in a script
+ *
+ * @param path The script
+ * @param bootUs When this boot started in the script's time, zero unless the
+ *        firmware has reset
+ *
+ * @return False if it can't be read or has a line that doesn't make sense
+ */
+bool ScenarioLoad(const char *path, uint64_t bootUs)
+{
+    char line[MAX_LINE];
+    uint64_t last = 0;
+    int number = 0;
+    size_t len;
+    FILE *file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    boot_us = bootUs;
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        number++;
+
+        len = strlen(line);
+        while(len > 0 && isspace((unsigned char)line[len - 1]))
+            line[--len] = '\0';
+
+        if(!ParseLine(line, &last))
+        {
+            fprintf(stderr, "%s:%d: can't make sense of this line\n", path, number);
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,355 @@
+/**
+ * Simulated hardware for the host build.
+ *
+ * Stands in for the parts of the PIC32 starter kit the firmware touches: the
+ * GPIO ports with the switches and LEDs on them, UART1 with its interrupt,
+ * and the core timer. Inputs are simulated interrupts in the virtual time
+ * port (see FreeRTOS/Source/portable/GCC/Posix_Sim/port.c), so a switch held
+ * down for 120 ms is seen by exactly the polls that would have seen it on the
+ * board. What the UART sends is written out byte by byte as it's sent, at the
+ * baud rate's pace.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "sim.h"
+#include "physics.h"
+
+// Core timer counts a microsecond, at half the 80 MHz CPU clock
+#define CORE_TIMER_PER_US 40
+
+// Bits in a UART frame: start, 8 data and stop
+#define UART_FRAME_BITS 10
+
+// Where each switch is, SW1 to SW5
+static const struct {
+    enum SIM_PORT port;
+    uint32_t bit;
+} switches[SIM_NUM_SWITCHES] = {
+    { SIM_PORT_D, 1U << 6 },
+    { SIM_PORT_D, 1U << 7 },
+    { SIM_PORT_D, 1U << 13 },
+    { SIM_PORT_C, 1U << 1 },
+    { SIM_PORT_C, 1U << 2 }
+};
+
+// GPIO latches, which pins are outputs, and what drives the inputs
+static uint32_t latch[SIM_NUM_PORTS];
+static uint32_t outputs[SIM_NUM_PORTS];
+static uint32_t inputs[SIM_NUM_PORTS];
+
+// Interrupt flags and enables
+static bool flags[SIM_NUM_INTS];
+static bool enabled[SIM_NUM_INTS];
+
+// UART1
+static FILE *uart_output;
+static uint32_t byte_us = 1042;
+static bool tx_busy;
+static uint8_t rx_byte;
+
+static bool virtual_timer;
+
+// RAM a reset leaves alone (see plib.h), which the linker gathers here
+extern uint8_t __start_persistent[], __stop_persistent[];
+
+// The sim's command line, to boot the firmware again with after a reset
+static int command_argc;
+static char **command_argv;
+
+// When this boot started, in the time of the script
+static uint64_t boot_us;
+
+// In uartdrv.c, the assembly wrapper isn't needed on the host
+void vUART1_ISR(void);
+
+/**
+ * Set up the simulated hardware, before the firmware does
+ *
+ * @param output Where the UART's TX bytes go
+ * @param virtualTimer Run the core timer in virtual time rather than the
+ *        host's time, so every timing the firmware takes comes out the same
+ */
+void SimInit(FILE *output, bool virtualTimer)
+{
+    int port;
+
+    for(port = 0; port < SIM_NUM_PORTS; port++)
+    {
+        latch[port] = 0;
+        outputs[port] = 0;
+        // Pulled up
+        inputs[port] = UINT32_MAX;
+    }
+
+    uart_output = output;
+    virtual_timer = virtualTimer;
+}
+
+void SimPortWrite(enum SIM_PORT port, uint32_t set, uint32_t clear, uint32_t toggle)
+{
+    latch[port] = ((latch[port] | set) & ~clear) ^ toggle;
+}
+
+uint32_t SimPortRead(enum SIM_PORT port)
+{
+    return (latch[port] & outputs[port]) | (inputs[port] & ~outputs[port]);
+}
+
+void SimPortDirection(enum SIM_PORT port, uint32_t out, uint32_t in)
+{
+    outputs[port] = (outputs[port] | out) & ~in;
+}
+
+/**
+ * Run the UART's interrupt for as long as it has an enabled flag set, it only
+ * handles one flag per call. Runs in interrupt context.
+ */
+static void ServiceUart(void *unused)
+{
+    (void)unused;
+
+    while((flags[SIM_INT_U1TX] && enabled[SIM_INT_U1TX]) ||
+          (flags[SIM_INT_U1RX] && enabled[SIM_INT_U1RX]))
+        vUART1_ISR();
+}
+
+void SimIntEnable(int source, int enable)
+{
+    enabled[source] = (enable != 0);
+
+    // Enabling an interrupt whose flag is already set takes it straight away
+    if(enabled[source] && flags[source])
+        vPortSimulateInterrupt(ullPortGetSimTime(), ServiceUart, NULL);
+}
+
+int SimIntGetFlag(int source)
+{
+    return flags[source];
+}
+
+void SimIntClearFlag(int source)
+{
+    flags[source] = false;
+}
+
+void SimUartSetBaud(uint32_t baud)
+{
+    byte_us = (UART_FRAME_BITS * 1000000UL + baud / 2) / baud;
+}
+
+uint32_t SimUartByteTime(void)
+{
+    return byte_us;
+}
+
+/**
+ * The byte being sent has gone, raise the TX interrupt
+ */
+static void TxDone(void *unused)
+{
+    tx_busy = false;
+    flags[SIM_INT_U1TX] = true;
+    ServiceUart(NULL);
+}
+
+void SimUartSend(uint8_t byte)
+{
+    fputc(byte, uart_output);
+    tx_busy = true;
+    vPortSimulateInterrupt(ullPortGetSimTime() + byte_us, TxDone, NULL);
+}
+
+uint8_t SimUartReceive(void)
+{
+    return rx_byte;
+}
+
+bool SimUartTxReady(void)
+{
+    return !tx_busy;
+}
+
+uint32_t SimCoreTimer(void)
+{
+    struct timespec now;
+
+    if(virtual_timer)
+        return (uint32_t)(ullPortGetSimTime() * CORE_TIMER_PER_US);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL * CORE_TIMER_PER_US / 1000 +
+                      (uint64_t)now.tv_nsec * CORE_TIMER_PER_US / 1000);
+}
+
+uint32_t SimBenchCounter(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+unsigned int SimDisableInterrupts(void)
+{
+    return (unsigned int)uxPortSetInterruptMaskFromISR();
+}
+
+void SimRestoreInterrupts(unsigned int status)
+{
+    vPortClearInterruptMaskFromISR(status);
+}
+
+/**
+ * Note the sim's command line, which SimSoftReset() runs again
+ */
+void SimSetCommandLine(int argc, char **argv)
+{
+    command_argc = argc;
+    command_argv = argv;
+}
+
+/**
+ * Reset the board: save the persistent RAM and the time to a file, then run
+ * the sim again from the start with -R and the file, in place of this one.
+ * Everything else the firmware had is lost, as on the board.
+ */
+void SimSoftReset(void)
+{
+    char path[] = "/tmp/elevator-sim-XXXXXX";
+    size_t size = __stop_persistent - __start_persistent;
+    uint64_t reset_us = boot_us + ullPortGetSimTime();
+    char **argv;
+    FILE *image;
+    int fd, i, n = 0;
+
+    fflush(uart_output);
+    fprintf(stderr, "sim: reset at %llu ms, booting again\n",
+            (unsigned long long)(reset_us / 1000));
+
+    fd = mkstemp(path);
+    image = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if(image == NULL || fwrite(&reset_us, sizeof(reset_us), 1, image) != 1 ||
+       fwrite(__start_persistent, 1, size, image) != size || fclose(image) != 0)
+    {
+        perror("sim: saving the persistent RAM");
+        exit(1);
+    }
+
+    // The same options, less the -R from the boot before, then the script
+    argv = malloc((command_argc + 3) * sizeof(argv[0]));
+    if(argv == NULL)
+        exit(1);
+    for(i = 0; i < command_argc - 1; i++)
+    {
+        if(strcmp(command_argv[i], "-R") == 0)
+            i++;
+        else
+            argv[n++] = command_argv[i];
+    }
+    argv[n++] = "-R";
+    argv[n++] = path;
+    argv[n++] = command_argv[command_argc - 1];
+    argv[n] = NULL;
+
+    execv("/proc/self/exe", argv);
+    perror("sim: booting again");
+    exit(1);
+}
+
+/**
+ * Boot from a reset: put back the persistent RAM SimSoftReset() saved, before
+ * the firmware starts. Deletes the file.
+ *
+ * @param path The file
+ * @param bootUs Filled in with the time of the reset, in the script's time
+ *
+ * @return False if the file can't be read
+ */
+bool SimLoadReset(const char *path, uint64_t *bootUs)
+{
+    size_t size = __stop_persistent - __start_persistent;
+    FILE *image = fopen(path, "rb");
+    bool ok;
+
+    if(image == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    ok = fread(&boot_us, sizeof(boot_us), 1, image) == 1 &&
+         fread(__start_persistent, 1, size, image) == size;
+    fclose(image);
+    unlink(path);
+
+    if(!ok)
+        fprintf(stderr, "%s: not a reset image\n", path);
+
+    *bootUs = boot_us;
+    return ok;
+}
+
+/**
+ * A byte has come in, raise the RX interrupt
+ */
+static void RxByte(void *byte)
+{
+    rx_byte = (uint8_t)(uintptr_t)byte;
+    flags[SIM_INT_U1RX] = true;
+    ServiceUart(NULL);
+}
+
+void SimUartInput(uint64_t us, uint8_t byte)
+{
+    vPortSimulateInterrupt(us, RxByte, (void *)(uintptr_t)byte);
+}
+
+/**
+ * Press or let go of a switch. The switches pull their pin low.
+ */
+static void Switch(void *arg)
+{
+    uintptr_t sw = (uintptr_t)arg >> 1;
+
+    if((uintptr_t)arg & 1)
+        inputs[switches[sw].port] &= ~switches[sw].bit;
+    else
+        inputs[switches[sw].port] |= switches[sw].bit;
+}
+
+/**
+ * @param us When
+ * @param sw The switch, 1 to 5 for SW1 to SW5
+ * @param pressed True to press it, false to let go
+ */
+void SimSwitch(uint64_t us, int sw, bool pressed)
+{
+    vPortSimulateInterrupt(us, Switch, (void *)(((uintptr_t)(sw - 1) << 1) | pressed));
+}
+
+static void EmergencyStop(void *unused)
+{
+    BaseType_t woken = pdFALSE;
+
+    SetEmergStopEnableFromISR(&woken);
+    portEND_SWITCHING_ISR(woken);
+}
+
+void SimEmergencyStopIsr(uint64_t us)
+{
+    vPortSimulateInterrupt(us, EmergencyStop, NULL);
+}
+
+static void End(void *unused)
+{
+    vTaskEndScheduler();
+}
+
+void SimEnd(uint64_t us)
+{
+    vPortSimulateInterrupt(us, End, NULL);
+}
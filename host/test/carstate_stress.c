@@ -0,0 +1,161 @@
+/**
+ * Stress test for the car state snapshot (carstate.c), on POSIX threads.
+ *
+ * A writer thread publishes segment after segment as fast as it can, and
+ * flips the moving and stopped flags every so often, while reader threads
+ * take snapshots. Every segment it publishes has the same number for its
+ * location, its speed and the destination, so a snapshot that doesn't is
+ * torn: part of it came from one write and part from another. A snapshot
+ * with both or neither of moving and stopped set is torn too.
+ *
+ *     carstate-stress [-y] [-e] [writes]
+ *
+ * With -y the readers yield in the middle of every copy and the writer after
+ * every write, which on a host with one core is the only time a write can land
+ * inside a read. With -e the test
+ * passes only if it does see torn snapshots, for the copy of carstate.c built
+ * without the retry.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "carstate.h"
+
+#define NUM_READERS 2
+#define DEFAULT_WRITES 200000
+
+// Segment numbers stay well inside a float's 24 bit mantissa
+#define NUMBER_MASK 0xfffff
+
+// The writer flips the flags this often
+#define FLAG_EVERY 16
+
+static bool force_yield;
+static long writes = DEFAULT_WRITES;
+static atomic_bool writer_done;
+
+struct Reader {
+    pthread_t thread;
+    long reads;
+    long torn;
+};
+
+void vStubCarStateReadHook(void)
+{
+    if(force_yield)
+        sched_yield();
+}
+
+static void *Write(void *unused)
+{
+    struct CarSegment segment;
+    long i;
+    int number, yields;
+
+    for(i = 1; i <= writes; i++)
+    {
+        number = i & NUMBER_MASK;
+
+        // A still segment, so the snapshot is its end whatever the tick
+        segment.start = segment.end = 0;
+        segment.location = segment.speed = 0.0f;
+        segment.end_location = segment.end_speed = (float)number;
+        CarStateSetSegment(&segment, number);
+
+        if(i % FLAG_EVERY == 0)
+            CarStateSetFlags((i / FLAG_EVERY) & 1 ? STATE_MOVING : STATE_STOPPED);
+
+        // Let the readers in between writes, and every other time let them
+        // finish a copy before the next write
+        if(force_yield)
+            for(yields = 0; yields < 1 + i % 2; yields++)
+                sched_yield();
+    }
+
+    atomic_store(&writer_done, true);
+    return NULL;
+}
+
+static void *Read(void *arg)
+{
+    struct Reader *reader = arg;
+    struct CarState state;
+    EventBits_t motion;
+
+    while(!atomic_load(&writer_done))
+    {
+        CarStateGet(&state);
+        reader->reads++;
+
+        motion = state.flags & (STATE_MOVING | STATE_STOPPED);
+        if(state.location != (float)state.dest || state.speed != (float)state.dest ||
+           (motion != STATE_MOVING && motion != STATE_STOPPED))
+        {
+            if(reader->torn < 5)
+                printf("  torn: location %.0f speed %.0f dest %d flags 0x%02lx\n",
+                       state.location, state.speed, state.dest, (unsigned long)state.flags);
+            reader->torn++;
+        }
+
+        // Don't starve the writer on a host with one core
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    struct Reader readers[NUM_READERS] = { { 0 } };
+    pthread_t writer;
+    bool expect_torn = false;
+    long reads = 0, torn = 0;
+    int opt, i;
+
+    while((opt = getopt(argc, argv, "ye")) != -1)
+    {
+        switch(opt)
+        {
+            case 'y':
+                force_yield = true;
+                break;
+            case 'e':
+                expect_torn = true;
+                break;
+            default:
+                fprintf(stderr, "usage: carstate-stress [-y] [-e] [writes]\n");
+                return 2;
+        }
+    }
+    if(optind < argc)
+        writes = atol(argv[optind]);
+
+    InitCarState();
+
+    for(i = 0; i < NUM_READERS; i++)
+        pthread_create(&readers[i].thread, NULL, Read, &readers[i]);
+    pthread_create(&writer, NULL, Write, NULL);
+
+    pthread_join(writer, NULL);
+    for(i = 0; i < NUM_READERS; i++)
+    {
+        pthread_join(readers[i].thread, NULL);
+        reads += readers[i].reads;
+        torn += readers[i].torn;
+    }
+
+    printf("writes=%ld reads=%ld torn=%ld%s\n", writes, reads, torn,
+           force_yield ? " forced-yield" : "");
+
+    if(expect_torn ? torn == 0 : torn != 0)
+    {
+        printf("FAIL carstate%s\n", expect_torn ? ", no torn reads without the retry" : "");
+        return 1;
+    }
+
+    printf("PASS carstate%s\n", expect_torn ? ", torn reads without the retry" : "");
+    return 0;
+}
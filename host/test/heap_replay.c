@@ -0,0 +1,319 @@
+/**
+ * Replays a seeded trace of allocations and frees against one of the kernel's
+ * heaps (heap_tlsf.c, heap_2.c or heap_4.c, one per build, see the Makefile).
+ *
+ *     heap-replay-<heap> [-n ops] [-s seed]
+ *
+ * The trace keeps up to NUM_SLOTS blocks live. Each step picks a slot at
+ * random and frees its block, or allocates one if it's empty, mostly small
+ * blocks like queue and timer structures with now and then a task stack
+ * sized one. The same seed gives every heap the same trace.
+ *
+ * Every block is filled when it's allocated and checked when it's freed, so a
+ * heap that hands out overlapping blocks fails. At the end it prints one line:
+ * how many allocations failed, and how many of those failed although the heap
+ * had at least that many bytes free in total (fragmentation); the average,
+ * p99 and worst time taken by pvPortMalloc() and vPortFree(), in nanoseconds
+ * of the host's clock and including the stand-in scheduler lock; and, once
+ * every block is freed again, the largest block the heap can still give out.
+ * The trace is replayed RUNS times and each step's time is the fastest of
+ * them, so the worst time is the heap's and not the host's. The first
+ * allocation, which sets the heap up, is timed on its own.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "FreeRTOS.h"
+
+#define NUM_SLOTS 64
+#define DEFAULT_OPS 1000000
+#define DEFAULT_SEED 1
+
+// Times are the fastest of this many replays
+#define RUNS 5
+
+struct Slot {
+    uint8_t *block;
+    size_t size;
+};
+
+// What a replay counted
+struct Result {
+    long mallocs;
+    long failed;
+    long failed_with_room;
+    size_t free_after;
+    size_t largest_after;
+};
+
+static struct Slot slots[NUM_SLOTS];
+static uint64_t state;
+
+/**
+ * xorshift64*, so the trace doesn't depend on the C library
+ */
+static uint32_t Random(void)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint32_t)((state * 2685821657736338717ULL) >> 32);
+}
+
+/**
+ * @return The size of the next block the trace allocates
+ */
+static size_t NextSize(void)
+{
+    uint32_t kind = Random() % 100;
+
+    if(kind < 70)
+        return 16 + Random() % 113;         // Queues, timers, small buffers
+    if(kind < 95)
+        return 256 + Random() % 769;        // Larger buffers
+    return 2048 + Random() % 3953;          // Task stacks
+}
+
+static uint64_t Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int CompareTimes(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Print the average, p99 and worst of some times. Sorts them.
+ */
+static void PrintTimes(const char *name, uint32_t *times, long count)
+{
+    uint64_t total = 0;
+    long i;
+
+    if(count == 0)
+    {
+        printf(" %s_avg_ns=0 %s_p99_ns=0 %s_max_ns=0", name, name, name);
+        return;
+    }
+
+    for(i = 0; i < count; i++)
+        total += times[i];
+
+    qsort(times, count, sizeof(times[0]), CompareTimes);
+    printf(" %s_avg_ns=%llu %s_p99_ns=%u %s_max_ns=%u", name,
+           (unsigned long long)(total / count), name, times[(count * 99) / 100],
+           name, times[count - 1]);
+}
+
+/**
+ * Free a slot's block, checking nothing else wrote over it
+ *
+ * @return False if something did
+ */
+static bool FreeSlot(int slot, uint32_t *time)
+{
+    uint64_t start;
+    size_t i;
+
+    for(i = 0; i < slots[slot].size; i++)
+        if(slots[slot].block[i] != (uint8_t)slot)
+            return false;
+
+    start = Now();
+    vPortFree(slots[slot].block);
+    *time = (uint32_t)(Now() - start);
+
+    slots[slot].block = NULL;
+    return true;
+}
+
+/**
+ * Replay the trace once, from a fresh heap
+ *
+ * @param ops How many steps
+ * @param times Filled in with the time each step took
+ * @param kinds Filled in with whether each step allocated
+ * @param result Filled in with the counts
+ *
+ * @return False if a block was overwritten
+ */
+static bool Replay(long ops, uint32_t *times, bool *kinds, struct Result *result)
+{
+    size_t size, free_bytes;
+    uint64_t start;
+    uint32_t unused;
+    void *probe;
+    long op;
+    int slot;
+
+    for(op = 0; op < ops; op++)
+    {
+        slot = Random() % NUM_SLOTS;
+        kinds[op] = (slots[slot].block == NULL);
+
+        if(slots[slot].block != NULL)
+        {
+            if(!FreeSlot(slot, &times[op]))
+            {
+                printf("FAIL heap=%s: block %d overwritten at op %ld\n", HEAP_NAME, slot, op);
+                return false;
+            }
+            continue;
+        }
+
+        size = NextSize();
+        free_bytes = xPortGetFreeHeapSize();
+
+        start = Now();
+        slots[slot].block = pvPortMalloc(size);
+        times[op] = (uint32_t)(Now() - start);
+        result->mallocs++;
+
+        if(slots[slot].block == NULL)
+        {
+            result->failed++;
+            if(free_bytes >= size)
+                result->failed_with_room++;
+            continue;
+        }
+
+        slots[slot].size = size;
+        memset(slots[slot].block, slot, size);
+    }
+
+    for(slot = 0; slot < NUM_SLOTS; slot++)
+    {
+        if(slots[slot].block != NULL && !FreeSlot(slot, &unused))
+        {
+            printf("FAIL heap=%s: block %d overwritten at the end\n", HEAP_NAME, slot);
+            return false;
+        }
+    }
+
+    // Counting down, as heap_2 splits a block it gives out and never joins
+    // the pieces again, so a bigger request can't succeed after a smaller one
+    result->free_after = xPortGetFreeHeapSize();
+    for(size = configTOTAL_HEAP_SIZE; size > 0; size -= portBYTE_ALIGNMENT)
+    {
+        probe = pvPortMalloc(size);
+        if(probe != NULL)
+        {
+            vPortFree(probe);
+            break;
+        }
+    }
+    result->largest_after = size;
+
+    return true;
+}
+
+/**
+ * Memory the replays share with this process
+ */
+static void *Shared(size_t size)
+{
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    return (memory == MAP_FAILED) ? NULL : memory;
+}
+
+int main(int argc, char **argv)
+{
+    long ops = DEFAULT_OPS, op, num_malloc_times = 0, num_free_times = 0;
+    uint32_t *times, *malloc_times, *free_times, best, first = 0;
+    struct Result *result;
+    uint64_t seed = DEFAULT_SEED;
+    bool *kinds;
+    int opt, run, status;
+    pid_t child;
+
+    while((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                ops = atol(optarg);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: heap-replay [-n ops] [-s seed]\n");
+                return 2;
+        }
+    }
+    // xorshift never leaves zero
+    if(seed == 0)
+        seed = DEFAULT_SEED;
+
+    times = Shared(RUNS * ops * sizeof(times[0]));
+    kinds = Shared(ops * sizeof(kinds[0]));
+    result = Shared(sizeof(*result));
+    malloc_times = malloc(ops * sizeof(malloc_times[0]));
+    free_times = malloc(ops * sizeof(free_times[0]));
+    if(times == NULL || kinds == NULL || result == NULL ||
+       malloc_times == NULL || free_times == NULL)
+        return 1;
+
+    // Each run in a child, which starts with the heap as it was never used
+    for(run = 0; run < RUNS; run++)
+    {
+        child = fork();
+        if(child == 0)
+        {
+            // Take the page faults on the heap now rather than in the replay.
+            // Without the rights to, the first steps on each page are slower.
+            mlockall(MCL_CURRENT);
+            state = seed;
+            memset(result, 0, sizeof(*result));
+            _exit(Replay(ops, &times[run * ops], kinds, result) ? 0 : 1);
+        }
+
+        if(child < 0 || waitpid(child, &status, 0) != child ||
+           !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            return 1;
+    }
+
+    // The host stops the replay now and then, but seldom on the same step
+    // every run
+    for(op = 0; op < ops; op++)
+    {
+        best = times[op];
+        for(run = 1; run < RUNS; run++)
+            if(times[run * ops + op] < best)
+                best = times[run * ops + op];
+
+        // The first allocation sets the heap up, it's reported on its own
+        if(op == 0)
+            first = best;
+        else if(kinds[op])
+            malloc_times[num_malloc_times++] = best;
+        else
+            free_times[num_free_times++] = best;
+    }
+
+    printf("heap=%s heap_bytes=%lu ops=%ld mallocs=%ld failed=%ld failed_with_room=%ld",
+           HEAP_NAME, (unsigned long)configTOTAL_HEAP_SIZE, ops, result->mallocs,
+           result->failed, result->failed_with_room);
+    printf(" first_malloc_ns=%u", first);
+    PrintTimes("malloc", malloc_times, num_malloc_times);
+    PrintTimes("free", free_times, num_free_times);
+    printf(" free_after=%lu largest_after=%lu\n", (unsigned long)result->free_after,
+           (unsigned long)result->largest_after);
+
+    free(malloc_times);
+    free(free_times);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * Stands in for FreeRTOS in the host's thread tests, see stubkernel.c.
+ *
+ * Only what the modules under test use is here. Their tasks are real threads,
+ * running at the same time on every core the host has, which is a harder test
+ * than the PIC32's one core with priorities.
+ */
+#ifndef FREERTOS_H
+#define	FREERTOS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+// A tick is a millisecond of the host's clock
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configASSERT(x) assert(x)
+
+// For the heaps in FreeRTOS/Source/portable/MemMang, as the board has them
+// apart from the size, which is what the heap replay needs
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE ((size_t)(28 * 1024))
+#endif
+#define configAPPLICATION_ALLOCATED_HEAP 0
+#define configUSE_MALLOC_FAILED_HOOK 0
+#define portBYTE_ALIGNMENT 8
+#define portBYTE_ALIGNMENT_MASK 0x0007
+#define portPOINTER_SIZE_TYPE uintptr_t
+#define traceMALLOC(pvAddress, uiSize)
+#define traceFREE(pvAddress, uiSize)
+#define mtCOVERAGE_TEST_MARKER()
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+size_t xPortGetFreeHeapSize(void);
+
+// Where carstate.c's readers can be made to yield mid copy
+void vStubCarStateReadHook(void);
+#define CARSTATE_READ_HOOK() vStubCarStateReadHook()
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FREERTOS_H */
@@ -0,0 +1,28 @@
+#ifndef SEMPHR_H
+#define	SEMPHR_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "FreeRTOS.h"
+
+// Binary semaphores only
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t given;
+    BaseType_t count;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SEMPHR_H */
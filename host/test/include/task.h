@@ -0,0 +1,40 @@
+#ifndef TASK_H
+#define	TASK_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include "FreeRTOS.h"
+
+// Critical sections and suspending the scheduler both take one lock, which
+// a thread can take again while it holds it
+#define taskENTER_CRITICAL() vStubEnterCritical()
+#define taskEXIT_CRITICAL() vStubExitCritical()
+#define vTaskSuspendAll() vStubEnterCritical()
+#define taskYIELD() vStubYield()
+
+typedef struct {
+    TickType_t xTimeOnEntering;
+} TimeOut_t;
+
+void vStubEnterCritical(void);
+void vStubExitCritical(void);
+void vStubYield(void);
+
+static inline BaseType_t xTaskResumeAll(void)
+{
+    vStubExitCritical();
+    return pdFALSE;
+}
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskSetTimeOutState(TimeOut_t *pxTimeOut);
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *pxTimeOut, TickType_t *pxTicksToWait);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TASK_H */
@@ -0,0 +1,243 @@
+/**
+ * Stress test for the priority mailbox (mailbox.c), on POSIX threads.
+ *
+ * Several sender threads per message post the door's messages as fast as they
+ * can while one receiver polls for them, on every core the host has. Every
+ * sender counts its posts as it starts each one and again once MailboxPost()
+ * has returned. A receive can only have taken the posts that had started
+ * before it returned, so for a message nothing may cancel, any post that
+ * finished before the next receive started and isn't one of those is still in
+ * the mailbox. That receive has to return it, or something more important. If it
+ * returns a less important message, or times out, the post was lost.
+ *
+ *     mailbox-stress [posts per sender]
+ *
+ * The last phase runs the table the door had before closes stopped cancelling
+ * opens, and expects the test to catch it losing opens.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "mailbox.h"
+
+// The door's messages and table, as in doordrv.c
+enum DOOR_MSG { OPEN_CLOSE_SEQ, STAY_OPEN, CLOSE, CLOSED };
+
+static const uint8_t order[] = { STAY_OPEN, CLOSE, OPEN_CLOSE_SEQ };
+static const uint32_t cancels[] = {
+    [OPEN_CLOSE_SEQ] = 0,
+    [STAY_OPEN] = MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+    [CLOSE] = 0,
+    [CLOSED] = 0
+};
+
+// Before a50efc8, a close cancelled a pending open
+static const uint32_t old_cancels[] = {
+    [OPEN_CLOSE_SEQ] = 0,
+    [STAY_OPEN] = MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+    [CLOSE] = MAILBOX_BIT(OPEN_CLOSE_SEQ),
+    [CLOSED] = 0
+};
+
+#define NUM_MSGS (sizeof(order) / sizeof(order[0]))
+#define SENDERS_PER_MSG 2
+#define DEFAULT_POSTS 10000
+
+// How long the receiver waits before deciding the mailbox is empty
+#define DRAIN_TICKS 50
+
+struct Phase {
+    const char *name;
+    const uint32_t *cancels;
+    uint32_t senders;       // MAILBOX_BIT()s of the messages sent
+    uint32_t checked;       // Of those, the ones nothing cancels
+    bool expect_loss;
+};
+
+static const struct Phase phases[] = {
+    { "all messages", cancels,
+      MAILBOX_BIT(STAY_OPEN) | MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+      MAILBOX_BIT(STAY_OPEN), false },
+    { "opens and closes", cancels,
+      MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+      MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ), false },
+    { "opens and closes, old table", old_cancels,
+      MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ),
+      MAILBOX_BIT(CLOSE) | MAILBOX_BIT(OPEN_CLOSE_SEQ), true },
+};
+
+static struct Mailbox mailbox;
+static long posts_per_sender = DEFAULT_POSTS;
+
+// Posts started and finished, per message
+static atomic_long started[NUM_MSGS + 1];
+static atomic_long posted[NUM_MSGS + 1];
+static atomic_bool senders_done;
+
+// What the receiver saw
+static long covered[NUM_MSGS + 1];     // Posts that may have come out
+static long received[NUM_MSGS + 1];
+static long losses;
+
+struct Sender {
+    pthread_t thread;
+    uint8_t msg;
+    unsigned int seed;
+};
+
+static void *Send(void *arg)
+{
+    struct Sender *sender = arg;
+    long i;
+
+    for(i = 0; i < posts_per_sender; i++)
+    {
+        atomic_fetch_add(&started[sender->msg], 1);
+        MailboxPost(&mailbox, sender->msg);
+        atomic_fetch_add(&posted[sender->msg], 1);
+
+        // Vary the interleaving
+        if(rand_r(&sender->seed) % 4 == 0)
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+/**
+ * Check a receive against the posts finished before it started
+ *
+ * @param phase The phase
+ * @param before The posts finished before the receive started
+ * @param got True if something was received
+ * @param msg What was received
+ */
+static void CheckReceive(const struct Phase *phase, const long *before, bool got, uint8_t msg)
+{
+    size_t i;
+
+    // Everything more important than what came out, or everything at all if
+    // nothing did, must already have come out
+    for(i = 0; i < NUM_MSGS; i++)
+    {
+        uint8_t m = order[i];
+
+        if(got && m == msg)
+            break;
+
+        if((phase->checked & MAILBOX_BIT(m)) && before[m] > covered[m])
+        {
+            if(!phase->expect_loss && losses < 10)
+                printf("  lost message %u: %ld posted before the receive, %ld out, got %s %u\n",
+                       m, before[m], covered[m], got ? "message" : "nothing", msg);
+            losses++;
+            // Count each loss once
+            covered[m] = before[m];
+        }
+    }
+
+    if(got)
+    {
+        received[msg]++;
+        covered[msg] = atomic_load(&started[msg]);
+    }
+}
+
+/**
+ * Run one phase
+ *
+ * @return True if it found what it expected
+ */
+static bool RunPhase(const struct Phase *phase)
+{
+    struct Sender senders[NUM_MSGS * SENDERS_PER_MSG];
+    long before[NUM_MSGS + 1];
+    int num_senders = 0;
+    bool got, done;
+    uint8_t msg;
+    size_t i;
+    int j;
+
+    MailboxInit(&mailbox, order, NUM_MSGS, phase->cancels);
+    atomic_store(&senders_done, false);
+    for(i = 0; i <= NUM_MSGS; i++)
+    {
+        atomic_store(&started[i], 0);
+        atomic_store(&posted[i], 0);
+        covered[i] = 0;
+        received[i] = 0;
+    }
+    losses = 0;
+
+    for(i = 0; i < NUM_MSGS; i++)
+    {
+        if(!(phase->senders & MAILBOX_BIT(order[i])))
+            continue;
+
+        for(j = 0; j < SENDERS_PER_MSG; j++)
+        {
+            senders[num_senders].msg = order[i];
+            senders[num_senders].seed = num_senders + 1;
+            pthread_create(&senders[num_senders].thread, NULL, Send, &senders[num_senders]);
+            num_senders++;
+        }
+    }
+
+    // Receive until the senders have finished and the mailbox stays empty
+    do
+    {
+        done = atomic_load(&senders_done);
+        for(i = 0; i <= NUM_MSGS; i++)
+            before[i] = atomic_load(&posted[i]);
+
+        got = MailboxReceive(&mailbox, &msg, done ? DRAIN_TICKS : 0);
+        CheckReceive(phase, before, got, msg);
+
+        if(!done && num_senders > 0)
+        {
+            // Join the senders once they've all finished
+            for(i = 0; i < NUM_MSGS; i++)
+                if((phase->senders & MAILBOX_BIT(order[i])) &&
+                   atomic_load(&posted[order[i]]) < posts_per_sender * SENDERS_PER_MSG)
+                    break;
+            if(i == NUM_MSGS)
+            {
+                for(j = 0; j < num_senders; j++)
+                    pthread_join(senders[j].thread, NULL);
+                atomic_store(&senders_done, true);
+            }
+        }
+    } while(!done || got);
+
+    printf("%s:", phase->name);
+    for(i = 0; i < NUM_MSGS; i++)
+        printf(" msg%u posted=%ld received=%ld", order[i],
+               (long)atomic_load(&posted[order[i]]), received[order[i]]);
+    printf(" lost=%ld pending=0x%lx\n", losses, (unsigned long)mailbox.pending);
+
+    if(mailbox.pending != 0)
+        return false;
+
+    return phase->expect_loss ? losses > 0 : losses == 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool passed = true;
+    size_t i;
+
+    if(argc > 1)
+        posts_per_sender = atol(argv[1]);
+
+    for(i = 0; i < sizeof(phases) / sizeof(phases[0]); i++)
+    {
+        bool ok = RunPhase(&phases[i]);
+
+        printf("%s %s\n", ok ? "PASS" : "FAIL", phases[i].name);
+        passed = passed && ok;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * Trip times with the S-curve and the trapezoid motion profiles (profile.c).
+ *
+ * Drives ProfileStep() from a standing start to a stop the way the physics
+ * task does, in its 10 ms steps and with its rule for when the car has
+ * arrived, for each trip the car makes and a range of jerk limits (zero is
+ * the trapezoid). Prints a line per trip and limit: how long the trip took,
+ * what ProfileTravelTime() estimated, the worst acceleration and jerk along
+ * the way, how fast the car was going when it was called arrived, and the
+ * host time one ProfileStep() takes.
+ *
+ *     profile-bench [-c]
+ *
+ * With -c it checks instead: every trip has to arrive, never go faster or
+ * accelerate harder than the limits, and never change acceleration faster
+ * than the jerk limit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "profile.h"
+
+// As in physics.c
+#define PROFILE_DT 0.01f
+#define STOP_DISTANCE 0.05f
+#define STOP_SPEED 0.5f
+#define MAX_SPEED 50.0f
+#define ACCEL 10.0f
+
+// Give up on a trip that takes longer than this
+#define MAX_STEPS 10000
+
+// Rounding the float maths may add to the limits
+#define TOLERANCE 1.001f
+
+// Trips are timed this many times over for the CPU cost
+#define TIMING_RUNS 200
+
+static const struct {
+    const char *name;
+    float feet;
+} trips[] = {
+    { "GD-P1", 500.0f },
+    { "GD-P2", 510.0f },
+    { "P1-P2", 10.0f },
+};
+
+// Zero is the trapezoid, 20 the firmware's default
+static const float jerks[] = { 0.0f, 10.0f, 20.0f, 40.0f };
+
+struct Trip {
+    int steps;          // Zero if it never arrived
+    float peak_speed;
+    float peak_accel;
+    float peak_jerk;
+    float arrive_speed;
+};
+
+/**
+ * Run one trip, the way physics.c's RunSteps() does
+ */
+static void RunTrip(const struct MotionLimits *limits, float feet, struct Trip *trip)
+{
+    struct MotionState motion = { 0.0f, 0.0f, false };
+    float location = 0.0f, remaining, moved, last_accel = 0.0f;
+    int step;
+
+    trip->steps = 0;
+    trip->peak_speed = trip->peak_accel = trip->peak_jerk = 0.0f;
+
+    for(step = 1; step <= MAX_STEPS; step++)
+    {
+        remaining = feet - location;
+        moved = ProfileStep(&motion, limits, remaining, PROFILE_DT);
+
+        if(moved >= remaining || (remaining - moved <= STOP_DISTANCE && motion.speed <= STOP_SPEED))
+        {
+            trip->steps = step;
+            trip->arrive_speed = motion.speed;
+            return;
+        }
+
+        location += moved;
+        trip->peak_speed = fmaxf(trip->peak_speed, motion.speed);
+        trip->peak_accel = fmaxf(trip->peak_accel, fabsf(motion.accel));
+        trip->peak_jerk = fmaxf(trip->peak_jerk, fabsf(motion.accel - last_accel) / PROFILE_DT);
+        last_accel = motion.accel;
+    }
+}
+
+/**
+ * @return Nanoseconds one ProfileStep() takes on a trip, on average
+ */
+static double StepTime(const struct MotionLimits *limits, float feet)
+{
+    struct timespec start, end;
+    struct Trip trip;
+    long steps = 0;
+    int run;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(run = 0; run < TIMING_RUNS; run++)
+    {
+        RunTrip(limits, feet, &trip);
+        steps += trip.steps;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / steps;
+}
+
+/**
+ * @return True if the trip kept to the limits
+ */
+static bool CheckTrip(const struct MotionLimits *limits, const char *name,
+                      const struct Trip *trip)
+{
+    bool ok = trip->steps > 0 && trip->arrive_speed <= STOP_SPEED &&
+              trip->peak_speed <= limits->max_speed * TOLERANCE &&
+              trip->peak_accel <= limits->accel * TOLERANCE &&
+              (limits->jerk <= 0.0f || trip->peak_jerk <= limits->jerk * TOLERANCE);
+
+    printf("%s profile %s jerk=%g\n", ok ? "PASS" : "FAIL", name, limits->jerk);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    struct MotionLimits limits = { MAX_SPEED, ACCEL, 0.0f };
+    bool check = false, passed = true;
+    float trapezoid = 0.0f, seconds;
+    struct Trip trip;
+    size_t i, j;
+    int opt;
+
+    while((opt = getopt(argc, argv, "c")) != -1)
+    {
+        if(opt != 'c')
+        {
+            fprintf(stderr, "usage: profile-bench [-c]\n");
+            return 2;
+        }
+        check = true;
+    }
+
+    for(i = 0; i < sizeof(trips) / sizeof(trips[0]); i++)
+    {
+        for(j = 0; j < sizeof(jerks) / sizeof(jerks[0]); j++)
+        {
+            limits.jerk = jerks[j];
+            RunTrip(&limits, trips[i].feet, &trip);
+
+            if(check)
+            {
+                passed = CheckTrip(&limits, trips[i].name, &trip) && passed;
+                continue;
+            }
+
+            seconds = trip.steps * PROFILE_DT;
+            if(limits.jerk <= 0.0f)
+                trapezoid = seconds;
+
+            printf("profile trip=%s feet=%g jerk=%g time_s=%.2f estimate_s=%.2f vs_trapezoid_pct=%.1f "
+                   "peak_speed=%.2f peak_accel=%.2f peak_jerk=%.1f arrive_speed=%.2f step_ns=%.0f\n",
+                   trips[i].name, trips[i].feet, limits.jerk, seconds,
+                   ProfileTravelTime(&limits, trips[i].feet),
+                   trapezoid > 0.0f ? 100.0f * (seconds - trapezoid) / trapezoid : 0.0f,
+                   trip.peak_speed, trip.peak_accel, trip.peak_jerk, trip.arrive_speed,
+                   StepTime(&limits, trips[i].feet));
+        }
+    }
+
+    return passed ? 0 : 1;
+}
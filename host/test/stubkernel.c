@@ -0,0 +1,237 @@
+/**
+ * Just enough of FreeRTOS, on POSIX threads, to run firmware modules in the
+ * host's thread tests.
+ *
+ * Each task is a thread and they really do run at the same time, so a module
+ * whose only protection is FreeRTOS's critical sections and scheduler locks
+ * gets those and nothing else. Both are one recursive lock here. A tick is a
+ * millisecond of the host's monotonic clock.
+ */
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+
+static pthread_mutex_t critical;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void InitCritical(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vStubEnterCritical(void)
+{
+    pthread_once(&critical_once, InitCritical);
+    pthread_mutex_lock(&critical);
+}
+
+void vStubExitCritical(void)
+{
+    pthread_mutex_unlock(&critical);
+}
+
+void vStubYield(void)
+{
+    sched_yield();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    struct timespec delay = {
+        .tv_sec = xTicksToDelay / 1000,
+        .tv_nsec = (xTicksToDelay % 1000) * 1000000L
+    };
+
+    nanosleep(&delay, NULL);
+}
+
+void vTaskSetTimeOutState(TimeOut_t *pxTimeOut)
+{
+    pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+
+/**
+ * Like the kernel's: takes the time already waited off the time left to
+ * wait, and reports a timeout once none is left
+ */
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *pxTimeOut, TickType_t *pxTicksToWait)
+{
+    TickType_t xNow = xTaskGetTickCount();
+    TickType_t xElapsed = xNow - pxTimeOut->xTimeOnEntering;
+
+    if(*pxTicksToWait == portMAX_DELAY)
+        return pdFALSE;
+
+    if(xElapsed >= *pxTicksToWait)
+    {
+        *pxTicksToWait = 0;
+        return pdTRUE;
+    }
+
+    *pxTicksToWait -= xElapsed;
+    pxTimeOut->xTimeOnEntering = xNow;
+    return pdFALSE;
+}
+
+/**
+ * The CLOCK_REALTIME time a number of ticks from now, for pthread's timed
+ * waits
+ */
+static struct timespec Deadline(TickType_t xTicks)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += xTicks / 1000;
+    deadline.tv_nsec += (xTicks % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    return deadline;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer)
+{
+    pthread_mutex_init(&pxSemaphoreBuffer->lock, NULL);
+    pthread_cond_init(&pxSemaphoreBuffer->given, NULL);
+    pxSemaphoreBuffer->count = 0;
+    return pxSemaphoreBuffer;
+}
+
+/**
+ * @return pdFALSE if it was already given, like the kernel's
+ */
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    BaseType_t xReturn;
+
+    pthread_mutex_lock(&xSemaphore->lock);
+    xReturn = (xSemaphore->count == 0);
+    xSemaphore->count = 1;
+    pthread_cond_signal(&xSemaphore->given);
+    pthread_mutex_unlock(&xSemaphore->lock);
+
+    return xReturn;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    struct timespec deadline = Deadline(xBlockTime);
+    BaseType_t xReturn;
+    int error = 0;
+
+    pthread_mutex_lock(&xSemaphore->lock);
+    while(xSemaphore->count == 0 && xBlockTime != 0 && error != ETIMEDOUT)
+    {
+        if(xBlockTime == portMAX_DELAY)
+            pthread_cond_wait(&xSemaphore->given, &xSemaphore->lock);
+        else
+            error = pthread_cond_timedwait(&xSemaphore->given, &xSemaphore->lock, &deadline);
+    }
+
+    xReturn = (xSemaphore->count != 0);
+    xSemaphore->count = 0;
+    pthread_mutex_unlock(&xSemaphore->lock);
+
+    return xReturn;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *pxEventGroupBuffer)
+{
+    pthread_mutex_init(&pxEventGroupBuffer->lock, NULL);
+    pthread_cond_init(&pxEventGroupBuffer->changed, NULL);
+    pxEventGroupBuffer->bits = 0;
+    return pxEventGroupBuffer;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    EventBits_t uxBits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    uxBits = (xEventGroup->bits |= uxBitsToSet);
+    pthread_cond_broadcast(&xEventGroup->changed);
+    pthread_mutex_unlock(&xEventGroup->lock);
+
+    return uxBits;
+}
+
+/**
+ * @return The bits before they were cleared, like the kernel's
+ */
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+    EventBits_t uxBits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    uxBits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    pthread_mutex_unlock(&xEventGroup->lock);
+
+    return uxBits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    EventBits_t uxBits;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    uxBits = xEventGroup->bits;
+    pthread_mutex_unlock(&xEventGroup->lock);
+
+    return uxBits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+    struct timespec deadline = Deadline(xTicksToWait);
+    EventBits_t uxBits;
+    int error = 0;
+
+    pthread_mutex_lock(&xEventGroup->lock);
+    for(;;)
+    {
+        uxBits = xEventGroup->bits;
+        if(xWaitForAllBits ? (uxBits & uxBitsToWaitFor) == uxBitsToWaitFor
+                           : (uxBits & uxBitsToWaitFor) != 0)
+        {
+            if(xClearOnExit)
+                xEventGroup->bits &= ~uxBitsToWaitFor;
+            break;
+        }
+
+        if(xTicksToWait == 0 || error == ETIMEDOUT)
+            break;
+
+        if(xTicksToWait == portMAX_DELAY)
+            pthread_cond_wait(&xEventGroup->changed, &xEventGroup->lock);
+        else
+            error = pthread_cond_timedwait(&xEventGroup->changed, &xEventGroup->lock, &deadline);
+    }
+    pthread_mutex_unlock(&xEventGroup->lock);
+
+    return uxBits;
+}
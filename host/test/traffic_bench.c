@@ -0,0 +1,306 @@
+/**
+ * The traffic generator (traffic.c) stepped through millions of passengers in
+ * virtual time.
+ *
+ * Nothing here runs the kernel: the generator's TrafficStep() is called with
+ * the time and the car's state bits straight from a stand-in car, which
+ * shuttles GD, P1, P2, P1, GD and so on, stopping STOP_MS at each floor with
+ * the door open for DOOR_MS of it. Between steps the clock jumps to whatever
+ * the generator waits for next, so a passenger costs a few steps of host time.
+ *
+ *     traffic-bench [-c] [-p profile] [-r calls per hour] [-n passengers] [-s seed]
+ *
+ * Prints a line: how many passengers arrived and how long that took in
+ * virtual hours and in host time, the arrival rate against the one the
+ * profile's curve asks for, and how many were delivered. With -c it checks
+ * instead that the rate and the share of calls from each floor are what the
+ * profile asks for, to four standard deviations, and that every passenger
+ * is waiting, riding or delivered.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "physics.h"
+#include "carstate.h"
+#include "traffic.h"
+
+#define DEFAULT_RATE 100000
+#define DEFAULT_PASSENGERS 1000000
+#define DEFAULT_SEED 1
+
+// The stand-in car's timetable
+#define STOP_MS 20000
+#define DOOR_MS 5000
+#define NUM_STOPS 4
+
+static const int stops[NUM_STOPS] = { 0, 1, 2, 1 };
+
+// As in physics.c
+static const float floor_feet[TRAFFIC_FLOORS] = { 0.0f, 500.0f, 510.0f };
+
+// The profiles' curves and origin-destination weights, as in traffic.c, for
+// what the check expects
+static const uint8_t curves[TRAFFIC_NUM_PROFILES][TRAFFIC_CURVE_SEGMENTS] = {
+    [TRAFFIC_UNIFORM] = { 100, 100, 100, 100, 100, 100, 100, 100 },
+    [TRAFFIC_UP_PEAK] = { 20, 50, 100, 100, 70, 40, 20, 10 },
+    [TRAFFIC_DOWN_PEAK] = { 20, 50, 100, 100, 70, 40, 20, 10 },
+    [TRAFFIC_LUNCH] = { 30, 60, 100, 80, 80, 100, 60, 30 },
+    [TRAFFIC_STORM] = { 100, 100, 100, 100, 100, 100, 100, 100 }
+};
+
+static const uint8_t origins[TRAFFIC_NUM_PROFILES][TRAFFIC_FLOORS] = {
+    [TRAFFIC_UNIFORM] = { 2, 2, 2 },
+    [TRAFFIC_UP_PEAK] = { 80, 10, 10 },
+    [TRAFFIC_DOWN_PEAK] = { 10, 45, 45 },
+    [TRAFFIC_LUNCH] = { 80, 50, 50 },
+    [TRAFFIC_STORM] = { 2, 2, 2 }
+};
+
+// Virtual time, in ticks
+static uint64_t now;
+
+// What the generator did to the car
+static unsigned long hall_calls[TRAFFIC_FLOORS];
+static unsigned long car_calls, emergencies;
+
+/**
+ * @return The stop the stand-in car is at or heading for
+ */
+static int StopAt(uint64_t when)
+{
+    return stops[(when / STOP_MS) % NUM_STOPS];
+}
+
+/**
+ * @param bits STATE_DOOR_OPEN or STATE_DOOR_CLOSED
+ *
+ * @return The first tick from now the stand-in car's door is that way
+ */
+static uint64_t NextSet(EventBits_t bits)
+{
+    uint64_t phase = now % STOP_MS;
+
+    if(bits & STATE_DOOR_OPEN)
+        return (phase < DOOR_MS) ? now : now - phase + STOP_MS;
+
+    return (phase >= DOOR_MS) ? now : now - phase + DOOR_MS;
+}
+
+static double Seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @return True if a count is within four standard deviations of what's
+ *         expected
+ */
+static bool Near(const char *what, double count, double expected, double variance)
+{
+    double limit = 4.0 * sqrt(variance) + 1.0;
+    bool ok = fabs(count - expected) <= limit;
+
+    printf("%s traffic %s: %.0f, expected %.0f +- %.0f\n", ok ? "PASS" : "FAIL", what,
+           count, expected, limit);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    enum TRAFFIC_PROFILE profile = TRAFFIC_UP_PEAK;
+    unsigned long rate = DEFAULT_RATE, passengers = DEFAULT_PASSENGERS, total;
+    uint32_t seed = DEFAULT_SEED;
+    struct TrafficStats stats;
+    struct TrafficWait wait;
+    uint64_t when;
+    double start, seconds, hours, curve = 0.0, share;
+    bool check = false, passed = true;
+    EventBits_t bits;
+    int opt, i;
+
+    while((opt = getopt(argc, argv, "cp:r:n:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c':
+                check = true;
+                break;
+            case 'p':
+                for(i = 0; i < TRAFFIC_NUM_PROFILES; i++)
+                    if(strcasecmp(optarg, TrafficProfileName(i)) == 0)
+                        break;
+                profile = i;
+                break;
+            case 'r':
+                rate = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                passengers = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: traffic-bench [-c] [-p profile] [-r calls per hour] "
+                        "[-n passengers] [-s seed]\n");
+                return 2;
+        }
+    }
+
+    if(!TrafficStart(profile, rate, seed))
+    {
+        fprintf(stderr, "traffic-bench: no such profile or rate\n");
+        return 2;
+    }
+
+    start = Seconds();
+    TrafficBegin((TickType_t)now);
+    TrafficStep((TickType_t)now, 0, &wait);
+
+    do
+    {
+        // Jump to the door doing what the generator waits for, or its timeout
+        when = NextSet(wait.bits);
+        if(when <= now + wait.ticks)
+        {
+            now = when;
+            bits = wait.bits;
+        }
+        else
+        {
+            now += wait.ticks;
+            bits = 0;
+        }
+
+        TrafficStep((TickType_t)now, bits, &wait);
+        TrafficGetStats(&stats);
+    } while(stats.arrived < passengers);
+
+    seconds = Seconds() - start;
+    hours = now / 3600000.0;
+
+    // Arrivals are drawn at the peak rate, each kept with the curve's share
+    for(i = 0; i < TRAFFIC_CURVE_SEGMENTS; i++)
+        curve += curves[profile][i] / 100.0 / TRAFFIC_CURVE_SEGMENTS;
+
+    if(!check)
+    {
+        printf("traffic profile=%s calls_per_hour=%lu passengers=%lu virtual_h=%.1f host_s=%.2f "
+               "ns_per_passenger=%.0f arrived_per_h=%.0f expected_per_h=%.0f delivered=%lu "
+               "emergencies=%lu\n", TrafficProfileName(profile), rate, (unsigned long)stats.arrived,
+               hours, seconds, seconds * 1e9 / stats.arrived, stats.arrived / hours, rate * curve,
+               (unsigned long)stats.delivered, (unsigned long)stats.emergencies);
+        return 0;
+    }
+
+    // A Poisson process, thinned, is still one
+    passed = Near("arrivals", stats.arrived, rate * curve * hours, rate * curve * hours) && passed;
+
+    total = 0;
+    for(i = 0; i < TRAFFIC_FLOORS; i++)
+        total += origins[profile][i];
+    for(i = 0; i < TRAFFIC_FLOORS; i++)
+    {
+        char what[32];
+
+        snprintf(what, sizeof(what), "calls from floor %d", i);
+        share = (double)origins[profile][i] / total;
+        passed = Near(what, hall_calls[i], stats.arrived * share,
+                      stats.arrived * share * (1.0 - share)) && passed;
+    }
+
+    if(stats.arrived != stats.waiting + stats.riding + stats.delivered || stats.delivered == 0 ||
+       stats.boarded != stats.riding + stats.delivered || car_calls == 0)
+    {
+        printf("FAIL traffic %s: arrived=%lu boarded=%lu delivered=%lu waiting=%lu riding=%lu\n",
+               TrafficProfileName(profile), (unsigned long)stats.arrived,
+               (unsigned long)stats.boarded, (unsigned long)stats.delivered,
+               (unsigned long)stats.waiting, (unsigned long)stats.riding);
+        passed = false;
+    }
+    else
+        printf("PASS traffic %s passengers\n", TrafficProfileName(profile));
+
+    return passed ? 0 : 1;
+}
+
+// The car, as the generator sees it
+struct FloorRequest GetRequest(int requestNum)
+{
+    struct FloorRequest request = { false, UP, floor_feet[requestNum], "" };
+
+    return request;
+}
+
+void SetRequest(int requestNum, enum DIR dir)
+{
+    hall_calls[requestNum]++;
+}
+
+void SetCarRequest(int requestNum)
+{
+    car_calls++;
+}
+
+void SetEmergStopEnable()
+{
+    emergencies++;
+}
+
+void CarStateGet(struct CarState *state)
+{
+    state->dest = StopAt(now);
+    state->location = floor_feet[state->dest];
+    state->speed = 0.0f;
+    state->flags = CarStateFlags();
+}
+
+EventBits_t CarStateFlags(void)
+{
+    return STATE_STOPPED | ((now % STOP_MS < DOOR_MS) ? STATE_DOOR_OPEN : STATE_DOOR_CLOSED);
+}
+
+EventBits_t CarStateWait(EventBits_t bits, TickType_t timeout)
+{
+    return 0;
+}
+
+void MailboxPost(struct Mailbox *mailbox, uint8_t msg)
+{
+}
+
+// The kernel, which only TrafficStart() and TrafficGetStats() call here
+void vTaskSuspendAll(void)
+{
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    return pdFALSE;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+                              uint32_t *pulPreviousNotificationValue)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    return 0;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)now;
+}
@@ -0,0 +1,171 @@
+/**
+ * Delayed task scaling, with and without the timing wheel.
+ *
+ * Runs the real kernel in virtual time (see
+ * FreeRTOS/Source/portable/GCC/Posix_Sim) with a number of tasks that each
+ * delay for a random 1 to 1000 ticks, wake, and delay again, so the delayed
+ * list always holds nearly all of them. The Makefile builds it twice, with
+ * configUSE_DELAY_TIMING_WHEEL 0 and 1.
+ *
+ *     wheel-bench-<0|1> [-t tasks] [-n ticks]
+ *
+ * Prints how many wakes there were, the host time per tick and per wake, how
+ * many tasks woke on some other tick than the one they asked for, and a
+ * checksum of which task woke on which tick, which has to come out the same
+ * with and without the wheel.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define MAX_TASKS 2000
+#define DEFAULT_TASKS 100
+#define DEFAULT_TICKS 20000
+#define MAX_DELAY 1000
+
+static StaticTask_t tasks[MAX_TASKS];
+static StackType_t stacks[MAX_TASKS][configMINIMAL_STACK_SIZE];
+static StaticTask_t idle_task;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+
+static unsigned long wakes, late;
+static uint64_t checksum;
+
+/**
+ * Mixes a wake into the checksum. Tasks due on the same tick may wake in
+ * either order, so the sum doesn't depend on it.
+ */
+static uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static void taskDelayer(void *pvParameters)
+{
+    uintptr_t id = (uintptr_t)pvParameters;
+    uint32_t random = id + 1;
+    TickType_t delay, due;
+
+    while(1)
+    {
+        // xorshift32
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        delay = 1 + random % MAX_DELAY;
+
+        due = xTaskGetTickCount() + delay;
+        vTaskDelay(delay);
+
+        wakes++;
+        if(xTaskGetTickCount() != due)
+            late++;
+        checksum += Mix(((uint64_t)due << 16) | id);
+    }
+}
+
+static void End(void *unused)
+{
+    vTaskEndScheduler();
+}
+
+int main(int argc, char **argv)
+{
+    struct timespec start, end;
+    long num_tasks = DEFAULT_TASKS, ticks = DEFAULT_TICKS, i;
+    char name[configMAX_TASK_NAME_LEN];
+    double ns;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:n:")) != -1)
+    {
+        switch(opt)
+        {
+            case 't':
+                num_tasks = atol(optarg);
+                break;
+            case 'n':
+                ticks = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: wheel-bench [-t tasks] [-n ticks]\n");
+                return 2;
+        }
+    }
+    if(num_tasks < 1 || num_tasks > MAX_TASKS)
+        num_tasks = DEFAULT_TASKS;
+
+    for(i = 0; i < num_tasks; i++)
+    {
+        snprintf(name, sizeof(name), "D%ld", i);
+        xTaskCreateStatic(taskDelayer, name, configMINIMAL_STACK_SIZE, (void *)(uintptr_t)i,
+                          tskIDLE_PRIORITY + 1, stacks[i], &tasks[i]);
+    }
+
+    vPortSimulateInterrupt((uint64_t)ticks * 1000 * portTICK_PERIOD_MS, End, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    vTaskStartScheduler();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("wheel=%d tasks=%ld ticks=%ld wakes=%lu ns_per_tick=%.0f ns_per_wake=%.0f late=%lu checksum=%016llx\n",
+           configUSE_DELAY_TIMING_WHEEL, num_tasks, ticks, wakes, ns / ticks,
+           wakes ? ns / wakes : 0.0, late, (unsigned long long)checksum);
+
+    return late == 0 ? 0 : 1;
+}
+
+// The firmware's configuration hooks, which this has no use for
+void TraceRecord(uint8_t type, uint8_t id, uint16_t arg)
+{
+}
+
+void HeapStatsRecordMalloc(void *address, size_t size, void *caller)
+{
+}
+
+void HeapStatsRecordFree(void *address, size_t size)
+{
+}
+
+void RunStatsInit(void)
+{
+}
+
+uint32_t RunStatsGetCounter(void)
+{
+    return 0;
+}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+                                   uint16_t *pusIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &idle_task;
+    *ppxIdleTaskStackBuffer = idle_stack;
+    *pusIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationMallocFailedHook(void)
+{
+    fprintf(stderr, "wheel-bench: pvPortMalloc() failed\n");
+    abort();
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+    fprintf(stderr, "wheel-bench: stack overflow in %s\n", pcTaskName);
+    abort();
+}
+
+void vAssertCalled(const char *pcFile, unsigned long ulLine)
+{
+    fprintf(stderr, "wheel-bench: assertion failed at %s:%lu\n", pcFile, ulLine);
+    abort();
+}
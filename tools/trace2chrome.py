@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Convert a dump from the elevator's TR command into Chrome trace event JSON.
+
+Capture everything the terminal prints after typing TR (from the TRACE line to
+the END line) into a file, then run:
+
+    python3 trace2chrome.py dump.txt trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev. Each task
+and interrupt gets its own row, queue operations show up as instant events on
+the task that made them, and every named queue gets an occupancy counter.
+
+The time from each send to the receive that takes the item off the same queue
+is printed per queue, which shows how long a hand-off like physics -> door
+spends waiting in the queue.
+"""
+import json
+import sys
+
+# Event types, see trace.h
+TASK_SWITCH = 1
+QUEUE_SEND = 2
+QUEUE_SEND_FAILED = 3
+QUEUE_RECEIVE = 4
+QUEUE_RECEIVE_FAILED = 5
+QUEUE_BLOCK_SEND = 6
+QUEUE_BLOCK_RECEIVE = 7
+QUEUE_SEND_ISR = 8
+QUEUE_RECEIVE_ISR = 9
+ISR_ENTER = 10
+ISR_EXIT = 11
+
+QUEUE_EVENTS = {
+    QUEUE_SEND: "send",
+    QUEUE_SEND_FAILED: "send failed",
+    QUEUE_RECEIVE: "receive",
+    QUEUE_RECEIVE_FAILED: "receive failed",
+    QUEUE_BLOCK_SEND: "block on send",
+    QUEUE_BLOCK_RECEIVE: "block on receive",
+    QUEUE_SEND_ISR: "send from ISR",
+    QUEUE_RECEIVE_ISR: "receive from ISR",
+}
+
+SENDS = (QUEUE_SEND, QUEUE_SEND_ISR)
+RECEIVES = (QUEUE_RECEIVE, QUEUE_RECEIVE_ISR)
+
+PID = 1
+ISR_TID_BASE = 1000
+
+
+def parse(lines):
+    """Read the dump into (timestamp Hz, task names, queue names, ISR names, events)"""
+    hz = None
+    tasks, queues, isrs = {}, {}, {}
+    events = []
+
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+
+        if fields[0] == "TRACE":
+            hz = int(fields[1])
+        elif fields[0] in ("T", "Q", "I") and len(fields) >= 3:
+            names = {"T": tasks, "Q": queues, "I": isrs}[fields[0]]
+            names[int(fields[1])] = " ".join(fields[2:])
+        elif fields[0] == "E":
+            for packed in fields[1:]:
+                events.append((int(packed[0:8], 16), int(packed[8:10], 16),
+                               int(packed[10:12], 16), int(packed[12:16], 16)))
+
+    if hz is None:
+        raise ValueError("no TRACE line, is this a TR dump?")
+
+    return hz, tasks, queues, isrs, events
+
+
+def unwrap(events):
+    """Turn the 32-bit core timer counts into a count that keeps increasing"""
+    result = []
+    offset = 0
+    last = None
+
+    for time, etype, eid, arg in events:
+        if last is not None and time < last:
+            offset += 1 << 32
+        last = time
+        result.append((time + offset, etype, eid, arg))
+
+    return result
+
+
+def convert(hz, tasks, queues, isrs, events):
+    """Build the Chrome trace and the per-queue send -> receive latencies"""
+    events = unwrap(events)
+    start = events[0][0] if events else 0
+
+    def us(time):
+        return (time - start) * 1e6 / hz
+
+    def queue_name(num):
+        return queues.get(num, "queue %d" % num)
+
+    trace = []
+    for num, name in tasks.items():
+        trace.append({"ph": "M", "pid": PID, "tid": num, "name": "thread_name",
+                      "args": {"name": name}})
+    for num, name in isrs.items():
+        trace.append({"ph": "M", "pid": PID, "tid": ISR_TID_BASE + num,
+                      "name": "thread_name", "args": {"name": "ISR " + name}})
+
+    running, run_start = None, None
+    isr_start = {}
+    waiting = {}        # Queue number -> send times of the items in it
+    latencies = {}      # Queue number -> send to receive times
+
+    for time, etype, eid, arg in events:
+        if etype == TASK_SWITCH:
+            if running is not None:
+                trace.append({"ph": "X", "pid": PID, "tid": running,
+                              "name": tasks.get(running, "task %d" % running),
+                              "ts": us(run_start), "dur": us(time) - us(run_start)})
+            running, run_start = eid, time
+
+        elif etype == ISR_ENTER:
+            isr_start[eid] = time
+
+        elif etype == ISR_EXIT and eid in isr_start:
+            trace.append({"ph": "X", "pid": PID, "tid": ISR_TID_BASE + eid,
+                          "name": isrs.get(eid, "isr %d" % eid),
+                          "ts": us(isr_start[eid]), "dur": us(time) - us(isr_start[eid])})
+            del isr_start[eid]
+
+        elif etype in QUEUE_EVENTS:
+            # The arg is the number of items in the queue before the operation
+            tid = running if running is not None else 0
+            trace.append({"ph": "i", "s": "t", "pid": PID, "tid": tid,
+                          "name": "%s %s" % (QUEUE_EVENTS[etype], queue_name(eid)),
+                          "ts": us(time), "args": {"items": arg}})
+
+            if etype in SENDS:
+                trace.append({"ph": "C", "pid": PID, "name": queue_name(eid),
+                              "ts": us(time), "args": {"items": arg + 1}})
+                waiting.setdefault(eid, []).append(time)
+            elif etype in RECEIVES:
+                trace.append({"ph": "C", "pid": PID, "name": queue_name(eid),
+                              "ts": us(time), "args": {"items": max(arg - 1, 0)}})
+                # Items sent before the recording started have no send time
+                if waiting.get(eid):
+                    sent = waiting[eid].pop(0)
+                    latencies.setdefault(eid, []).append(us(time) - us(sent))
+
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}, latencies
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: %s dump.txt trace.json" % sys.argv[0], file=sys.stderr)
+        return 1
+
+    with open(sys.argv[1]) as f:
+        hz, tasks, queues, isrs, events = parse(f)
+
+    trace, latencies = convert(hz, tasks, queues, isrs, events)
+
+    with open(sys.argv[2], "w") as f:
+        json.dump(trace, f)
+
+    print("%d events, %d tasks, %d queues" % (len(events), len(tasks), len(queues)))
+    for num, times in sorted(latencies.items()):
+        print("%-10s send -> receive: n=%d min %.1f us, avg %.1f us, max %.1f us" %
+              (queues.get(num, "queue %d" % num), len(times), min(times),
+               sum(times) / len(times), max(times)))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())